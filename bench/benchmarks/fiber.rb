@@ -0,0 +1,29 @@
+# frozen_string_literal: true
+
+Bench.bench('fiber_switch', iterations: 200_000, unit: 'switches') do |n|
+  main = Fiber.current
+  f = spin { loop { main.schedule; suspend } }
+  n.times do
+    f.schedule
+    suspend
+  end
+  f.stop
+end
+
+Bench.bench('snooze', iterations: 500_000, unit: 'snoozes') do |n|
+  n.times { snooze }
+end
+
+Bench.bench('multi_snooze', iterations: 500_000, unit: 'snoozes') do |n|
+  fibers = 10.times.map { spin { (n / 10).times { snooze } } }
+  Fiber.await(*fibers)
+end
+
+Bench.bench('spin_terminate', iterations: 100_000, unit: 'fibers') do |n|
+  n.times do
+    f = spin { suspend }
+    snooze
+    f.terminate
+    f.await
+  end
+end
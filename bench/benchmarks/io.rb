@@ -0,0 +1,91 @@
+# frozen_string_literal: true
+
+require 'zlib'
+
+ECHO_MESSAGE = ('x' * 63 + "\n").freeze
+
+def bench_echo_server
+  port = rand(1100..60000)
+  server = TCPServer.new('127.0.0.1', port)
+  fiber = spin do
+    server.accept_loop do |conn|
+      spin do
+        conn.read_loop { |data| conn << data }
+      ensure
+        conn.close
+      end
+    end
+  end
+  [server, port, fiber]
+rescue Errno::EADDRINUSE
+  retry
+end
+
+Bench.bench('echo_latency', iterations: 20_000, unit: 'requests') do |n|
+  server, port, fiber = bench_echo_server
+  client = TCPSocket.new('127.0.0.1', port)
+  samples = Array.new(n)
+  n.times do |i|
+    t0 = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    client << ECHO_MESSAGE
+    client.readpartial(8192)
+    samples[i] = Process.clock_gettime(Process::CLOCK_MONOTONIC) - t0
+  end
+  client.close
+  fiber.stop
+  server.close
+  Bench.percentiles(samples)
+end
+
+Bench.bench('echo_throughput', iterations: 200_000, unit: 'messages') do |n|
+  server, port, fiber = bench_echo_server
+  concurrency = 10
+  batch = ECHO_MESSAGE * 100
+  # Measures the throughput of concurrent connections, each sending batches of
+  # messages and reading back the echoed data. All connections are opened up
+  # front, waiting in the server's listen backlog until accepted.
+  sockets = concurrency.times.map { TCPSocket.new('127.0.0.1', port) }
+  clients = sockets.map do |client|
+    spin do
+      (n / concurrency / 100).times do
+        client << batch
+        left = batch.bytesize
+        left -= client.readpartial(65536).bytesize while left > 0
+      end
+      client.close
+    end
+  end
+  Fiber.await(*clients)
+  fiber.stop
+  server.close
+end
+
+Bench.bench('splice', iterations: 20_000, unit: 'chunks') do |n|
+  chunk = 'x' * 65536
+  r1, w1 = IO.pipe
+  r2, w2 = IO.pipe
+  writer = spin do
+    n.times { w1 << chunk }
+    w1.close
+  end
+  reader = spin { r2.read_loop(65536) { } }
+  IO.splice(r1, w2, -65536)
+  w2.close
+  Fiber.await(writer, reader)
+  r1.close
+  r2.close
+end
+
+Bench.bench('gzip', iterations: 200, unit: 'MB') do |n|
+  data = Random.new(42).bytes(1 << 19) * 2
+  n.times do
+    src = IO.pipe
+    dest = +''
+    spin do
+      src[1] << data
+      src[1].close
+    end
+    IO.gzip(src[0], dest)
+    src[0].close
+  end
+end
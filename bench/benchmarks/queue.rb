@@ -0,0 +1,39 @@
+# frozen_string_literal: true
+
+Bench.bench('queue_ping_pong', iterations: 200_000, unit: 'messages') do |n|
+  ping = Polyphony::Queue.new
+  pong = Polyphony::Queue.new
+  f = spin { loop { pong << ping.shift } }
+  n.times do |i|
+    ping << i
+    pong.shift
+  end
+  f.stop
+end
+
+Bench.bench('cross_thread_schedule', iterations: 50_000, unit: 'messages') do |n|
+  ping = Polyphony::Queue.new
+  pong = Polyphony::Queue.new
+  t = Thread.new do
+    while (msg = ping.shift)
+      pong << msg
+    end
+  end
+  n.times do |i|
+    ping << i
+    pong.shift
+  end
+  ping << nil
+  t.join
+end
+
+Bench.bench('timer_sleep', iterations: 2_000, unit: 'timers') do |n|
+  fibers = 100.times.map { spin { (n / 100).times { sleep 0.0001 } } }
+  Fiber.await(*fibers)
+end
+
+Bench.bench('timer_cancel_after', iterations: 200_000, unit: 'timeouts') do |n|
+  timer = Polyphony::Timer.new(resolution: 0.01)
+  n.times { timer.cancel_after(10) { } }
+  timer.stop
+end
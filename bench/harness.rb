@@ -0,0 +1,148 @@
+# frozen_string_literal: true
+
+require 'json'
+require 'etc'
+
+# A minimal benchmark harness. Benchmarks are registered with `Bench.bench`,
+# and are each run a number of times in a fresh fiber. Each run is given an
+# iteration count, and returns an optional hash of extra measurements (such as
+# latency percentiles). The rate of each run is computed from its duration,
+# and the median run is reported.
+module Bench
+  # A registered benchmark.
+  Benchmark = Struct.new(:name, :iterations, :unit, :block)
+
+  # Default number of runs per benchmark.
+  RUNS = 5
+
+  # Default regression threshold, as a fraction of the baseline rate.
+  THRESHOLD = 0.10
+
+  class << self
+    # Returns all registered benchmarks.
+    #
+    # @return [Array<Benchmark>] benchmarks
+    def benchmarks
+      @benchmarks ||= []
+    end
+
+    # Registers a benchmark. The given block is called with the number of
+    # iterations to perform.
+    #
+    # @param name [String] benchmark name
+    # @param iterations [Integer] iterations per run
+    # @param unit [String] unit of work
+    # @yield [Integer] iterations
+    def bench(name, iterations:, unit: 'ops', &block)
+      benchmarks << Benchmark.new(name, iterations, unit, block)
+    end
+
+    # Runs all benchmarks matching the given filter.
+    #
+    # @param filter [Regexp, nil] benchmark name filter
+    # @param scale [Float] iteration count multiplier
+    # @param runs [Integer] runs per benchmark
+    # @return [Hash] results
+    def run(filter: nil, scale: 1.0, runs: RUNS, io: $stdout)
+      results = {}
+      benchmarks.each do |b|
+        next if filter && b.name !~ filter
+
+        io.print format('%-28s ', b.name)
+        results[b.name] = run_benchmark(b, (b.iterations * scale).ceil, runs)
+        io.puts format_result(results[b.name])
+      end
+
+      { meta: meta, results: results }
+    end
+
+    # Compares the given results against a baseline, for each benchmark present
+    # in both. A benchmark is flagged as a regression if its rate is lower than
+    # the baseline rate by more than the given threshold.
+    #
+    # @param current [Hash] current results
+    # @param baseline [Hash] baseline results
+    # @param threshold [Float] regression threshold
+    # @return [Array<Hash>] comparison entries
+    def compare(current, baseline, threshold: THRESHOLD)
+      base_results = baseline['results'] || baseline[:results]
+      (current['results'] || current[:results]).map do |name, result|
+        base = base_results[name.to_s] || base_results[name.to_sym]
+        next unless base
+
+        rate = result['rate'] || result[:rate]
+        base_rate = base['rate'] || base[:rate]
+        change = (rate - base_rate) / base_rate
+        { name: name.to_s, rate: rate, baseline: base_rate, change: change, regression: change < -threshold }
+      end.compact
+    end
+
+    # Prints a comparison table.
+    #
+    # @param entries [Array<Hash>] comparison entries
+    def print_comparison(entries, io: $stdout)
+      entries.each do |e|
+        flag = e[:regression] ? '  REGRESSION' : ''
+        io.puts format('%-28s %14.1f %14.1f %+8.1f%%%s', e[:name], e[:baseline], e[:rate], e[:change] * 100, flag)
+      end
+    end
+
+    # Returns the 50th, 90th and 99th percentiles of the given samples.
+    #
+    # @param samples [Array<Numeric>] samples
+    # @return [Hash] percentile values keyed by :p50, :p90, :p99
+    def percentiles(samples)
+      sorted = samples.sort
+      pick = ->(pct) { sorted[((sorted.size - 1) * pct / 100.0).round] }
+      { p50: pick.(50), p90: pick.(90), p99: pick.(99) }
+    end
+
+    private
+
+    def run_benchmark(bench, iterations, runs)
+      # warm up
+      run_once(bench, [iterations / 10, 1].max)
+
+      samples = (1..runs).map do
+        GC.start
+        t0 = now
+        extra = run_once(bench, iterations)
+        elapsed = now - t0
+        { rate: iterations / elapsed, elapsed: elapsed, extra: extra }
+      end
+      median = samples.sort_by { |s| s[:rate] }[runs / 2]
+
+      {
+        unit: bench.unit,
+        iterations: iterations,
+        rate: median[:rate],
+        rates: samples.map { |s| s[:rate] }
+      }.merge(median[:extra].is_a?(Hash) ? median[:extra] : {})
+    end
+
+    def run_once(bench, iterations)
+      spin { bench.block.(iterations) }.await
+    end
+
+    def format_result(result)
+      str = format('%14.1f %s/s', result[:rate], result[:unit])
+      str << format('  p50 %.1fus p99 %.1fus', result[:p50] * 1e6, result[:p99] * 1e6) if result[:p99]
+      str
+    end
+
+    def meta
+      {
+        backend: Thread.current.backend.kind,
+        polyphony: Polyphony::VERSION,
+        ruby: RUBY_DESCRIPTION,
+        revision: `git rev-parse --short HEAD 2>/dev/null`.chomp,
+        cpus: Etc.nprocessors,
+        time: Time.now.utc.to_s
+      }
+    end
+
+    def now
+      ::Process.clock_gettime(::Process::CLOCK_MONOTONIC)
+    end
+  end
+end
@@ -0,0 +1,70 @@
+# frozen_string_literal: true
+
+# Runs the benchmark suite against the currently built backend, writing results
+# as JSON, and optionally comparing them against a baseline.
+#
+#   ruby bench/run.rb [options]
+#
+#   -o, --output PATH      write results to PATH
+#   -b, --baseline PATH    compare results against baseline at PATH
+#   -t, --threshold FRAC   regression threshold (default: 0.1)
+#   -f, --filter REGEXP    run only benchmarks matching REGEXP
+#   -s, --scale FACTOR     iteration count multiplier (default: 1)
+#   -r, --runs N           runs per benchmark (default: 5)
+#
+# Paths may contain a %{backend} placeholder, which is replaced with the
+# backend kind (io_uring or libev), so that results for each backend are kept
+# separately. To compare against a release, build and run the suite on a
+# checkout of the release, saving its results as the baseline.
+#
+# Exits with status 1 if any regression is found.
+
+require 'bundler/setup'
+require 'optparse'
+require 'fileutils'
+require 'polyphony'
+require 'polyphony/version'
+require_relative 'harness'
+
+Dir.glob("#{__dir__}/benchmarks/*.rb").sort.each { |path| require(path) }
+
+options = { threshold: Bench::THRESHOLD, scale: 1.0, runs: Bench::RUNS }
+OptionParser.new do |o|
+  o.on('-o', '--output PATH') { |v| options[:output] = v }
+  o.on('-b', '--baseline PATH') { |v| options[:baseline] = v }
+  o.on('-t', '--threshold FRAC', Float) { |v| options[:threshold] = v }
+  o.on('-f', '--filter REGEXP') { |v| options[:filter] = Regexp.new(v) }
+  o.on('-s', '--scale FACTOR', Float) { |v| options[:scale] = v }
+  o.on('-r', '--runs N', Integer) { |v| options[:runs] = v }
+end.parse!
+
+backend = Thread.current.backend.kind
+options[:output] &&= format(options[:output], backend: backend)
+options[:baseline] &&= format(options[:baseline], backend: backend)
+
+puts "Polyphony #{Polyphony::VERSION} (#{Thread.current.backend.kind}), #{RUBY_DESCRIPTION}"
+results = Bench.run(filter: options[:filter], scale: options[:scale], runs: options[:runs])
+
+if options[:output]
+  FileUtils.mkdir_p(File.dirname(options[:output]))
+  File.write(options[:output], JSON.pretty_generate(results))
+  puts "Results written to #{options[:output]}"
+end
+
+exit unless options[:baseline]
+
+unless File.file?(options[:baseline])
+  puts "No baseline found at #{options[:baseline]}"
+  exit
+end
+
+baseline = JSON.parse(File.read(options[:baseline]))
+if baseline['meta']['backend'] != results[:meta][:backend].to_s
+  puts "Warning: baseline backend is #{baseline['meta']['backend']}"
+end
+
+puts
+puts format('%-28s %14s %14s %9s', 'benchmark', 'baseline', 'current', 'change')
+entries = Bench.compare(results, baseline, threshold: options[:threshold])
+Bench.print_comparison(entries)
+exit 1 if entries.any? { |e| e[:regression] }
@@ -24,6 +24,15 @@ rescue => e
   # conn << "HTTP/1.1 500\r\nContent-Length: 0\r\n\r\n"
 end
 
+def respond_send_file(conn, path)
+  File.open(path, 'r') do |f|
+    conn << "HTTP/1.1 200\r\nContent-Length: #{f.size}\r\n\r\n"
+    IO.send_file(f, conn)
+  end
+rescue => e
+  p e
+end
+
 def handle_client(conn)
   parser = H1P::Parser.new(conn, :server)
   while true
@@ -33,6 +42,8 @@ def handle_client(conn)
     case headers[':path']
     when /^\/splice\/(.+)$/
       respond_splice(conn, $1)
+    when /^\/send_file\/(.+)$/
+      respond_send_file(conn, $1)
     else
       respond_default(conn)
     end
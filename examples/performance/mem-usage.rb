@@ -54,3 +54,8 @@ calculate_memory_cost('polyphony fiber', 10000) do
   f.await
   f
 end
+
+fibers = 10000.times.map { spin { sleep } }
+snooze
+stats = Polyphony.fiber_stack_stats
+puts "fiber stacks: #{stats[:stacks]} resident: #{stats[:resident] / 1024}KB"
@@ -1,5 +1,13 @@
+#ifdef POLYPHONY_LINUX
+#define _GNU_SOURCE 1
+#endif
+
 #include <time.h>
+#include <string.h>
 #include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 #include "ruby.h"
 #include "ruby/io.h"
 #include "polyphony.h"
@@ -15,22 +23,45 @@ inline void backend_base_initialize(struct Backend_base *base) {
   base->op_count = 0;
   base->switch_count = 0;
   base->poll_count = 0;
+  base->last_op_id = 0;
   base->pending_count = 0;
   base->idle_gc_period = 0;
   base->idle_gc_last_time = 0;
   base->idle_proc = Qnil;
   base->trace_proc = Qnil;
   base->in_trace_proc = 0;
+  trace_buffer_init(&base->trace_buffer);
+  base->trace_ops = 0;
+  base->op_types = NULL;
+  base->op_type_count = 0;
+  base->op_stats = NULL;
+  base->bytes_read = 0;
+  base->bytes_written = 0;
+  memset(base->errno_counts, 0, sizeof(base->errno_counts));
+  base->measure_schedule_delay = 0;
+  histogram_init(&base->schedule_delay);
+  base->heartbeat = 0;
+  stall_detector_init(&base->stall_detector, base);
+  profiler_init(&base->profiler, base);
+  signal_source_init(&base->signal_source);
 }
 
 inline void backend_base_finalize(struct Backend_base *base) {
   runqueue_finalize(&base->runqueue);
   runqueue_finalize(&base->parked_runqueue);
+  trace_buffer_free(&base->trace_buffer);
+  if (base->op_stats) free(base->op_stats);
+  stall_detector_stop(&base->stall_detector);
+  profiler_stop(&base->profiler);
+  signal_source_free(&base->signal_source);
 }
 
 inline void backend_base_mark(struct Backend_base *base) {
   if (base->idle_proc != Qnil) rb_gc_mark(base->idle_proc);
   if (base->trace_proc != Qnil) rb_gc_mark(base->trace_proc);
+  stall_detector_mark(&base->stall_detector);
+  profiler_mark(&base->profiler);
+  signal_source_mark(&base->signal_source);
   runqueue_mark(&base->runqueue);
   runqueue_mark(&base->parked_runqueue);
 }
@@ -51,6 +82,17 @@ void backend_base_reset(struct Backend_base *base) {
   base->idle_gc_last_time = 0;
   base->idle_proc = Qnil;
   base->trace_proc = Qnil;
+  trace_buffer_free(&base->trace_buffer);
+  base->trace_ops = 0;
+  if (base->op_stats) free(base->op_stats);
+  base->op_stats = NULL;
+  base->bytes_read = 0;
+  base->bytes_written = 0;
+  memset(base->errno_counts, 0, sizeof(base->errno_counts));
+  histogram_init(&base->schedule_delay);
+  stall_detector_reset(&base->stall_detector);
+  profiler_reset(&base->profiler);
+  signal_source_post_fork(&base->signal_source);
 }
 
 const unsigned int ANTI_STARVE_SWITCH_COUNT_THRESHOLD = 64;
@@ -85,6 +127,8 @@ VALUE backend_base_switch_fiber(VALUE backend, struct Backend_base *base) {
   unsigned int idle_tasks_run_count = 0;
 
   base->switch_count++;
+  base->heartbeat++;
+  NATIVE_TRACE(base, TRACE_EVENT_BLOCK, current_fiber, 0, -1, 0, 0);
   if (SHOULD_TRACE(base))
     TRACE(base, 3, SYM_block, current_fiber, CALLER());
 
@@ -98,12 +142,14 @@ VALUE backend_base_switch_fiber(VALUE backend, struct Backend_base *base) {
       // any event completions. In order to prevent this, an anti-starvation
       // mechanism is employed, under the following conditions:
       // - a blocking poll was not yet performed
-      // - there are pending blocking operations
+      // - there are pending blocking operations, or trapped signals
       // - the runqueue shift count has reached a fixed threshold (currently 64), or
       // - the next fiber is the same as the current fiber (a single fiber is snoozing)
-      if (!backend_was_polled && pending_ops_count)
+      if (!backend_was_polled && (pending_ops_count || SIGNAL_SOURCE_ACTIVE(&base->signal_source)))
         conditional_nonblocking_poll(backend, base, current_fiber, next.fiber);
 
+      if (next.stamp)
+        histogram_record(&base->schedule_delay, current_time_ns() - next.stamp);
       break;
     }
 
@@ -118,6 +164,8 @@ VALUE backend_base_switch_fiber(VALUE backend, struct Backend_base *base) {
 
   if (next.fiber == Qnil) return Qnil;
 
+  USDT_PROBE2(fiber_switch, current_fiber, next.fiber);
+
   // run next fiber
   rb_ivar_set(next.fiber, ID_ivar_runnable, Qnil);
   RB_GC_GUARD(next.fiber);
@@ -133,11 +181,16 @@ void backend_base_schedule_fiber(VALUE thread, VALUE backend, struct Backend_bas
   if (rb_fiber_alive_p(fiber) != Qtrue) return;
   already_runnable = rb_ivar_get(fiber, ID_ivar_runnable) != Qnil;
 
+  NATIVE_TRACE(base, TRACE_EVENT_SCHEDULE, fiber, 0, -1, prioritize, 0);
+  USDT_PROBE2(fiber_schedule, fiber, prioritize);
   COND_TRACE(base, 5, SYM_schedule, fiber, value, prioritize ? Qtrue : Qfalse, CALLER());
 
   runqueue = rb_ivar_get(fiber, ID_ivar_parked) == Qtrue ? &base->parked_runqueue : &base->runqueue;
 
-  (prioritize ? runqueue_unshift : runqueue_push)(runqueue, fiber, value, already_runnable);
+  (prioritize ? runqueue_unshift : runqueue_push)(
+    runqueue, fiber, value, already_runnable,
+    base->measure_schedule_delay ? current_time_ns() : 0
+  );
   if (!already_runnable) {
     rb_ivar_set(fiber, ID_ivar_runnable, Qtrue);
     if (rb_thread_current() != thread) {
@@ -160,6 +213,13 @@ inline void backend_base_unpark_fiber(struct Backend_base *base, VALUE fiber) {
 }
 
 inline void backend_trace(struct Backend_base *base, int argc, VALUE *argv) {
+  if (argc >= 2) {
+    if (argv[0] == SYM_spin)
+      USDT_PROBE1(fiber_spin, argv[1]);
+    else if (argv[0] == SYM_terminate)
+      USDT_PROBE1(fiber_terminate, argv[1]);
+  }
+
   if (base->trace_proc == Qnil || base->in_trace_proc) return;
 
   base->in_trace_proc = 1;
@@ -167,6 +227,92 @@ inline void backend_trace(struct Backend_base *base, int argc, VALUE *argv) {
   base->in_trace_proc = 0;
 }
 
+VALUE SYM_op_submit;
+VALUE SYM_op_complete;
+VALUE SYM_op_cancel;
+
+// Emits an op event. The trace proc is called with:
+//
+//   [:op_submit, fiber, id, op, fd, len]
+//   [:op_complete, fiber, id, op, fd, result, latency]
+//   [:op_cancel, fiber, id, op, fd, latency]
+//
+// where latency is in nanoseconds. Native trace records carry the same values,
+// with the requested length or op result in the result field.
+void backend_trace_op_event(struct Backend_base *base, struct backend_op_trace *trace, enum trace_event event, int64_t result) {
+  VALUE fiber = rb_fiber_current();
+  uint64_t since = trace->stamp;
+  uint64_t now = current_time_ns();
+
+  if (event == TRACE_EVENT_OP_SUBMIT) trace->stamp = since = now;
+
+  if (base->trace_buffer.enabled)
+    trace_buffer_push(&base->trace_buffer, event, fiber, trace->op, trace->fd, result, event == TRACE_EVENT_OP_SUBMIT ? 0 : since, trace->id);
+
+  if (SHOULD_TRACE(base)) {
+    VALUE id = ULL2NUM(trace->id);
+    VALUE fd = INT2NUM(trace->fd);
+    VALUE op = trace->op < base->op_type_count ?
+      ID2SYM(rb_intern(base->op_types[trace->op].name)) : INT2NUM(trace->op);
+
+    switch (event) {
+      case TRACE_EVENT_OP_SUBMIT:
+        TRACE(base, 6, SYM_op_submit, fiber, id, op, fd, LL2NUM(result));
+        break;
+      case TRACE_EVENT_OP_COMPLETE:
+        TRACE(base, 7, SYM_op_complete, fiber, id, op, fd, LL2NUM(result), ULL2NUM(now - since));
+        break;
+      default:
+        TRACE(base, 6, SYM_op_cancel, fiber, id, op, fd, ULL2NUM(now - since));
+    }
+    RB_GC_GUARD(id);
+    RB_GC_GUARD(op);
+  }
+}
+
+// Enables or disables op events (see backend_trace_op_event).
+VALUE Backend_trace_ops_set(VALUE self, VALUE enabled) {
+  backend_get_base(self)->trace_ops = RTEST(enabled);
+  return self;
+}
+
+#define DEFAULT_TRACE_BUFFER_CAPACITY 65536
+
+VALUE backend_trace_buffer_start(struct Backend_base *base, int argc, VALUE *argv) {
+  VALUE capacity;
+
+  rb_scan_args(argc, argv, "01", &capacity);
+  trace_buffer_start(&base->trace_buffer, NIL_P(capacity) ? DEFAULT_TRACE_BUFFER_CAPACITY : NUM2ULONG(capacity));
+  return Qnil;
+}
+
+// Op events are only emitted while there's a trace consumer, so trace_ops is
+// reset once both the trace buffer and the trace proc are gone. This prevents
+// a stale setting from applying to later, unrelated tracing sessions.
+static inline void backend_trace_ops_release(struct Backend_base *base) {
+  if (!base->trace_buffer.enabled && base->trace_proc == Qnil)
+    base->trace_ops = 0;
+}
+
+inline VALUE backend_trace_buffer_stop(struct Backend_base *base) {
+  trace_buffer_stop(&base->trace_buffer);
+  backend_trace_ops_release(base);
+  return Qnil;
+}
+
+inline void backend_trace_proc_set(struct Backend_base *base, VALUE block) {
+  base->trace_proc = block;
+  backend_trace_ops_release(base);
+}
+
+inline VALUE backend_trace_buffer_read(struct Backend_base *base) {
+  return trace_buffer_read(&base->trace_buffer);
+}
+
+inline VALUE backend_trace_buffer_dropped(struct Backend_base *base) {
+  return ULL2NUM(trace_buffer_dropped(&base->trace_buffer));
+}
+
 #ifdef POLYPHONY_USE_PIDFD_OPEN
 #ifndef __NR_pidfd_open
 #define __NR_pidfd_open 434   /* System call # on most architectures */
@@ -263,12 +409,23 @@ void fptr_finalize(rb_io_t *fptr) {
 //////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////
 
-inline VALUE backend_await(struct Backend_base *backend) {
+// Waits for the given op to complete, switching to the next runnable fiber. The
+// op type and fd are used for profiling, and may be 0 and -1 respectively.
+inline VALUE backend_await(struct Backend_base *backend, unsigned int op, int fd) {
   VALUE ret;
+  uint64_t trace_stamp = NATIVE_TRACE_STAMP(backend);
+  uint64_t profile_stamp = backend->profiler.running ? current_time_ns() : 0;
   backend->pending_count++;
   ret = Thread_switch_fiber(rb_thread_current());
 
+  if (profile_stamp && backend->profiler.running)
+    profiler_record_wait(
+      &backend->profiler, op < backend->op_type_count ? backend->op_types[op].name : NULL,
+      fd, current_time_ns() - profile_stamp
+    );
+
   // run next fiber
+  NATIVE_TRACE(backend, TRACE_EVENT_UNBLOCK, rb_fiber_current(), 0, -1, 0, trace_stamp);
   COND_TRACE(backend, 4, SYM_unblock, rb_fiber_current(), ret, CALLER());
 
   backend->pending_count--;
@@ -280,12 +437,14 @@ inline VALUE backend_snooze(struct Backend_base *backend) {
   VALUE ret;
   VALUE fiber = rb_fiber_current();
   VALUE thread = rb_thread_current();
+  uint64_t trace_stamp = NATIVE_TRACE_STAMP(backend);
 
   CHECK_FIBER_THREAD_REF(fiber, thread);
 
   Fiber_make_runnable(fiber, Qnil);
   ret = Thread_switch_fiber(thread);
 
+  NATIVE_TRACE(backend, TRACE_EVENT_UNBLOCK, fiber, 0, -1, 0, trace_stamp);
   COND_TRACE(backend, 4, SYM_unblock, fiber, ret, CALLER());
 
   return ret;
@@ -344,7 +503,32 @@ VALUE Backend_timeout_ensure_safe(VALUE arg) {
   return rb_rescue2(Backend_timeout_safe, Qnil, Backend_timeout_rescue, Qnil, rb_eException, (VALUE)0);
 }
 
-static VALUE empty_string = Qnil;
+static inline VALUE join_buffer_entry(VALUE ary, long idx) {
+  VALUE buffer = RARRAY_AREF(ary, idx);
+  #ifdef HAVE_RUBY_IO_BUFFER_H
+  if (rb_obj_is_kind_of(buffer, rb_cIOBuffer) == Qtrue) return buffer;
+  #endif
+  return rb_obj_as_string(buffer);
+}
+
+// Concatenates the given strings or IO::Buffer instances into a new string.
+static VALUE backend_join_buffers(VALUE ary) {
+  long count = RARRAY_LEN(ary);
+  long total = 0;
+  VALUE joined;
+
+  for (long i = 0; i < count; i++)
+    total += backend_get_buffer_spec(join_buffer_entry(ary, i), 1).len;
+
+  joined = rb_str_buf_new(total);
+  for (long i = 0; i < count; i++) {
+    VALUE buffer = join_buffer_entry(ary, i);
+    struct backend_buffer_spec spec = backend_get_buffer_spec(buffer, 1);
+    rb_str_buf_cat(joined, (const char *)spec.ptr, spec.len);
+    RB_GC_GUARD(buffer);
+  }
+  return joined;
+}
 
 VALUE Backend_sendv(VALUE self, VALUE io, VALUE ary, VALUE flags) {
   VALUE joined;
@@ -356,11 +540,7 @@ VALUE Backend_sendv(VALUE self, VALUE io, VALUE ary, VALUE flags) {
   case 1:
     return Backend_send(self, io, RARRAY_AREF(ary, 0), flags);
   default:
-    if (empty_string == Qnil) {
-      empty_string = rb_str_new_literal("");
-      rb_global_variable(&empty_string);
-    }
-    joined = rb_ary_join(ary, empty_string);
+    joined = backend_join_buffers(ary);
     result = Backend_send(self, io, joined, flags);
     RB_GC_GUARD(joined);
     return result;
@@ -409,9 +589,11 @@ inline void backend_run_idle_tasks(struct Backend_base *base) {
   if (now - base->idle_gc_last_time < base->idle_gc_period) return;
 
   base->idle_gc_last_time = now;
+  USDT_PROBE0(idle_gc_start);
   rb_gc_enable();
   rb_gc_start();
   rb_gc_disable();
+  USDT_PROBE0(idle_gc_done);
 }
 
 inline struct backend_stats backend_base_stats(struct Backend_base *base) {
@@ -425,12 +607,97 @@ inline struct backend_stats backend_base_stats(struct Backend_base *base) {
     .pending_ops = base->pending_count
   };
 
-  base->op_count = 0;
-  base->switch_count = 0;
-  base->poll_count = 0;
   return stats;
 }
 
+inline void backend_base_setup_op_stats(struct Backend_base *base, const struct backend_op_type *op_types, unsigned int count) {
+  base->op_types = op_types;
+  base->op_type_count = count;
+}
+
+inline void backend_count_error(struct Backend_base *base, int e) {
+  if (e > 0 && e < BACKEND_ERRNO_MAX) base->errno_counts[e]++;
+}
+
+inline void backend_count_bytes(struct Backend_base *base, enum backend_op_dir dir, long bytes) {
+  if (bytes <= 0) return;
+
+  if (dir == BACKEND_OP_DIR_READ)
+    base->bytes_read += bytes;
+  else if (dir == BACKEND_OP_DIR_WRITE)
+    base->bytes_written += bytes;
+}
+
+// Records the completion of an op of the given type. A negative result is
+// treated as an errno value. If since is not zero, the time elapsed since is
+// recorded in the op type's latency histogram. The op stats table is allocated
+// on first use.
+void backend_op_stats_record(struct Backend_base *base, unsigned int op, uint64_t since, int result) {
+  struct backend_op_stats *stats;
+
+  if (op >= base->op_type_count) return;
+  if (!base->op_stats) {
+    base->op_stats = calloc(base->op_type_count, sizeof(struct backend_op_stats));
+    if (!base->op_stats) return;
+  }
+
+  stats = &base->op_stats[op];
+  stats->count++;
+  if (result == -ECANCELED)
+    stats->cancelled++;
+  else if (result < 0) {
+    stats->errors++;
+    backend_count_error(base, -result);
+  }
+  else if (base->op_types[op].dir != BACKEND_OP_DIR_NONE) {
+    stats->bytes += result;
+    backend_count_bytes(base, base->op_types[op].dir, result);
+  }
+  if (since) histogram_record(&stats->latency, current_time_ns() - since);
+}
+
+VALUE SYM_ops;
+VALUE SYM_errors;
+VALUE SYM_cancelled;
+VALUE SYM_bytes;
+VALUE SYM_latency;
+VALUE SYM_bytes_read;
+VALUE SYM_bytes_written;
+VALUE SYM_schedule_delay;
+VALUE SYM_stall_count;
+
+static void backend_op_stats_to_hash(struct Backend_base *base, VALUE stats) {
+  VALUE ops = rb_hash_new();
+  VALUE errors = rb_hash_new();
+
+  for (unsigned int i = 0; base->op_stats && i < base->op_type_count; i++) {
+    struct backend_op_stats *op_stats = &base->op_stats[i];
+    VALUE entry;
+
+    if (!op_stats->count) continue;
+
+    entry = rb_hash_new();
+    rb_hash_aset(entry, SYM_count, ULL2NUM(op_stats->count));
+    rb_hash_aset(entry, SYM_errors, ULL2NUM(op_stats->errors));
+    rb_hash_aset(entry, SYM_cancelled, ULL2NUM(op_stats->cancelled));
+    if (base->op_types[i].dir != BACKEND_OP_DIR_NONE)
+      rb_hash_aset(entry, SYM_bytes, ULL2NUM(op_stats->bytes));
+    rb_hash_aset(entry, SYM_latency, histogram_to_hash(&op_stats->latency));
+    rb_hash_aset(ops, ID2SYM(rb_intern(base->op_types[i].name)), entry);
+  }
+
+  for (int e = 1; e < BACKEND_ERRNO_MAX; e++)
+    if (base->errno_counts[e])
+      rb_hash_aset(errors, INT2FIX(e), ULL2NUM(base->errno_counts[e]));
+
+  rb_hash_aset(stats, SYM_bytes_read, ULL2NUM(base->bytes_read));
+  rb_hash_aset(stats, SYM_bytes_written, ULL2NUM(base->bytes_written));
+  rb_hash_aset(stats, SYM_errors, errors);
+  rb_hash_aset(stats, SYM_ops, ops);
+  RB_GC_GUARD(ops);
+  RB_GC_GUARD(errors);
+}
+
 VALUE SYM_runqueue_size;
 VALUE SYM_runqueue_length;
 VALUE SYM_runqueue_max_length;
@@ -439,6 +706,9 @@ VALUE SYM_switch_count;
 VALUE SYM_poll_count;
 VALUE SYM_pending_ops;
 
+// Returns the backend's statistics. All counters are cumulative 64-bit values
+// and are not reset when read, so stats can be safely sampled by multiple
+// readers (for example a monitoring fiber and a metrics exporter).
 VALUE Backend_stats(VALUE self) {
   struct backend_stats backend_stats = backend_get_stats(self);
 
@@ -446,14 +716,123 @@ VALUE Backend_stats(VALUE self) {
   rb_hash_aset(stats, SYM_runqueue_size, INT2FIX(backend_stats.runqueue_size));
   rb_hash_aset(stats, SYM_runqueue_length, INT2FIX(backend_stats.runqueue_length));
   rb_hash_aset(stats, SYM_runqueue_max_length, INT2FIX(backend_stats.runqueue_max_length));
-  rb_hash_aset(stats, SYM_op_count, INT2FIX(backend_stats.op_count));
-  rb_hash_aset(stats, SYM_switch_count, INT2FIX(backend_stats.switch_count));
-  rb_hash_aset(stats, SYM_poll_count, INT2FIX(backend_stats.poll_count));
+  rb_hash_aset(stats, SYM_op_count, ULL2NUM(backend_stats.op_count));
+  rb_hash_aset(stats, SYM_switch_count, ULL2NUM(backend_stats.switch_count));
+  rb_hash_aset(stats, SYM_poll_count, ULL2NUM(backend_stats.poll_count));
   rb_hash_aset(stats, SYM_pending_ops, INT2FIX(backend_stats.pending_ops));
+  backend_op_stats_to_hash(backend_get_base(self), stats);
+  rb_hash_aset(stats, SYM_schedule_delay, histogram_to_hash(&backend_get_base(self)->schedule_delay));
+  rb_hash_aset(stats, SYM_stall_count, ULL2NUM(backend_get_base(self)->stall_detector.count));
   RB_GC_GUARD(stats);
   return stats;
 }
 
+// Enables or disables measuring the schedule-to-run delay of fibers, that is
+// the time elapsed between a fiber being put on the runqueue and the fiber
+// being resumed. Measurements are summarized in the stats' :schedule_delay
+// entry.
+VALUE Backend_measure_schedule_delay_set(VALUE self, VALUE flag) {
+  backend_get_base(self)->measure_schedule_delay = RTEST(flag);
+  return flag;
+}
+
+// Starts the stall detector, which records an event whenever the backend's
+// thread runs for longer than the given threshold (in seconds, default 0.05)
+// without switching fibers or polling. Must be called on the backend's thread.
+VALUE Backend_stall_detector_start(int argc, VALUE *argv, VALUE self) {
+  VALUE threshold;
+
+  rb_scan_args(argc, argv, "01", &threshold);
+  stall_detector_start(&backend_get_base(self)->stall_detector, NIL_P(threshold) ? 0.05 : NUM2DBL(threshold));
+  return self;
+}
+
+VALUE Backend_stall_detector_stop(VALUE self) {
+  stall_detector_stop(&backend_get_base(self)->stall_detector);
+  return self;
+}
+
+// Returns the stall events recorded since the last call, as an array of hashes
+// containing the stalled fiber, its tag, its backtrace and the stall duration.
+VALUE Backend_stall_events(VALUE self) {
+  return stall_detector_events(&backend_get_base(self)->stall_detector);
+}
+
+// Starts the profiler, sampling the running fiber's stack at the given
+// interval (in seconds, default 0.001), and recording the stack of each fiber
+// waiting for an op to complete. Must be called on the backend's thread.
+VALUE Backend_profile_start(int argc, VALUE *argv, VALUE self) {
+  VALUE interval;
+
+  rb_scan_args(argc, argv, "01", &interval);
+  profiler_start(&backend_get_base(self)->profiler, NIL_P(interval) ? 0.001 : NUM2DBL(interval));
+  return self;
+}
+
+VALUE Backend_profile_stop(VALUE self) {
+  profiler_stop(&backend_get_base(self)->profiler);
+  return self;
+}
+
+// Returns the profile collected since the profiler was started or since the
+// last call, as a hash with :on_cpu and :off_cpu entries mapping collapsed
+// stacks to weights in microseconds.
+VALUE Backend_profile_result(VALUE self) {
+  return profiler_result(&backend_get_base(self)->profiler);
+}
+
+// Sets the handler for the given signal number, delivering the signal through
+// the backend's signalfd. The signal is blocked in the current thread, which
+// should normally be the main thread. A nil handler removes the signal from
+// the signalfd and unblocks it. Returns the previous handler.
+VALUE Backend_signalfd_trap(VALUE self, VALUE signo, VALUE handler) {
+  struct Backend_base *base = backend_get_base(self);
+  VALUE prev = signal_source_trap(&base->signal_source, NUM2INT(signo), handler);
+
+  if (SIGNAL_SOURCE_ACTIVE(&base->signal_source)) backend_watch_signal_source(self);
+  return prev;
+}
+
+// Runs a read loop with an optional reuse_buffer argument (see
+// backend_reuse_read_buffer).
+VALUE Backend_read_loop_m(int argc, VALUE *argv, VALUE self) {
+  VALUE io, maxlen, reuse;
+
+  rb_scan_args(argc, argv, "21", &io, &maxlen, &reuse);
+  return Backend_read_loop(self, io, maxlen, reuse);
+}
+
+// Runs a recv loop with an optional reuse_buffer argument (see
+// backend_reuse_read_buffer).
+VALUE Backend_recv_loop_m(int argc, VALUE *argv, VALUE self) {
+  VALUE io, maxlen, reuse;
+
+  rb_scan_args(argc, argv, "21", &io, &maxlen, &reuse);
+  return Backend_recv_loop(self, io, maxlen, reuse);
+}
+
+// Reaps the children with the given pids that have terminated, returning an
+// array of [pid, exit_status] pairs. A child that was already reaped elsewhere
+// is returned with a nil exit status.
+VALUE backend_reap_children(VALUE pids) {
+  VALUE result = rb_ary_new();
+
+  for (long i = 0; i < RARRAY_LEN(pids); i++) {
+    int pid = NUM2INT(RARRAY_AREF(pids, i));
+    int status = 0;
+    pid_t ret = waitpid(pid, &status, WNOHANG);
+
+    if (ret == pid)
+      rb_ary_push(result, rb_ary_new_from_args(2, INT2FIX(pid), INT2FIX(WEXITSTATUS(status))));
+    else if (ret < 0) {
+      int e = errno;
+      if (e != ECHILD) rb_syserr_fail(e, strerror(e));
+      rb_ary_push(result, rb_ary_new_from_args(2, INT2FIX(pid), Qnil));
+    }
+  }
+  return result;
+}
+
 VALUE Backend_verify_blocking_mode(VALUE self, VALUE io, VALUE blocking) {
   rb_io_t *fptr;
   GetOpenFile(io, fptr);
@@ -477,6 +856,41 @@ void backend_setup_stats_symbols(void) {
   rb_global_variable(&SYM_switch_count);
   rb_global_variable(&SYM_poll_count);
   rb_global_variable(&SYM_pending_ops);
+
+  SYM_ops                 = ID2SYM(rb_intern("ops"));
+  SYM_errors              = ID2SYM(rb_intern("errors"));
+  SYM_cancelled           = ID2SYM(rb_intern("cancelled"));
+  SYM_bytes               = ID2SYM(rb_intern("bytes"));
+  SYM_latency             = ID2SYM(rb_intern("latency"));
+  SYM_bytes_read          = ID2SYM(rb_intern("bytes_read"));
+  SYM_bytes_written       = ID2SYM(rb_intern("bytes_written"));
+
+  rb_global_variable(&SYM_ops);
+  rb_global_variable(&SYM_errors);
+  rb_global_variable(&SYM_cancelled);
+  rb_global_variable(&SYM_bytes);
+  rb_global_variable(&SYM_latency);
+  rb_global_variable(&SYM_bytes_read);
+  rb_global_variable(&SYM_bytes_written);
+
+  SYM_schedule_delay      = ID2SYM(rb_intern("schedule_delay"));
+  rb_global_variable(&SYM_schedule_delay);
+
+  SYM_stall_count         = ID2SYM(rb_intern("stall_count"));
+  rb_global_variable(&SYM_stall_count);
+
+  SYM_op_submit           = ID2SYM(rb_intern("op_submit"));
+  SYM_op_complete         = ID2SYM(rb_intern("op_complete"));
+  SYM_op_cancel           = ID2SYM(rb_intern("op_cancel"));
+
+  rb_global_variable(&SYM_op_submit);
+  rb_global_variable(&SYM_op_complete);
+  rb_global_variable(&SYM_op_cancel);
+
+  stall_detector_setup();
+  profiler_setup();
+
+  histogram_setup_symbols();
 }
 
 int backend_getaddrinfo(VALUE host, VALUE port, struct sockaddr **ai_addr) {
@@ -531,10 +945,137 @@ inline VALUE name_to_addrinfo(void *name, socklen_t len) {
   return Qnil;
 }
 
+// Builds a control message buffer from the given array of [level, type, data]
+// tuples. Returns nil if no controls are given.
+VALUE backend_build_cmsgs(VALUE controls) {
+  if (NIL_P(controls)) return Qnil;
+  Check_Type(controls, T_ARRAY);
+
+  long count = RARRAY_LEN(controls);
+  if (!count) return Qnil;
+
+  long total = 0;
+  for (long i = 0; i < count; i++) {
+    VALUE control = RARRAY_AREF(controls, i);
+    Check_Type(control, T_ARRAY);
+    if (RARRAY_LEN(control) != 3)
+      rb_raise(rb_eArgError, "expected control message as [level, type, data]");
+
+    NUM2INT(RARRAY_AREF(control, 0));
+    NUM2INT(RARRAY_AREF(control, 1));
+    Check_Type(RARRAY_AREF(control, 2), T_STRING);
+    total += CMSG_SPACE(RSTRING_LEN(RARRAY_AREF(control, 2)));
+  }
+
+  VALUE buffer = rb_str_buf_new(total);
+  memset(RSTRING_PTR(buffer), 0, total);
+  rb_str_set_len(buffer, total);
+
+  struct msghdr msg = { .msg_control = RSTRING_PTR(buffer), .msg_controllen = total };
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  for (long i = 0; i < count; i++) {
+    VALUE control = RARRAY_AREF(controls, i);
+    VALUE data = RARRAY_AREF(control, 2);
+    long len = RSTRING_LEN(data);
+
+    cmsg->cmsg_level = NUM2INT(RARRAY_AREF(control, 0));
+    cmsg->cmsg_type = NUM2INT(RARRAY_AREF(control, 1));
+    cmsg->cmsg_len = CMSG_LEN(len);
+    memcpy(CMSG_DATA(cmsg), RSTRING_PTR(data), len);
+    cmsg = CMSG_NXTHDR(&msg, cmsg);
+  }
+  return buffer;
+}
+
+// Appends the control messages received in the given message header to the
+// given array, as [level, type, data] tuples.
+void backend_push_cmsgs(VALUE ary, struct msghdr *msg) {
+  if (!msg->msg_control) return;
+
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    VALUE data = rb_str_new((char *)CMSG_DATA(cmsg), cmsg->cmsg_len - CMSG_LEN(0));
+    rb_ary_push(ary, rb_ary_new_from_args(3, INT2NUM(cmsg->cmsg_level), INT2NUM(cmsg->cmsg_type), data));
+    RB_GC_GUARD(data);
+  }
+}
+
+#ifdef POLYPHONY_LINUX
+// Sets up up to `count` message headers for receiving datagrams, each into its
+// own `maxlen`-sized slot of the buffer pointed to by `ptr`.
+void backend_recv_batch_prepare(struct mmsghdr *msgs, struct iovec *iovs, struct sockaddr_storage *addrs, char *ptr, int count, int maxlen) {
+  for (int i = 0; i < count; i++) {
+    iovs[i].iov_base = ptr + (long)i * maxlen;
+    iovs[i].iov_len = maxlen;
+
+    msgs[i].msg_hdr.msg_name = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_hdr.msg_control = 0;
+    msgs[i].msg_hdr.msg_controllen = 0;
+    msgs[i].msg_hdr.msg_flags = 0;
+    msgs[i].msg_len = 0;
+  }
+}
+
+// Converts the first `received` datagrams into an array of [payload, addr]
+// pairs.
+VALUE backend_recv_batch_result(struct mmsghdr *msgs, int received) {
+  VALUE result = rb_ary_new_capa(received);
+  for (int i = 0; i < received; i++) {
+    struct msghdr *hdr = &msgs[i].msg_hdr;
+    VALUE payload = rb_str_new(hdr->msg_iov->iov_base, msgs[i].msg_len);
+    VALUE addr = hdr->msg_namelen ? name_to_addrinfo(hdr->msg_name, hdr->msg_namelen) : Qnil;
+    rb_ary_push(result, rb_ary_new_from_args(2, payload, addr));
+    RB_GC_GUARD(payload);
+    RB_GC_GUARD(addr);
+  }
+  return result;
+}
+
+// Sets up message headers for sending the datagrams starting at `offset`.
+// Each datagram is either a string, or a [string, dest_sockaddr] pair. Returns
+// the number of message headers prepared (up to BACKEND_BATCH_MAX).
+int backend_send_batch_prepare(struct mmsghdr *msgs, struct iovec *iovs, VALUE datagrams, long offset) {
+  long left = RARRAY_LEN(datagrams) - offset;
+  int count = left > BACKEND_BATCH_MAX ? BACKEND_BATCH_MAX : (int)left;
+
+  for (int i = 0; i < count; i++) {
+    VALUE datagram = RARRAY_AREF(datagrams, offset + i);
+    VALUE dest = Qnil;
+    if (TYPE(datagram) == T_ARRAY) {
+      dest = rb_ary_entry(datagram, 1);
+      datagram = rb_ary_entry(datagram, 0);
+    }
+    Check_Type(datagram, T_STRING);
+
+    iovs[i].iov_base = RSTRING_PTR(datagram);
+    iovs[i].iov_len = RSTRING_LEN(datagram);
+
+    if (dest != Qnil) {
+      Check_Type(dest, T_STRING);
+      msgs[i].msg_hdr.msg_name = RSTRING_PTR(dest);
+      msgs[i].msg_hdr.msg_namelen = RSTRING_LEN(dest);
+    }
+    else {
+      msgs[i].msg_hdr.msg_name = 0;
+      msgs[i].msg_hdr.msg_namelen = 0;
+    }
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_hdr.msg_control = 0;
+    msgs[i].msg_hdr.msg_controllen = 0;
+    msgs[i].msg_hdr.msg_flags = 0;
+    msgs[i].msg_len = 0;
+  }
+  return count;
+}
+#endif
+
 inline struct backend_buffer_spec backend_get_buffer_spec(VALUE in, int rw) {
   if (FIXNUM_P(in)) {
     struct buffer_spec *spec = FIX2PTR(in);
-    return (struct backend_buffer_spec){ spec->ptr, spec->len, 1 };
+    return (struct backend_buffer_spec){ .ptr = spec->ptr, .len = spec->len, .raw = 1, .fixed = spec->fixed };
   }
 
   #ifdef HAVE_RUBY_IO_BUFFER_H
@@ -597,12 +1138,147 @@ inline void backend_finalize_string_buffer(VALUE buffer, struct backend_buffer_s
   if (fptr) io_enc_str(buffer, fptr);
 }
 
+// Sets up an iovec for each of the given buffers for a vectored read. String
+// buffers are filled starting at their current length up to their capacity,
+// or up to maxlen bytes if given (String capacity is rounded up by Ruby, so
+// it may exceed the requested capacity), IO::Buffer instances are filled from
+// their start. Any other buffer type raises a TypeError. Returns the number of
+// iovecs prepared.
+int backend_prepare_readv(VALUE buffers, VALUE maxlen, struct iovec *iovs) {
+  long count;
+  long max = NIL_P(maxlen) ? -1 : NUM2LONG(maxlen);
+
+  Check_Type(buffers, T_ARRAY);
+  count = RARRAY_LEN(buffers);
+  if (count < 1 || count > BACKEND_READV_MAX)
+    rb_raise(rb_eArgError, "expected 1 to %d buffers", BACKEND_READV_MAX);
+
+  for (long i = 0; i < count; i++) {
+    VALUE buffer = RARRAY_AREF(buffers, i);
+    if (TYPE(buffer) == T_STRING) {
+      long len = RSTRING_LEN(buffer);
+      rb_str_modify(buffer);
+      iovs[i].iov_base = RSTRING_PTR(buffer) + len;
+      iovs[i].iov_len = rb_str_capacity(buffer) - len;
+      if (max >= 0 && (long)iovs[i].iov_len > max - len)
+        iovs[i].iov_len = max > len ? max - len : 0;
+    }
+#ifdef HAVE_RUBY_IO_BUFFER_H
+    else if (rb_obj_is_kind_of(buffer, rb_cIOBuffer) == Qtrue) {
+      struct backend_buffer_spec spec = backend_get_buffer_spec(buffer, 0);
+      iovs[i].iov_base = spec.ptr;
+      iovs[i].iov_len = spec.len;
+    }
+#endif
+    else
+      rb_raise(rb_eTypeError, "expected String or IO::Buffer, got %s", rb_obj_classname(buffer));
+  }
+  return (int)count;
+}
+
+// Distributes the total number of bytes read by a vectored read over the given
+// buffers, adjusting the length of String buffers accordingly.
+void backend_finalize_readv(VALUE buffers, struct iovec *iovs, long total) {
+  long count = RARRAY_LEN(buffers);
+  for (long i = 0; i < count && total > 0; i++) {
+    VALUE buffer = RARRAY_AREF(buffers, i);
+    long len = (size_t)total < iovs[i].iov_len ? total : (long)iovs[i].iov_len;
+    if (TYPE(buffer) == T_STRING)
+      rb_str_set_len(buffer, RSTRING_LEN(buffer) + len);
+    total -= len;
+  }
+}
+
+struct fixed_buffer_ctx {
+  VALUE backend;
+  struct buffer_spec spec;
+};
+
+static VALUE fixed_buffer_yield(VALUE arg) {
+  struct fixed_buffer_ctx *ctx = (struct fixed_buffer_ctx *)arg;
+  return rb_yield(PTR2FIX(&ctx->spec));
+}
+
+static VALUE fixed_buffer_release(VALUE arg) {
+  struct fixed_buffer_ctx *ctx = (struct fixed_buffer_ctx *)arg;
+  Backend_release_fixed_buffer(ctx->backend, &ctx->spec);
+  return Qnil;
+}
+
+VALUE Backend_with_fixed_buffer(VALUE self, VALUE size) {
+  struct fixed_buffer_ctx ctx = { self };
+  int len = FIX2INT(size);
+  if (len <= 0) rb_raise(rb_eArgError, "buffer size must be positive");
+
+  Backend_acquire_fixed_buffer(self, len, &ctx.spec);
+  return rb_ensure(fixed_buffer_yield, (VALUE)&ctx, fixed_buffer_release, (VALUE)&ctx);
+}
+
 VALUE coerce_io_string_or_buffer(VALUE buf) {
   switch (TYPE(buf)) {
     case T_STRING:
     case T_FIXNUM:
       return buf;
     default:
+      #ifdef HAVE_RUBY_IO_BUFFER_H
+      if (rb_obj_is_kind_of(buf, rb_cIOBuffer) == Qtrue) return buf;
+      #endif
       return StringValue(buf);
   }
 }
+
+// Returns the IO::Buffer passed to a read loop in place of the maximum read
+// length, or Qnil if the maximum read length is given.
+VALUE backend_read_loop_io_buffer(VALUE maxlen) {
+  if (FIXNUM_P(maxlen)) return Qnil;
+
+  #ifdef HAVE_RUBY_IO_BUFFER_H
+  if (rb_obj_is_kind_of(maxlen, rb_cIOBuffer) == Qtrue) return maxlen;
+  #endif
+  rb_raise(rb_eTypeError, "expected Integer or IO::Buffer");
+}
+
+static ID ID_slice = 0;
+
+// Returns a slice of the given IO::Buffer, starting at offset 0.
+VALUE backend_io_buffer_slice(VALUE buffer, long len) {
+  if (!ID_slice) ID_slice = rb_intern("slice");
+  return rb_funcall(buffer, ID_slice, 2, INT2FIX(0), LONG2NUM(len));
+}
+
+// Set to poison reused read buffers after each chunk, in order to detect
+// consumers that retain chunks (see `Polyphony.poison_reused_buffers=`).
+int backend_poison_reused_buffers = 0;
+
+#define READ_BUFFER_POISON 0xDB
+
+// Prepares the buffer of a read loop that reuses its buffer for reading the
+// next chunk of up to len bytes. The buffer is reallocated only if it is too
+// small, which may happen if the consumer has cleared or replaced its content.
+// A string that was shared by the consumer (e.g. using String#dup) is made
+// independent before being read into, so copies of a chunk remain valid. A
+// new buffer is allocated if the consumer has frozen the buffer.
+//
+// When poisoning is enabled, the previous chunk is overwritten with poison
+// bytes and frozen, and a new buffer is allocated instead. A consumer that
+// retains chunks will then see poisoned data, or fail when modifying them.
+VALUE backend_reuse_read_buffer(VALUE buffer, long len) {
+  if (buffer != Qnil && backend_poison_reused_buffers) {
+    if (!OBJ_FROZEN(buffer)) {
+      rb_str_modify(buffer);
+      memset(RSTRING_PTR(buffer), READ_BUFFER_POISON, RSTRING_LEN(buffer));
+      rb_obj_freeze(buffer);
+    }
+    buffer = Qnil;
+  }
+  if (buffer == Qnil || OBJ_FROZEN(buffer)) {
+    buffer = Qnil;
+    io_setstrbuf(&buffer, len);
+    return buffer;
+  }
+
+  rb_str_modify(buffer);
+  if ((long)rb_str_capacity(buffer) < len)
+    rb_str_modify_expand(buffer, len - RSTRING_LEN(buffer));
+  return buffer;
+}
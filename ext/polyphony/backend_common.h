@@ -9,30 +9,79 @@
 #include "ruby.h"
 #include "ruby/io.h"
 #include "runqueue.h"
+#include "trace_buffer.h"
+#include "histogram.h"
+#include "stall_detector.h"
+#include "profiler.h"
+#include "signal_source.h"
+#include "probes.h"
 
 struct backend_stats {
   unsigned int runqueue_size;
   unsigned int runqueue_length;
   unsigned int runqueue_max_length;
-  unsigned int op_count;
-  unsigned int switch_count;
-  unsigned int poll_count;
+  uint64_t op_count;
+  uint64_t switch_count;
+  uint64_t poll_count;
   unsigned int pending_ops;
 };
 
+// Per-op statistics. Each backend defines its own set of op types, described by
+// an array of backend_op_type entries indexed by op type. All counters are
+// cumulative and are not reset when read.
+
+enum backend_op_dir {
+  BACKEND_OP_DIR_NONE,
+  BACKEND_OP_DIR_READ,
+  BACKEND_OP_DIR_WRITE
+};
+
+struct backend_op_type {
+  const char *name;
+  enum backend_op_dir dir;
+};
+
+struct backend_op_stats {
+  uint64_t count;
+  uint64_t errors;
+  uint64_t cancelled;
+  uint64_t bytes;
+  histogram_t latency;
+};
+
+#define BACKEND_ERRNO_MAX 160
+
 struct Backend_base {
   runqueue_t runqueue;
   runqueue_t parked_runqueue;
   unsigned int currently_polling;
-  unsigned int op_count;
-  unsigned int switch_count;
-  unsigned int poll_count;
+  uint64_t op_count;
+  uint64_t switch_count;
+  uint64_t poll_count;
+  uint64_t last_op_id;
   unsigned int pending_count;
   double idle_gc_period;
   double idle_gc_last_time;
   VALUE idle_proc;
   VALUE trace_proc;
   unsigned int in_trace_proc;
+  trace_buffer trace_buffer;
+  int trace_ops;
+
+  const struct backend_op_type *op_types;
+  unsigned int op_type_count;
+  struct backend_op_stats *op_stats;
+  uint64_t bytes_read;
+  uint64_t bytes_written;
+  uint64_t errno_counts[BACKEND_ERRNO_MAX];
+
+  int measure_schedule_delay;
+  histogram_t schedule_delay;
+
+  volatile unsigned int heartbeat;
+  stall_detector_t stall_detector;
+  profiler_t profiler;
+  signal_source_t signal_source;
 };
 
 void backend_base_initialize(struct Backend_base *base);
@@ -45,6 +94,10 @@ void backend_base_park_fiber(struct Backend_base *base, VALUE fiber);
 void backend_base_unpark_fiber(struct Backend_base *base, VALUE fiber);
 void backend_trace(struct Backend_base *base, int argc, VALUE *argv);
 struct backend_stats backend_base_stats(struct Backend_base *base);
+void backend_base_setup_op_stats(struct Backend_base *base, const struct backend_op_type *op_types, unsigned int count);
+void backend_op_stats_record(struct Backend_base *base, unsigned int op, uint64_t since, int result);
+void backend_count_error(struct Backend_base *base, int e);
+void backend_count_bytes(struct Backend_base *base, enum backend_op_dir dir, long bytes);
 
 // tracing
 #define SHOULD_TRACE(base) ((base)->trace_proc != Qnil && !(base)->in_trace_proc)
@@ -55,11 +108,64 @@ struct backend_stats backend_base_stats(struct Backend_base *base);
 }
 #define COND_TRACE(base, ...) if (SHOULD_TRACE(base)) { TRACE(base, __VA_ARGS__); }
 
+// Op tracing. An op is traced from its submission to its completion or
+// cancellation, with all events carrying the op id and fd. When enabled (using
+// Backend#trace_ops=), op events are emitted both to the native trace buffer
+// and to the trace proc. The setting is cleared once neither is active.
+// Otherwise, tracing an op costs a single check, and nothing is allocated.
+// Since the trace proc is not called while it is already running, it can
+// safely perform I/O.
+struct backend_op_trace {
+  uint64_t id;    // op id, or 0 if the op is not traced
+  uint64_t stamp;
+  unsigned int op;
+  int fd;
+};
+
+#define OP_TRACE_ENABLED(base) \
+  ((base)->trace_ops && ((base)->trace_buffer.enabled || SHOULD_TRACE(base)))
+
+void backend_trace_op_event(struct Backend_base *base, struct backend_op_trace *trace, enum trace_event event, int64_t result);
+
+// Starts tracing an op. If the given id is 0, an id is assigned to the op.
+static inline void backend_trace_op_submit(
+  struct Backend_base *base, struct backend_op_trace *trace, uint64_t id,
+  unsigned int op, int fd, int64_t len
+) {
+  trace->id = 0;
+  if (!OP_TRACE_ENABLED(base)) return;
+
+  trace->id = id ? id : ++base->last_op_id;
+  trace->op = op;
+  trace->fd = fd;
+  backend_trace_op_event(base, trace, TRACE_EVENT_OP_SUBMIT, len);
+}
+
+// Finishes tracing an op, with either its result (a length or a negated errno)
+// or its cancellation.
+static inline void backend_trace_op_done(
+  struct Backend_base *base, struct backend_op_trace *trace, int64_t result,
+  int cancelled
+) {
+  if (!trace->id) return;
+
+  backend_trace_op_event(base, trace, cancelled ? TRACE_EVENT_OP_CANCEL : TRACE_EVENT_OP_COMPLETE, result);
+  trace->id = 0;
+}
+
+VALUE backend_trace_buffer_start(struct Backend_base *base, int argc, VALUE *argv);
+VALUE backend_trace_buffer_stop(struct Backend_base *base);
+void backend_trace_proc_set(struct Backend_base *base, VALUE block);
+VALUE backend_trace_buffer_read(struct Backend_base *base);
+VALUE backend_trace_buffer_dropped(struct Backend_base *base);
+VALUE Backend_trace_ops_set(VALUE self, VALUE enabled);
+
 // buffers
 
 struct buffer_spec {
   unsigned char *ptr;
   int len;
+  int fixed; // registered buffer index + 1, or 0 if not a registered buffer
 };
 
 struct backend_buffer_spec {
@@ -67,11 +173,17 @@ struct backend_buffer_spec {
   int len;
   int raw;
   int pos;
+  int fixed;
   int expandable:1;
   int shrinkable:1;
   int reserved:30;
 };
 
+// fixed (registered) buffers, implemented by each backend
+
+void Backend_acquire_fixed_buffer(VALUE self, int len, struct buffer_spec *spec);
+void Backend_release_fixed_buffer(VALUE self, struct buffer_spec *spec);
+
 #define FIX2PTR(v) ((void *)(FIX2LONG(v)))
 #define PTR2FIX(p) LONG2FIX((long)p)
 
@@ -82,10 +194,37 @@ void backend_finalize_string_buffer(VALUE buffer, struct backend_buffer_spec *bu
 
 VALUE coerce_io_string_or_buffer(VALUE buf);
 
+// vectored reads
+
+#define BACKEND_READV_MAX 64
+
+struct iovec;
+
+int backend_prepare_readv(VALUE buffers, VALUE maxlen, struct iovec *iovs);
+void backend_finalize_readv(VALUE buffers, struct iovec *iovs, long total);
+
 #ifdef POLYPHONY_USE_PIDFD_OPEN
 int pidfd_open(pid_t pid, unsigned int flags);
 #endif
 
+// control messages
+
+VALUE backend_build_cmsgs(VALUE controls);
+void backend_push_cmsgs(VALUE ary, struct msghdr *msg);
+
+// batched datagram I/O
+
+#ifdef POLYPHONY_LINUX
+#define BACKEND_BATCH_MAX 64
+
+struct mmsghdr;
+struct iovec;
+
+void backend_recv_batch_prepare(struct mmsghdr *msgs, struct iovec *iovs, struct sockaddr_storage *addrs, char *ptr, int count, int maxlen);
+VALUE backend_recv_batch_result(struct mmsghdr *msgs, int received);
+int backend_send_batch_prepare(struct mmsghdr *msgs, struct iovec *iovs, VALUE datagrams, long offset);
+#endif
+
 //////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////
 // the following is copied verbatim from the Ruby source code (io.c)
@@ -109,7 +248,9 @@ void fptr_finalize(rb_io_t *fptr);
 //////////////////////////////////////////////////////////////////////
 
 struct backend_stats backend_get_stats(VALUE self);
-VALUE backend_await(struct Backend_base *backend);
+struct Backend_base *backend_get_base(VALUE self);
+void backend_watch_signal_source(VALUE self);
+VALUE backend_await(struct Backend_base *backend, unsigned int op, int fd);
 VALUE backend_snooze(struct Backend_base *backend);
 
 // macros for doing read loops
@@ -134,6 +275,55 @@ VALUE backend_snooze(struct Backend_base *backend);
   READ_LOOP_PREPARE_STR(); \
 }
 
+// When reusing the read buffer, the same string is read into and yielded for
+// each chunk, and is never shrunk, so that it can hold the next chunk without
+// being reallocated (see backend_reuse_read_buffer).
+#define READ_LOOP_REUSE_STR() { \
+  buffer = backend_reuse_read_buffer(buffer, len); \
+  shrinkable = 0; \
+  ptr = RSTRING_PTR(buffer); \
+  total = 0; \
+}
+
+// When given an IO::Buffer instead of a maximum length, read loops read into
+// the buffer and yield a slice of it for each chunk, without allocating a new
+// string per chunk.
+#define READ_LOOP_PREPARE() { \
+  if (io_buffer != Qnil) { \
+    struct backend_buffer_spec spec = backend_get_buffer_spec(io_buffer, 0); \
+    buffer = io_buffer; \
+    ptr = (char *)spec.ptr; \
+    len = spec.len; \
+    shrinkable = 0; \
+    total = 0; \
+  } \
+  else if (RTEST(reuse)) { \
+    buffer = Qnil; \
+    READ_LOOP_REUSE_STR(); \
+  } \
+  else READ_LOOP_PREPARE_STR() \
+}
+
+#define READ_LOOP_YIELD() { \
+  if (io_buffer != Qnil) { \
+    rb_yield(backend_io_buffer_slice(io_buffer, total)); \
+    READ_LOOP_PREPARE(); \
+  } \
+  else if (RTEST(reuse)) { \
+    io_set_read_length(buffer, total, shrinkable); \
+    if (fptr) io_enc_str(buffer, fptr); \
+    rb_yield(buffer); \
+    READ_LOOP_REUSE_STR(); \
+  } \
+  else READ_LOOP_YIELD_STR() \
+}
+
+VALUE backend_read_loop_io_buffer(VALUE maxlen);
+VALUE backend_io_buffer_slice(VALUE buffer, long len);
+VALUE backend_reuse_read_buffer(VALUE buffer, long len);
+
+extern int backend_poison_reused_buffers;
+
 void rectify_io_file_pos(rb_io_t *fptr);
 double current_time();
 uint64_t current_time_ns();
@@ -142,6 +332,15 @@ VALUE Backend_timeout_ensure_safe(VALUE arg);
 VALUE Backend_timeout_ensure_safe(VALUE arg);
 VALUE Backend_sendv(VALUE self, VALUE io, VALUE ary, VALUE flags);
 VALUE Backend_stats(VALUE self);
+VALUE Backend_measure_schedule_delay_set(VALUE self, VALUE flag);
+VALUE Backend_stall_detector_start(int argc, VALUE *argv, VALUE self);
+VALUE Backend_stall_detector_stop(VALUE self);
+VALUE Backend_stall_events(VALUE self);
+VALUE Backend_profile_start(int argc, VALUE *argv, VALUE self);
+VALUE Backend_profile_stop(VALUE self);
+VALUE Backend_profile_result(VALUE self);
+VALUE Backend_signalfd_trap(VALUE self, VALUE signo, VALUE handler);
+VALUE backend_reap_children(VALUE pids);
 VALUE Backend_verify_blocking_mode(VALUE self, VALUE io, VALUE blocking);
 void backend_run_idle_tasks(struct Backend_base *base);
 void set_fd_blocking_mode(int fd, int blocking);
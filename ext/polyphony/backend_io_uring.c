@@ -1,5 +1,7 @@
 #ifdef POLYPHONY_BACKEND_LIBURING
 
+#define _GNU_SOURCE 1
+
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
@@ -11,6 +13,7 @@
 #include <sys/types.h>
 #include <sys/eventfd.h>
 #include <sys/wait.h>
+#include <fcntl.h>
 #include <errno.h>
 
 #include "polyphony.h"
@@ -33,6 +36,27 @@ VALUE eArgumentError;
 #define io_unset_nonblock(fptr, io)
 #endif
 
+// Registered buffers are allocated as a single region, split into equally
+// sized slots. A slot whose buffer was used by an op that was interrupted
+// before completing is retired, since the kernel may still write to it. The
+// slot is reclaimed once the op's completion arrives, becoming free if the
+// buffer has been released in the meantime.
+#define FIXED_BUFFER_COUNT  16
+#define FIXED_BUFFER_SIZE   (1 << 16)
+
+enum fixed_buffer_state {
+  FIXED_BUFFER_FREE,
+  FIXED_BUFFER_TAKEN,
+  FIXED_BUFFER_RETIRED,         // taken, op still in flight
+  FIXED_BUFFER_RETIRED_RELEASED // released, op still in flight
+};
+
+typedef struct fixed_buffers {
+  unsigned char *base;
+  int           registered; // 1 if registered, -1 if registration failed
+  char          state[FIXED_BUFFER_COUNT];
+} fixed_buffers_t;
+
 typedef struct Backend_t {
   struct Backend_base base;
 
@@ -45,6 +69,10 @@ typedef struct Backend_t {
 
   int                 event_fd;
   op_context_t        *event_fd_ctx;
+  op_context_t        *signal_ctx;
+
+  int                 splice_pipe[2];
+  fixed_buffers_t     fixed_buffers;
 } Backend_t;
 
 static void Backend_mark(void *ptr) {
@@ -77,15 +105,40 @@ static VALUE Backend_allocate(VALUE klass) {
 #define GetBackend(obj, backend) \
   TypedData_Get_Struct((obj), Backend_t, &Backend_type, (backend))
 
+// Op stats are recorded by op type, measuring the time from op submission to
+// completion.
+static const struct backend_op_type io_uring_op_types[OP_WRITE + 1] = {
+  [OP_ACCEPT]           = { "accept",           BACKEND_OP_DIR_NONE },
+  [OP_CHAIN]            = { "chain",            BACKEND_OP_DIR_NONE },
+  [OP_CLOSE]            = { "close",            BACKEND_OP_DIR_NONE },
+  [OP_CONNECT]          = { "connect",          BACKEND_OP_DIR_NONE },
+  [OP_MULTISHOT_ACCEPT] = { "multishot_accept", BACKEND_OP_DIR_NONE },
+  [OP_NONE]             = { "none",             BACKEND_OP_DIR_NONE },
+  [OP_POLL]             = { "poll",             BACKEND_OP_DIR_NONE },
+  [OP_READ]             = { "read",             BACKEND_OP_DIR_READ },
+  [OP_RECV]             = { "recv",             BACKEND_OP_DIR_READ },
+  [OP_RECVMSG]          = { "recvmsg",          BACKEND_OP_DIR_READ },
+  [OP_SEND]             = { "send",             BACKEND_OP_DIR_WRITE },
+  [OP_SENDMSG]          = { "sendmsg",          BACKEND_OP_DIR_WRITE },
+  [OP_SPLICE]           = { "splice",           BACKEND_OP_DIR_NONE },
+  [OP_TIMEOUT]          = { "timeout",          BACKEND_OP_DIR_NONE },
+  [OP_WRITEV]           = { "writev",           BACKEND_OP_DIR_WRITE },
+  [OP_WRITE]            = { "write",            BACKEND_OP_DIR_WRITE }
+};
+
 static VALUE Backend_initialize(VALUE self) {
   Backend_t *backend;
   GetBackend(self, backend);
 
   backend_base_initialize(&backend->base);
+  backend_base_setup_op_stats(&backend->base, io_uring_op_types, OP_WRITE + 1);
   backend->pending_sqes = 0;
   backend->ring_initialized = 0;
   backend->event_fd = -1;
   backend->event_fd_ctx = NULL;
+  backend->signal_ctx = NULL;
+  backend->splice_pipe[0] = backend->splice_pipe[1] = -1;
+  memset(&backend->fixed_buffers, 0, sizeof(fixed_buffers_t));
 
   context_store_initialize(&backend->store);
 
@@ -113,25 +166,88 @@ static VALUE Backend_initialize(VALUE self) {
   return self;
 }
 
+static inline void io_uring_backend_close_splice_pipe(Backend_t *backend) {
+  if (backend->splice_pipe[0] == -1) return;
+
+  close(backend->splice_pipe[0]);
+  close(backend->splice_pipe[1]);
+  backend->splice_pipe[0] = backend->splice_pipe[1] = -1;
+}
+
+static int io_uring_backend_register_fixed_buffers(Backend_t *backend) {
+  fixed_buffers_t *buffers = &backend->fixed_buffers;
+  struct iovec iovs[FIXED_BUFFER_COUNT];
+  int ret;
+
+  if (!buffers->base) {
+    void *base;
+    if (posix_memalign(&base, 4096, FIXED_BUFFER_COUNT * FIXED_BUFFER_SIZE))
+      return (buffers->registered = -1);
+    buffers->base = base;
+  }
+
+  for (int i = 0; i < FIXED_BUFFER_COUNT; i++) {
+    iovs[i].iov_base = buffers->base + i * FIXED_BUFFER_SIZE;
+    iovs[i].iov_len = FIXED_BUFFER_SIZE;
+  }
+  // registration fails if the locked memory limit is too low
+  ret = io_uring_register_buffers(&backend->ring, iovs, FIXED_BUFFER_COUNT);
+  return (buffers->registered = ret ? -1 : 1);
+}
+
+// Reclaims a retired registered buffer slot once the interrupted op using it
+// has completed.
+static inline void io_uring_backend_reclaim_fixed_buffer(Backend_t *backend, int fixed) {
+  char *state = &backend->fixed_buffers.state[fixed - 1];
+
+  if (*state == FIXED_BUFFER_RETIRED)
+    *state = FIXED_BUFFER_TAKEN;
+  else if (*state == FIXED_BUFFER_RETIRED_RELEASED)
+    *state = FIXED_BUFFER_FREE;
+}
+
 VALUE Backend_finalize(VALUE self) {
   Backend_t *backend;
   GetBackend(self, backend);
 
+  // the stall detector's watchdog thread and the profiler's sampler thread
+  // signal the backend's thread, so they must be stopped before it exits
+  stall_detector_stop(&backend->base.stall_detector);
+  profiler_stop(&backend->base.profiler);
+
   if (backend->ring_initialized) io_uring_queue_exit(&backend->ring);
   if (backend->event_fd != -1) close(backend->event_fd);
+  io_uring_backend_close_splice_pipe(backend);
+  free(backend->fixed_buffers.base);
+  backend->fixed_buffers.base = NULL;
   context_store_free(&backend->store);
   return self;
 }
 
+static void io_uring_backend_arm_signal_source(Backend_t *backend);
+
 VALUE Backend_post_fork(VALUE self) {
   Backend_t *backend;
   GetBackend(self, backend);
 
   io_uring_queue_exit(&backend->ring);
   io_uring_queue_init(backend->prepared_limit, &backend->ring, 0);
+  io_uring_backend_close_splice_pipe(backend);
+  if (backend->fixed_buffers.registered == 1)
+    io_uring_backend_register_fixed_buffers(backend);
+  // ops in flight before the fork will not complete in the child process, so
+  // retired registered buffer slots are reclaimed
+  for (int i = 0; i < FIXED_BUFFER_COUNT; i++)
+    if (backend->fixed_buffers.state[i] >= FIXED_BUFFER_RETIRED)
+      io_uring_backend_reclaim_fixed_buffer(backend, i + 1);
   context_store_free(&backend->store);
   backend_base_reset(&backend->base);
 
+  // trapped signals stay blocked in the child, so the signalfd is polled using
+  // the new ring
+  backend->signal_ctx = NULL;
+  io_uring_backend_arm_signal_source(backend);
+
   return self;
 }
 
@@ -184,13 +300,34 @@ static inline void io_uring_backend_handle_completion(struct io_uring_cqe *cqe,
   if (!ctx) return;
 
   // printf("cqe ctx %p id: %d result: %d (%s, ref_count: %d)\n", ctx, ctx->id, cqe->res, op_type_to_str(ctx->type), ctx->ref_count);
+  // ops cancelled by us are marked by setting their result to -ECANCELED. Ops
+  // cancelled otherwise (e.g. by Backend_close) should resume their fiber.
+  int cancelled = ctx->result == -ECANCELED && cqe->res == -ECANCELED;
+  int multishot = ctx->ref_count == MULTISHOT_REFCOUNT;
+
+  USDT_PROBE3(op_complete, ctx->id, ctx->type, cqe->res);
+
+  // an expired timeout is its normal completion
+  backend_op_stats_record(
+    &backend->base, ctx->type, multishot ? 0 : ctx->stamp,
+    (ctx->type == OP_TIMEOUT && cqe->res == -ETIME) ? 0 : cqe->res
+  );
+
   ctx->result = cqe->res;
-  if (ctx->ref_count == MULTISHOT_REFCOUNT) {
+  if (ctx == backend->signal_ctx) {
+    backend->signal_ctx = NULL;
+    backend->base.signal_source.ready = 1;
+  }
+  if (multishot) {
     handle_multishot_completion(ctx, cqe, backend);
   }
   else {
-    if (ctx->ref_count == 2 && ctx->result != -ECANCELED && ctx->fiber)
+    if (ctx->ref_count == 2 && !cancelled && ctx->fiber)
       Fiber_make_runnable(ctx->fiber, ctx->resume_value);
+    if (ctx->fixed_buffer && ctx->ref_count == 1) {
+      io_uring_backend_reclaim_fixed_buffer(backend, ctx->fixed_buffer);
+      ctx->fixed_buffer = 0;
+    }
     context_store_release(&backend->store, ctx);
   }
 }
@@ -235,6 +372,38 @@ inline void io_uring_backend_defer_submit(Backend_t *backend) {
     io_uring_backend_immediate_submit(backend);
 }
 
+// Submits a poll op for the signalfd, if signals are trapped and no poll op is
+// in progress. The op has no fiber, and its completion sets the signal source's
+// ready flag, after which the trapped signals are dispatched and the poll op is
+// resubmitted (see Backend_poll).
+static void io_uring_backend_arm_signal_source(Backend_t *backend) {
+  struct io_uring_sqe *sqe;
+
+  if (backend->signal_ctx || !SIGNAL_SOURCE_ACTIVE(&backend->base.signal_source)) return;
+
+  sqe = io_uring_get_sqe(&backend->ring);
+  if (!sqe) {
+    io_uring_backend_immediate_submit(backend);
+    sqe = io_uring_get_sqe(&backend->ring);
+    if (!sqe) return;
+  }
+
+  backend->signal_ctx = context_store_acquire(&backend->store, OP_POLL);
+  backend->signal_ctx->fiber = Qnil;
+  // the op is not awaited, so only the completion holds a reference
+  context_store_release(&backend->store, backend->signal_ctx);
+  io_uring_prep_poll_add(sqe, backend->base.signal_source.fd, POLLIN);
+  io_uring_sqe_set_data(sqe, backend->signal_ctx);
+  io_uring_backend_defer_submit(backend);
+}
+
+void backend_watch_signal_source(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  io_uring_backend_arm_signal_source(backend);
+}
+
 void io_uring_backend_poll(Backend_t *backend) {
   poll_context_t poll_ctx;
   poll_ctx.ring = &backend->ring;
@@ -256,17 +425,28 @@ wait_cqe:
 inline VALUE Backend_poll(VALUE self, VALUE blocking) {
   int is_blocking = blocking == Qtrue;
   Backend_t *backend;
+  uint64_t trace_stamp;
   GetBackend(self, backend);
 
   backend->base.poll_count++;
+  backend->base.heartbeat++;
 
   if (!is_blocking && backend->pending_sqes) io_uring_backend_immediate_submit(backend);
 
+  trace_stamp = NATIVE_TRACE_STAMP(&backend->base);
+  NATIVE_TRACE(&backend->base, TRACE_EVENT_ENTER_POLL, rb_fiber_current(), 0, -1, is_blocking, 0);
+  USDT_PROBE1(poll_enter, is_blocking);
   COND_TRACE(&backend->base, 2, SYM_enter_poll, rb_fiber_current());
 
   if (is_blocking) io_uring_backend_poll(backend);
   io_uring_backend_handle_ready_cqes(backend);
+  if (backend->base.signal_source.ready) {
+    signal_source_dispatch(&backend->base.signal_source);
+    io_uring_backend_arm_signal_source(backend);
+  }
 
+  NATIVE_TRACE(&backend->base, TRACE_EVENT_LEAVE_POLL, rb_fiber_current(), 0, -1, is_blocking, trace_stamp);
+  USDT_PROBE1(poll_leave, is_blocking);
   COND_TRACE(&backend->base, 2, SYM_leave_poll, rb_fiber_current());
 
   return self;
@@ -300,6 +480,13 @@ inline struct backend_stats backend_get_stats(VALUE self) {
   return backend_base_stats(&backend->base);
 }
 
+inline struct Backend_base *backend_get_base(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  return &backend->base;
+}
+
 static inline struct io_uring_sqe *io_uring_backend_get_sqe(Backend_t *backend) {
   struct io_uring_sqe *sqe;
   sqe = io_uring_get_sqe(&backend->ring);
@@ -341,12 +528,15 @@ int io_uring_backend_defer_submit_and_await(
 )
 {
   VALUE switchpoint_result = Qnil;
+  int fd = sqe ? sqe->fd : -1;
+  struct backend_op_trace trace;
 
   backend->base.op_count++;
   if (sqe) io_uring_sqe_set_data(sqe, ctx);
   io_uring_backend_defer_submit(backend);
+  backend_trace_op_submit(&backend->base, &trace, ctx->id, ctx->type, fd, sqe ? sqe->len : 0);
 
-  switchpoint_result = backend_await((struct Backend_base *)backend);
+  switchpoint_result = backend_await((struct Backend_base *)backend, ctx->type, fd);
 
   if (ctx->ref_count > 1) {
     struct io_uring_sqe *sqe;
@@ -357,6 +547,13 @@ int io_uring_backend_defer_submit_and_await(
     io_uring_prep_cancel(sqe, ctx, 0);
     io_uring_sqe_set_data(sqe, NULL);
     io_uring_backend_immediate_submit(backend);
+    backend_trace_op_done(&backend->base, &trace, 0, 1);
+  }
+  else {
+    if (ctx->result == -ECANCELED)
+      // op was cancelled because its fd was closed
+      ctx->result = -EBADF;
+    backend_trace_op_done(&backend->base, &trace, ctx->result, 0);
   }
 
   if (value_ptr) (*value_ptr) = switchpoint_result;
@@ -396,6 +593,68 @@ static inline int fd_from_io(VALUE io, rb_io_t **fptr, int write_mode, int recti
   }
 }
 
+void Backend_acquire_fixed_buffer(VALUE self, int len, struct buffer_spec *spec) {
+  Backend_t *backend;
+  fixed_buffers_t *buffers;
+  GetBackend(self, backend);
+  buffers = &backend->fixed_buffers;
+
+  spec->len = len;
+  spec->fixed = 0;
+  if (len <= FIXED_BUFFER_SIZE) {
+    if (!buffers->registered) io_uring_backend_register_fixed_buffers(backend);
+    if (buffers->registered == 1) {
+      for (int i = 0; i < FIXED_BUFFER_COUNT; i++) {
+        if (buffers->state[i] != FIXED_BUFFER_FREE) continue;
+
+        buffers->state[i] = FIXED_BUFFER_TAKEN;
+        spec->ptr = buffers->base + i * FIXED_BUFFER_SIZE;
+        spec->fixed = i + 1;
+        return;
+      }
+    }
+  }
+
+  // no registered buffer available, fall back to a regular buffer
+  spec->ptr = malloc(len);
+  if (!spec->ptr)
+    rb_raise(rb_eRuntimeError, "Failed to allocate buffer");
+}
+
+void Backend_release_fixed_buffer(VALUE self, struct buffer_spec *spec) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  if (spec->fixed) {
+    char *state = &backend->fixed_buffers.state[spec->fixed - 1];
+    if (*state == FIXED_BUFFER_TAKEN)
+      *state = FIXED_BUFFER_FREE;
+    else if (*state == FIXED_BUFFER_RETIRED)
+      *state = FIXED_BUFFER_RETIRED_RELEASED;
+  }
+  else
+    free(spec->ptr);
+  spec->ptr = NULL;
+  spec->len = 0;
+}
+
+// Returns the registered buffer index for the given memory range, or -1 if it
+// is not inside one of this backend's registered buffers.
+static inline int io_uring_backend_fixed_index(Backend_t *backend, int fixed, unsigned char *ptr, long len) {
+  unsigned char *slot;
+  if (!fixed || backend->fixed_buffers.registered != 1) return -1;
+
+  slot = backend->fixed_buffers.base + (fixed - 1) * FIXED_BUFFER_SIZE;
+  return (ptr >= slot && ptr + len <= slot + FIXED_BUFFER_SIZE) ? fixed - 1 : -1;
+}
+
+static inline void io_uring_backend_retire_fixed_buffer(Backend_t *backend, op_context_t *ctx, int fixed) {
+  if (!fixed) return;
+
+  backend->fixed_buffers.state[fixed - 1] = FIXED_BUFFER_RETIRED;
+  ctx->fixed_buffer = fixed;
+}
+
 VALUE Backend_read(VALUE self, VALUE io, VALUE buffer, VALUE length, VALUE to_eof, VALUE pos) {
   Backend_t *backend;
   int fd;
@@ -414,12 +673,17 @@ VALUE Backend_read(VALUE self, VALUE io, VALUE buffer, VALUE length, VALUE to_eo
     struct io_uring_sqe *sqe = io_uring_backend_get_sqe(backend);
     int result;
     int completed;
+    int fixed_index = io_uring_backend_fixed_index(backend, buffer_spec.fixed, buffer_spec.ptr, buffer_spec.len);
 
-    io_uring_prep_read(sqe, fd, buffer_spec.ptr, buffer_spec.len, -1);
+    if (fixed_index >= 0)
+      io_uring_prep_read_fixed(sqe, fd, buffer_spec.ptr, buffer_spec.len, -1, fixed_index);
+    else
+      io_uring_prep_read(sqe, fd, buffer_spec.ptr, buffer_spec.len, -1);
 
     result = io_uring_backend_defer_submit_and_await(backend, sqe, ctx, &resume_value);
     completed = context_store_release(&backend->store, ctx);
     if (!completed) {
+      if (fixed_index >= 0) io_uring_backend_retire_fixed_buffer(backend, ctx, buffer_spec.fixed);
       context_attach_buffers(ctx, 1, &buffer);
       RAISE_IF_EXCEPTION(resume_value);
       return resume_value;
@@ -454,17 +718,54 @@ VALUE Backend_read(VALUE self, VALUE io, VALUE buffer, VALUE length, VALUE to_eo
   return buffer_spec.raw ? INT2FIX(total) : buffer;
 }
 
-VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen) {
+VALUE Backend_readv(VALUE self, VALUE io, VALUE buffers, VALUE maxlen) {
+  Backend_t *backend;
+  int fd;
+  rb_io_t *fptr;
+  struct iovec iovs[BACKEND_READV_MAX];
+  int iov_count = backend_prepare_readv(buffers, maxlen, iovs);
+  VALUE resume_value = Qnil;
+  op_context_t *ctx;
+  struct io_uring_sqe *sqe;
+  int result;
+  int completed;
+
+  GetBackend(self, backend);
+  fd = fd_from_io(io, &fptr, 0, 1);
+
+  ctx = context_store_acquire(&backend->store, OP_READ);
+  sqe = io_uring_backend_get_sqe(backend);
+  io_uring_prep_readv(sqe, fd, iovs, iov_count, -1);
+
+  result = io_uring_backend_defer_submit_and_await(backend, sqe, ctx, &resume_value);
+  completed = context_store_release(&backend->store, ctx);
+  if (!completed) {
+    context_attach_buffers(ctx, 1, &buffers);
+    RAISE_IF_EXCEPTION(resume_value);
+    return resume_value;
+  }
+  RB_GC_GUARD(resume_value);
+
+  if (result < 0)
+    rb_syserr_fail(-result, strerror(-result));
+  if (!result) return Qnil;
+
+  backend_finalize_readv(buffers, iovs, result);
+  return INT2FIX(result);
+}
+
+VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen, VALUE reuse) {
   Backend_t *backend;
   int fd;
   rb_io_t *fptr;
   VALUE buffer;
   long total;
   char *ptr;
-  long len = FIX2INT(maxlen);
+  VALUE io_buffer = backend_read_loop_io_buffer(maxlen);
+  long len = io_buffer == Qnil ? FIX2INT(maxlen) : 0;
   int shrinkable;
 
-  READ_LOOP_PREPARE_STR();
+  READ_LOOP_PREPARE();
 
   GetBackend(self, backend);
   fd = fd_from_io(io, &fptr, 0, 1);
@@ -493,7 +794,7 @@ VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen) {
       break; // EOF
     else {
       total = result;
-      READ_LOOP_YIELD_STR();
+      READ_LOOP_YIELD();
     }
   }
 
@@ -568,12 +869,17 @@ VALUE Backend_write(VALUE self, VALUE io, VALUE buffer) {
     struct io_uring_sqe *sqe = io_uring_backend_get_sqe(backend);
     int result;
     int completed;
+    int fixed_index = io_uring_backend_fixed_index(backend, buffer_spec.fixed, buffer_spec.ptr, left);
 
-    io_uring_prep_write(sqe, fd, buffer_spec.ptr, left, -1);
+    if (fixed_index >= 0)
+      io_uring_prep_write_fixed(sqe, fd, buffer_spec.ptr, left, -1, fixed_index);
+    else
+      io_uring_prep_write(sqe, fd, buffer_spec.ptr, left, -1);
 
     result = io_uring_backend_defer_submit_and_await(backend, sqe, ctx, &resume_value);
     completed = context_store_release(&backend->store, ctx);
     if (!completed) {
+      if (fixed_index >= 0) io_uring_backend_retire_fixed_buffer(backend, ctx, buffer_spec.fixed);
       context_attach_buffers(ctx, 1, &buffer);
       RAISE_IF_EXCEPTION(resume_value);
       return resume_value;
@@ -606,9 +912,9 @@ VALUE Backend_writev(VALUE self, VALUE io, int argc, VALUE *argv) {
 
   iov = malloc(iov_count * sizeof(struct iovec));
   for (int i = 0; i < argc; i++) {
-    VALUE buffer = argv[i];
-    iov[i].iov_base = StringValuePtr(buffer);
-    iov[i].iov_len = RSTRING_LEN(buffer);
+    struct backend_buffer_spec buffer_spec = backend_get_buffer_spec(coerce_io_string_or_buffer(argv[i]), 1);
+    iov[i].iov_base = buffer_spec.ptr;
+    iov[i].iov_len = buffer_spec.len;
     total_length += iov[i].iov_len;
   }
   iov_ptr = iov;
@@ -722,19 +1028,21 @@ VALUE Backend_recvmsg(VALUE self, VALUE io, VALUE buffer, VALUE maxlen, VALUE po
   backend_prepare_read_buffer(buffer, maxlen, &buffer_spec, FIX2INT(pos));
   fd = fd_from_io(io, &fptr, 0, 0);
 
-  char addr_buffer[64];
+  struct sockaddr_storage addr_buffer;
   struct iovec iov;
   struct msghdr msg;
+  long controllen = NIL_P(maxcontrollen) ? 0 : NUM2LONG(maxcontrollen);
+  VALUE control = controllen > 0 ? rb_str_buf_new(controllen) : Qnil;
 
-  iov.iov_base = StringValuePtr(buffer);
-  iov.iov_len = maxlen;
+  iov.iov_base = buffer_spec.ptr;
+  iov.iov_len = buffer_spec.len;
 
-  msg.msg_name = addr_buffer;
+  msg.msg_name = &addr_buffer;
   msg.msg_namelen = sizeof(addr_buffer);
   msg.msg_iov = &iov;
   msg.msg_iovlen = 1;
-  msg.msg_control = 0;
-  msg.msg_controllen = 0;
+  msg.msg_control = controllen > 0 ? RSTRING_PTR(control) : 0;
+  msg.msg_controllen = controllen;
   msg.msg_flags = 0;
 
   while (1) {
@@ -749,7 +1057,7 @@ VALUE Backend_recvmsg(VALUE self, VALUE io, VALUE buffer, VALUE maxlen, VALUE po
     result = io_uring_backend_defer_submit_and_await(backend, sqe, ctx, &resume_value);
     completed = context_store_release(&backend->store, ctx);
     if (!completed) {
-      context_attach_buffers(ctx, 1, &buffer);
+      context_attach_buffers_v(ctx, 2, buffer, control);
       RAISE_IF_EXCEPTION(resume_value);
       return resume_value;
     }
@@ -768,21 +1076,88 @@ VALUE Backend_recvmsg(VALUE self, VALUE io, VALUE buffer, VALUE maxlen, VALUE po
   if (!buffer_spec.raw) backend_finalize_string_buffer(buffer, &buffer_spec, total, fptr);
   VALUE addr = name_to_addrinfo(msg.msg_name, msg.msg_namelen);
   VALUE rflags = INT2NUM(msg.msg_flags);
-  return rb_ary_new_from_args(3, buffer, addr, rflags);
+  VALUE result = rb_ary_new_from_args(3, buffer, addr, rflags);
+  backend_push_cmsgs(result, &msg);
+
+  RB_GC_GUARD(control);
+  return result;
   RB_GC_GUARD(addr);
 }
 
-VALUE Backend_recv_loop(VALUE self, VALUE io, VALUE maxlen) {
+// Batched receive is done by awaiting a single recvmsg op, then draining any
+// further datagrams already queued on the socket using a non-blocking
+// recvmmsg(2), so a single wakeup yields up to `count` datagrams.
+VALUE Backend_recv_batch(VALUE self, VALUE io, VALUE count, VALUE maxlen, VALUE flags) {
+  Backend_t *backend;
+  int fd;
+  rb_io_t *fptr;
+  VALUE buffer;
+  int count_int = FIX2INT(count);
+  int maxlen_int = FIX2INT(maxlen);
+  int flags_int = FIX2INT(flags);
+  int received;
+
+  struct mmsghdr msgs[BACKEND_BATCH_MAX];
+  struct iovec iovs[BACKEND_BATCH_MAX];
+  struct sockaddr_storage addrs[BACKEND_BATCH_MAX];
+
+  if (count_int < 1 || maxlen_int < 1)
+    rb_raise(rb_eArgError, "count and maxlen must be positive");
+  if (count_int > BACKEND_BATCH_MAX) count_int = BACKEND_BATCH_MAX;
+
+  GetBackend(self, backend);
+  fd = fd_from_io(io, &fptr, 0, 0);
+
+  buffer = rb_str_buf_new((long)count_int * maxlen_int);
+  backend_recv_batch_prepare(msgs, iovs, addrs, RSTRING_PTR(buffer), count_int, maxlen_int);
+
+  {
+    VALUE resume_value = Qnil;
+    op_context_t *ctx = context_store_acquire(&backend->store, OP_RECVMSG);
+    struct io_uring_sqe *sqe = io_uring_backend_get_sqe(backend);
+    int result;
+    int completed;
+
+    io_uring_prep_recvmsg(sqe, fd, &msgs[0].msg_hdr, flags_int);
+
+    result = io_uring_backend_defer_submit_and_await(backend, sqe, ctx, &resume_value);
+    completed = context_store_release(&backend->store, ctx);
+    if (!completed) {
+      context_attach_buffers(ctx, 1, &buffer);
+      RAISE_IF_EXCEPTION(resume_value);
+      return resume_value;
+    }
+    RB_GC_GUARD(resume_value);
+
+    if (result < 0) rb_syserr_fail(-result, strerror(-result));
+    msgs[0].msg_len = result;
+    received = 1;
+  }
+
+  if (count_int > 1) {
+    // Errors are ignored here, since at least one datagram was already
+    // received. A pending socket error will be reported on the next call.
+    backend->base.op_count++;
+    int more = recvmmsg(fd, msgs + 1, count_int - 1, flags_int | MSG_DONTWAIT, NULL);
+    if (more > 0) received += more;
+  }
+
+  RB_GC_GUARD(buffer);
+  return backend_recv_batch_result(msgs, received);
+}
+
+VALUE Backend_recv_loop(VALUE self, VALUE io, VALUE maxlen, VALUE reuse) {
   Backend_t *backend;
   int fd;
   rb_io_t *fptr;
   VALUE buffer;
   long total;
   char *ptr;
-  long len = FIX2INT(maxlen);
+  VALUE io_buffer = backend_read_loop_io_buffer(maxlen);
+  long len = io_buffer == Qnil ? FIX2INT(maxlen) : 0;
   int shrinkable;
 
-  READ_LOOP_PREPARE_STR();
+  READ_LOOP_PREPARE();
 
   GetBackend(self, backend);
   fd = fd_from_io(io, &fptr, 0, 0);
@@ -811,7 +1186,7 @@ VALUE Backend_recv_loop(VALUE self, VALUE io, VALUE maxlen) {
       break; // EOF
     else {
       total = result;
-      READ_LOOP_YIELD_STR();
+      READ_LOOP_YIELD();
     }
   }
 
@@ -916,6 +1291,7 @@ VALUE Backend_sendmsg(VALUE self, VALUE io, VALUE buffer, VALUE flags, VALUE des
   struct backend_buffer_spec buffer_spec = backend_get_buffer_spec(buffer, 1);
   long left = buffer_spec.len;
   int flags_int = FIX2INT(flags);
+  VALUE control = backend_build_cmsgs(controls);
 
   GetBackend(self, backend);
   fd = fd_from_io(io, &fptr, 1, 0);
@@ -936,8 +1312,8 @@ VALUE Backend_sendmsg(VALUE self, VALUE io, VALUE buffer, VALUE flags, VALUE des
   }
   msg.msg_iov = &iov;
   msg.msg_iovlen = 1;
-  msg.msg_control = 0;
-  msg.msg_controllen = 0;
+  msg.msg_control = control == Qnil ? 0 : RSTRING_PTR(control);
+  msg.msg_controllen = control == Qnil ? 0 : RSTRING_LEN(control);
   msg.msg_flags = 0;
 
   while (left > 0) {
@@ -952,7 +1328,7 @@ VALUE Backend_sendmsg(VALUE self, VALUE io, VALUE buffer, VALUE flags, VALUE des
     result = io_uring_backend_defer_submit_and_await(backend, sqe, ctx, &resume_value);
     completed = context_store_release(&backend->store, ctx);
     if (!completed) {
-      context_attach_buffers(ctx, 1, &buffer);
+      context_attach_buffers_v(ctx, 2, buffer, control);
       RAISE_IF_EXCEPTION(resume_value);
       return resume_value;
     }
@@ -970,6 +1346,51 @@ VALUE Backend_sendmsg(VALUE self, VALUE io, VALUE buffer, VALUE flags, VALUE des
   return INT2FIX(buffer_spec.len);
 }
 
+// Batched send is done using a non-blocking sendmmsg(2), falling back to
+// polling the socket for writability whenever its send buffer is full.
+VALUE Backend_send_batch(VALUE self, VALUE io, VALUE datagrams, VALUE flags) {
+  Backend_t *backend;
+  int fd;
+  rb_io_t *fptr;
+  VALUE resume_value = Qnil;
+  int flags_int = FIX2INT(flags) | MSG_DONTWAIT;
+  long total;
+  long sent = 0;
+
+  struct mmsghdr msgs[BACKEND_BATCH_MAX];
+  struct iovec iovs[BACKEND_BATCH_MAX];
+
+  Check_Type(datagrams, T_ARRAY);
+  total = RARRAY_LEN(datagrams);
+
+  GetBackend(self, backend);
+  fd = fd_from_io(io, &fptr, 1, 0);
+
+  while (sent < total) {
+    int count = backend_send_batch_prepare(msgs, iovs, datagrams, sent);
+
+    backend->base.op_count++;
+    int result = sendmmsg(fd, msgs, count, flags_int);
+    if (result < 0) {
+      int e = errno;
+      if (e != EWOULDBLOCK && e != EAGAIN) rb_syserr_fail(e, strerror(e));
+
+      resume_value = io_uring_backend_wait_fd(backend, fd, 1);
+      RAISE_IF_EXCEPTION(resume_value);
+    }
+    else
+      sent += result;
+  }
+
+  resume_value = backend_snooze(&backend->base);
+  RAISE_IF_EXCEPTION(resume_value);
+
+  RB_GC_GUARD(datagrams);
+  RB_GC_GUARD(resume_value);
+
+  return LONG2FIX(sent);
+}
+
 VALUE io_uring_backend_accept(Backend_t *backend, VALUE server_socket, VALUE socket_class, int loop) {
   int server_fd;
   rb_io_t *server_fptr;
@@ -1224,7 +1645,7 @@ VALUE double_splice_safe(struct double_splice_ctx *ctx) {
     io_uring_backend_immediate_submit(ctx->backend);
 
   while (1) {
-    resume_value = backend_await((struct Backend_base *)ctx->backend);
+    resume_value = backend_await((struct Backend_base *)ctx->backend, OP_SPLICE, src_fd);
 
     if ((ctx_src && ctx_src->ref_count == 2 && ctx_dest && ctx_dest->ref_count == 2) || TEST_EXCEPTION(resume_value)) {
       if (ctx_src) {
@@ -1285,6 +1706,98 @@ VALUE Backend_double_splice(VALUE self, VALUE src, VALUE dest) {
   );
 }
 
+// Performs a single splice op, returning the number of bytes spliced. Returns
+// -1 if the op was interrupted, in which case the resume value is stored in
+// resume_value.
+static inline int io_uring_backend_splice_op(Backend_t *backend, int src_fd, int64_t src_offset, int dest_fd, unsigned int len, VALUE *resume_value) {
+  op_context_t *ctx = context_store_acquire(&backend->store, OP_SPLICE);
+  struct io_uring_sqe *sqe = io_uring_backend_get_sqe(backend);
+  int result;
+  int completed;
+
+  io_uring_prep_splice(sqe, src_fd, src_offset, dest_fd, -1, len, 0);
+
+  result = io_uring_backend_defer_submit_and_await(backend, sqe, ctx, resume_value);
+  completed = context_store_release(&backend->store, ctx);
+  RAISE_IF_EXCEPTION(*resume_value);
+  if (!completed) return -1;
+
+  if (result < 0) rb_syserr_fail(-result, strerror(-result));
+  return result;
+}
+
+struct send_file_ctx {
+  Backend_t *backend;
+  VALUE src;
+  VALUE dest;
+  off_t offset;
+  long length;
+  int dirty;
+};
+
+#define SEND_FILE_MAX_CHUNK (1 << 16)
+
+VALUE send_file_safe(struct send_file_ctx *ctx) {
+  Backend_t *backend = ctx->backend;
+  int src_fd;
+  int dest_fd;
+  rb_io_t *src_fptr;
+  rb_io_t *dest_fptr;
+  long left = ctx->length;
+  long total = 0;
+  VALUE resume_value = Qnil;
+
+  src_fd = fd_from_io(ctx->src, &src_fptr, 0, 0);
+  dest_fd = fd_from_io(ctx->dest, &dest_fptr, 1, 0);
+
+  // The pipe used for splicing is kept around for subsequent calls. If the
+  // transfer is interrupted, the pipe might still hold data, so it is closed
+  // in send_file_cleanup.
+  if (backend->splice_pipe[0] == -1 && pipe2(backend->splice_pipe, O_CLOEXEC) == -1) {
+    backend->splice_pipe[0] = backend->splice_pipe[1] = -1;
+    rb_syserr_fail(errno, strerror(errno));
+  }
+  ctx->dirty = 1;
+
+  while (left) {
+    unsigned int count = (left < 0 || left > SEND_FILE_MAX_CHUNK) ? SEND_FILE_MAX_CHUNK : left;
+    int in = io_uring_backend_splice_op(backend, src_fd, ctx->offset, backend->splice_pipe[1], count, &resume_value);
+    if (in < 0) return resume_value;
+    if (!in) break; // EOF
+
+    ctx->offset += in;
+    if (left > 0) left -= in;
+    while (in > 0) {
+      int out = io_uring_backend_splice_op(backend, backend->splice_pipe[0], -1, dest_fd, in, &resume_value);
+      if (out < 0) return resume_value;
+
+      in -= out;
+      total += out;
+    }
+  }
+
+  ctx->dirty = 0;
+  RB_GC_GUARD(resume_value);
+  return LONG2NUM(total);
+}
+
+VALUE send_file_cleanup(struct send_file_ctx *ctx) {
+  if (ctx->dirty) io_uring_backend_close_splice_pipe(ctx->backend);
+  return Qnil;
+}
+
+VALUE Backend_send_file(VALUE self, VALUE src, VALUE dest, VALUE offset, VALUE length) {
+  struct send_file_ctx ctx = {
+    NULL, src, dest, NUM2OFFT(offset), NIL_P(length) ? -1 : NUM2LONG(length), 0
+  };
+  GetBackend(self, ctx.backend);
+
+  return rb_ensure(
+    SAFE(send_file_safe), (VALUE)&ctx,
+    SAFE(send_file_cleanup), (VALUE)&ctx
+  );
+}
+
 VALUE Backend_tee(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   Backend_t *backend;
   GetBackend(self, backend);
@@ -1365,34 +1878,67 @@ VALUE Backend_wait_io(VALUE self, VALUE io, VALUE write) {
   return self;
 }
 
-// VALUE Backend_close(VALUE self, VALUE io) {
-//   Backend_t *backend;
-//   rb_io_t *fptr;
-//   VALUE resume_value = Qnil;
-//   op_context_t *ctx;
-//   struct io_uring_sqe *sqe;
-//   int result;
-//   int completed;
+// Cancels all pending ops on the given fd. The cancellation is hard-linked to
+// the next submitted SQE, so that SQE is only started after cancellation.
+static inline void io_uring_backend_cancel_fd(Backend_t *backend, int fd) {
+#ifdef HAVE_IORING_ASYNC_CANCEL_FD
+  struct io_uring_sqe *sqe = io_uring_backend_get_sqe(backend);
+  io_uring_prep_cancel_fd(sqe, fd, IORING_ASYNC_CANCEL_ALL);
+  io_uring_sqe_set_data(sqe, NULL);
+  io_uring_sqe_set_flags(sqe, IOSQE_IO_HARDLINK);
+  io_uring_backend_defer_submit(backend);
+#endif
+}
+
+VALUE Backend_close(VALUE self, VALUE io) {
+  Backend_t *backend;
+  rb_io_t *fptr;
+  VALUE underlying_io;
+  VALUE resume_value = Qnil;
+  op_context_t *ctx;
+  struct io_uring_sqe *sqe;
+  int fd;
+  int result;
+  int completed;
 
-//   if (fd < 0) return Qnil;
+  if (rb_obj_class(io) == cPipe) {
+    if (!RTEST(Pipe_closed_p(io))) Pipe_close(io);
+    return Qnil;
+  }
 
-//   io_unset_nonblock(fptr, io);
+  underlying_io = rb_ivar_get(io, ID_ivar_io);
+  if (underlying_io != Qnil) io = underlying_io;
+  fptr = RFILE(rb_io_taint_check(io))->fptr;
+  if (!fptr || fptr->fd < 0) return Qnil;
 
-//   ctx = context_store_acquire(&backend->store, OP_CLOSE);
-//   sqe = io_uring_backend_get_sqe(backend);
-//   io_uring_prep_close(sqe, fd);
-//   result = io_uring_backend_defer_submit_and_await(backend, sqe, ctx, &resume_value);
-//   completed = context_store_release(&backend->store, ctx);
-//   RAISE_IF_EXCEPTION(resume_value);
-//   if (!completed) return resume_value;
-//   RB_GC_GUARD(resume_value);
+  // stdio, popen and duplex IOs need more than closing the fd, and IOs with
+  // buffered writes (e.g. written to using IO#orig_write) need to be flushed
+  if (fptr->fd <= 2 || fptr->stdio_file || fptr->pid || fptr->tied_io_for_writing ||
+      fptr->wbuf.len || fptr->writeconv)
+    return rb_io_close(io);
+
+  GetBackend(self, backend);
+  fd = fptr->fd;
+  // mark the IO as closed before the fd is actually closed, so no new ops are
+  // started on it
+  fptr_finalize(fptr);
 
-//   if (result < 0) rb_syserr_fail(-result, strerror(-result));
+  io_uring_backend_cancel_fd(backend, fd);
+  ctx = context_store_acquire(&backend->store, OP_CLOSE);
+  sqe = io_uring_backend_get_sqe(backend);
+  io_uring_prep_close(sqe, fd);
+
+  result = io_uring_backend_defer_submit_and_await(backend, sqe, ctx, &resume_value);
+  completed = context_store_release(&backend->store, ctx);
+  if (!completed) {
+    RAISE_IF_EXCEPTION(resume_value);
+    return resume_value;
+  }
+  RB_GC_GUARD(resume_value);
 
-//   fptr_finalize(fptr);
-//   // fd = -1;
-//   return io;
-// }
+  if (result < 0) rb_syserr_fail(-result, strerror(-result));
+  return Qnil;
+}
 
 inline struct __kernel_timespec double_to_timespec(double duration) {
   double duration_integral;
@@ -1551,6 +2097,75 @@ VALUE Backend_waitpid(VALUE self, VALUE pid) {
   return rb_ary_new_from_args(2, INT2FIX(ret), INT2FIX(WEXITSTATUS(status)));
 }
 
+// Releases the poll ops used for waiting on pidfds, cancelling those that have
+// not completed, and closes the pidfds.
+static void io_uring_backend_release_pidfd_polls(Backend_t *backend, op_context_t **ctxs, int *fds, long count) {
+  int cancelled = 0;
+
+  for (long i = 0; i < count; i++) {
+    if (ctxs[i]->ref_count > 1) {
+      struct io_uring_sqe *sqe = io_uring_backend_get_sqe(backend);
+      ctxs[i]->result = -ECANCELED;
+      io_uring_prep_cancel(sqe, ctxs[i], 0);
+      io_uring_sqe_set_data(sqe, NULL);
+      io_uring_backend_defer_submit(backend);
+      cancelled = 1;
+    }
+    context_store_release(&backend->store, ctxs[i]);
+    close(fds[i]);
+  }
+  if (cancelled) io_uring_backend_immediate_submit(backend);
+}
+
+VALUE Backend_waitpid_any(VALUE self, VALUE pids) {
+  Backend_t *backend;
+  op_context_t **ctxs;
+  int *fds;
+  VALUE ctxs_alloc = 0;
+  VALUE fds_alloc = 0;
+  VALUE resume_value;
+  long count;
+  GetBackend(self, backend);
+
+  Check_Type(pids, T_ARRAY);
+  count = RARRAY_LEN(pids);
+  if (!count) return rb_ary_new();
+
+  ctxs = ALLOCV_N(op_context_t *, ctxs_alloc, count);
+  fds = ALLOCV_N(int, fds_alloc, count);
+  for (long i = 0; i < count; i++) {
+    struct io_uring_sqe *sqe;
+
+    fds[i] = pidfd_open(NUM2INT(RARRAY_AREF(pids, i)), 0);
+    if (fds[i] < 0) {
+      int e = errno;
+      io_uring_backend_release_pidfd_polls(backend, ctxs, fds, i);
+      ALLOCV_END(ctxs_alloc);
+      ALLOCV_END(fds_alloc);
+      // the child was already reaped by other means, so there's nothing to
+      // wait for, and it is returned with a nil exit status
+      if (e == ESRCH) return backend_reap_children(pids);
+      rb_syserr_fail(e, strerror(e));
+    }
+    ctxs[i] = context_store_acquire(&backend->store, OP_POLL);
+    sqe = io_uring_backend_get_sqe(backend);
+    io_uring_prep_poll_add(sqe, fds[i], POLLIN);
+    io_uring_sqe_set_data(sqe, ctxs[i]);
+    io_uring_backend_defer_submit(backend);
+  }
+  backend->base.op_count++;
+
+  // each completed poll op schedules the fiber, which is resumed once
+  resume_value = backend_await((struct Backend_base *)backend, OP_POLL, -1);
+  io_uring_backend_release_pidfd_polls(backend, ctxs, fds, count);
+  ALLOCV_END(ctxs_alloc);
+  ALLOCV_END(fds_alloc);
+  RAISE_IF_EXCEPTION(resume_value);
+  RB_GC_GUARD(resume_value);
+
+  return backend_reap_children(pids);
+}
+
 /*
 Blocks a fiber indefinitely. This is accomplished by using an eventfd that will
 never be signalled. The eventfd is needed so we could do a blocking polling for
@@ -1585,7 +2200,7 @@ VALUE Backend_wait_event(VALUE self, VALUE raise) {
   else
     backend->event_fd_ctx->ref_count += 1;
 
-  resume_value = backend_await((struct Backend_base *)backend);
+  resume_value = backend_await((struct Backend_base *)backend, OP_POLL, -1);
   context_store_release(&backend->store, backend->event_fd_ctx);
 
   if (backend->event_fd_ctx->ref_count == 1) {
@@ -1718,7 +2333,7 @@ VALUE Backend_chain(int argc,VALUE *argv, VALUE self) {
   backend->base.op_count += sqe_count;
   ctx->ref_count = sqe_count + 1;
   io_uring_backend_defer_submit(backend);
-  resume_value = backend_await((struct Backend_base *)backend);
+  resume_value = backend_await((struct Backend_base *)backend, OP_CHAIN, -1);
   result = ctx->result;
   completed = context_store_release(&backend->store, ctx);
   if (!completed) {
@@ -1930,19 +2545,52 @@ VALUE Backend_trace_proc_set(VALUE self, VALUE block) {
   Backend_t *backend;
   GetBackend(self, backend);
 
-  backend->base.trace_proc = block;
+  backend_trace_proc_set(&backend->base, block);
+  return self;
+}
+
+VALUE Backend_trace_buffer_start(int argc, VALUE *argv, VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  backend_trace_buffer_start(&backend->base, argc, argv);
   return self;
 }
 
+VALUE Backend_trace_buffer_stop(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  backend_trace_buffer_stop(&backend->base);
+  return self;
+}
+
+VALUE Backend_trace_buffer_read(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  return backend_trace_buffer_read(&backend->base);
+}
+
+VALUE Backend_trace_buffer_dropped(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  return backend_trace_buffer_dropped(&backend->base);
+}
+
 VALUE Backend_snooze(VALUE self) {
   VALUE ret;
   VALUE fiber = rb_fiber_current();
   Backend_t *backend;
+  uint64_t trace_stamp;
   GetBackend(self, backend);
 
+  trace_stamp = NATIVE_TRACE_STAMP(&backend->base);
   Fiber_make_runnable(fiber, Qnil);
   ret = backend_base_switch_fiber(self, &backend->base);
 
+  NATIVE_TRACE(&backend->base, TRACE_EVENT_UNBLOCK, fiber, 0, -1, 0, trace_stamp);
   COND_TRACE(&backend->base, 4, SYM_unblock, rb_fiber_current(), ret, CALLER());
 
   RAISE_IF_EXCEPTION(ret);
@@ -1973,12 +2621,26 @@ void Init_Backend(void) {
   rb_define_method(cBackend, "post_fork", Backend_post_fork, 0);
   rb_define_method(cBackend, "trace", Backend_trace, -1);
   rb_define_method(cBackend, "trace_proc=", Backend_trace_proc_set, 1);
+  rb_define_method(cBackend, "trace_buffer_start", Backend_trace_buffer_start, -1);
+  rb_define_method(cBackend, "trace_buffer_stop", Backend_trace_buffer_stop, 0);
+  rb_define_method(cBackend, "trace_buffer_read", Backend_trace_buffer_read, 0);
+  rb_define_method(cBackend, "trace_buffer_dropped", Backend_trace_buffer_dropped, 0);
+  rb_define_method(cBackend, "trace_ops=", Backend_trace_ops_set, 1);
   rb_define_method(cBackend, "stats", Backend_stats, 0);
+  rb_define_method(cBackend, "measure_schedule_delay=", Backend_measure_schedule_delay_set, 1);
+  rb_define_method(cBackend, "stall_detector_start", Backend_stall_detector_start, -1);
+  rb_define_method(cBackend, "stall_detector_stop", Backend_stall_detector_stop, 0);
+  rb_define_method(cBackend, "stall_events", Backend_stall_events, 0);
+  rb_define_method(cBackend, "profile_start", Backend_profile_start, -1);
+  rb_define_method(cBackend, "profile_stop", Backend_profile_stop, 0);
+  rb_define_method(cBackend, "profile_result", Backend_profile_result, 0);
+  rb_define_method(cBackend, "signalfd_trap", Backend_signalfd_trap, 2);
 
   rb_define_method(cBackend, "poll", Backend_poll, 1);
   rb_define_method(cBackend, "break", Backend_wakeup, 0);
   rb_define_method(cBackend, "kind", Backend_kind, 0);
   rb_define_method(cBackend, "chain", Backend_chain, -1);
+  rb_define_method(cBackend, "close", Backend_close, 1);
   rb_define_method(cBackend, "idle_gc_period=", Backend_idle_gc_period_set, 1);
   rb_define_method(cBackend, "idle_proc=", Backend_idle_proc_set, 1);
   rb_define_method(cBackend, "splice_chunks", Backend_splice_chunks, 7);
@@ -1993,14 +2655,18 @@ void Init_Backend(void) {
   #endif
 
   rb_define_method(cBackend, "read", Backend_read, 5);
-  rb_define_method(cBackend, "read_loop", Backend_read_loop, 2);
+  rb_define_method(cBackend, "readv", Backend_readv, 3);
+  rb_define_method(cBackend, "read_loop", Backend_read_loop_m, -1);
   rb_define_method(cBackend, "recv", Backend_recv, 4);
   rb_define_method(cBackend, "recvmsg", Backend_recvmsg, 7);
   rb_define_method(cBackend, "recv_feed_loop", Backend_recv_feed_loop, 3);
-  rb_define_method(cBackend, "recv_loop", Backend_recv_loop, 2);
+  rb_define_method(cBackend, "recv_loop", Backend_recv_loop_m, -1);
   rb_define_method(cBackend, "send", Backend_send, 3);
   rb_define_method(cBackend, "sendmsg", Backend_sendmsg, 5);
+  rb_define_method(cBackend, "recv_batch", Backend_recv_batch, 4);
+  rb_define_method(cBackend, "send_batch", Backend_send_batch, 3);
   rb_define_method(cBackend, "sendv", Backend_sendv, 3);
+  rb_define_method(cBackend, "send_file", Backend_send_file, 4);
   rb_define_method(cBackend, "sleep", Backend_sleep, 1);
 
   rb_define_method(cBackend, "splice", Backend_splice, 3);
@@ -2012,8 +2678,9 @@ void Init_Backend(void) {
   rb_define_method(cBackend, "wait_event", Backend_wait_event, 1);
   rb_define_method(cBackend, "wait_io", Backend_wait_io, 2);
   rb_define_method(cBackend, "waitpid", Backend_waitpid, 1);
+  rb_define_method(cBackend, "waitpid_any", Backend_waitpid_any, 1);
+  rb_define_method(cBackend, "with_fixed_buffer", Backend_with_fixed_buffer, 1);
   rb_define_method(cBackend, "write", Backend_write_m, -1);
-  // rb_define_method(cBackend, "close", Backend_close, 1);
 
   SYM_io_uring = ID2SYM(rb_intern("io_uring"));
   SYM_send = ID2SYM(rb_intern("send"));
@@ -3,6 +3,7 @@
 #include "ruby.h"
 #include "polyphony.h"
 #include "backend_io_uring_context.h"
+#include "backend_common.h"
 
 const char *op_type_to_str(enum op_type type) {
   switch (type) {
@@ -54,7 +55,10 @@ inline op_context_t *context_store_acquire(op_context_store_t *store, enum op_ty
   ctx->resume_value = Qnil;
   ctx->ref_count = 2;
   ctx->result = 0;
+  ctx->stamp = current_time_ns();
   ctx->buffer_count = 0;
+  ctx->fixed_buffer = 0;
+  USDT_PROBE2(op_submit, ctx->id, type);
 
   store->taken_count++;
 
@@ -31,11 +31,13 @@ typedef struct op_context {
   unsigned int      ref_count : 16;
   int               id;
   int               result;
+  uint64_t          stamp;
   VALUE             fiber;
   VALUE             resume_value;
   unsigned int      buffer_count;
   VALUE             buffer0;
   VALUE             *buffers;
+  int               fixed_buffer; // retired registered buffer index + 1, or 0
 } op_context_t;
 
 typedef struct op_context_store {
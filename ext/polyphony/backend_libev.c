@@ -32,7 +32,8 @@ order to prevent event starvation.
 
 On Linux 5.3+, pidfd_open will be used, otherwise a libev child watcher will be
 used. Note that if a child watcher is used, waitpid will only work from the main
-thread.
+thread. waitpid_any registers a pidfd watcher (or child watcher) for each of the
+given pids, and reaps all terminated children once any of them has terminated.
 
 */
 
@@ -52,6 +53,9 @@ thread.
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#ifdef POLYPHONY_LINUX
+#include <sys/sendfile.h>
+#endif
 
 #include "polyphony.h"
 #include "../libev/ev.h"
@@ -65,12 +69,18 @@ VALUE SYM_send;
 VALUE SYM_splice;
 VALUE SYM_write;
 
+struct libev_signal_watcher {
+  struct ev_io io;
+  signal_source_t *source;
+};
+
 typedef struct Backend_t {
   struct Backend_base base;
 
   // implementation-specific fields
   struct ev_loop *ev_loop;
   struct ev_async break_async;
+  struct libev_signal_watcher signal_watcher;
 } Backend_t;
 
 static void Backend_mark(void *ptr) {
@@ -102,11 +112,116 @@ static VALUE Backend_allocate(VALUE klass) {
 #define GetBackend(obj, backend) \
   TypedData_Get_Struct((obj), Backend_t, &Backend_type, (backend))
 
+// Counts a syscall error in the backend stats and raises it.
+#define LIBEV_SYSERR_FAIL(backend, e) { \
+  backend_count_error(&(backend)->base, e); \
+  rb_syserr_fail(e, strerror(e)); \
+}
+
+// Counts a syscall error for a traced op, completing its trace, and raises it.
+#define LIBEV_OP_SYSERR_FAIL(backend, trace, e) { \
+  backend_trace_op_done(&(backend)->base, trace, -(e), 0); \
+  LIBEV_SYSERR_FAIL(backend, e); \
+}
+
+// The libev backend tracks the time fibers spend waiting for readiness (or for
+// a timer, child process or event), by wait type. I/O ops, which may involve
+// multiple syscalls and waits, have their own op types, used for op tracing.
+enum libev_op_type {
+  LIBEV_OP_READABLE,
+  LIBEV_OP_WRITABLE,
+  LIBEV_OP_READWRITE,
+  LIBEV_OP_SLEEP,
+  LIBEV_OP_TIMER,
+  LIBEV_OP_WAITPID,
+  LIBEV_OP_WAIT_EVENT,
+  LIBEV_OP_READ,
+  LIBEV_OP_READV,
+  LIBEV_OP_RECVMSG,
+  LIBEV_OP_WRITE,
+  LIBEV_OP_WRITEV,
+  LIBEV_OP_SEND,
+  LIBEV_OP_SENDMSG,
+  LIBEV_OP_ACCEPT,
+  LIBEV_OP_CONNECT,
+  LIBEV_OP_SPLICE,
+  LIBEV_OP_TEE,
+  LIBEV_OP_COUNT
+};
+
+static const struct backend_op_type libev_op_types[LIBEV_OP_COUNT] = {
+  [LIBEV_OP_READABLE]   = { "readable",   BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_WRITABLE]   = { "writable",   BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_READWRITE]  = { "readwrite",  BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_SLEEP]      = { "sleep",      BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_TIMER]      = { "timer",      BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_WAITPID]    = { "waitpid",    BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_WAIT_EVENT] = { "wait_event", BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_READ]       = { "read",       BACKEND_OP_DIR_READ },
+  [LIBEV_OP_READV]      = { "readv",      BACKEND_OP_DIR_READ },
+  [LIBEV_OP_RECVMSG]    = { "recvmsg",    BACKEND_OP_DIR_READ },
+  [LIBEV_OP_WRITE]      = { "write",      BACKEND_OP_DIR_WRITE },
+  [LIBEV_OP_WRITEV]     = { "writev",     BACKEND_OP_DIR_WRITE },
+  [LIBEV_OP_SEND]       = { "send",       BACKEND_OP_DIR_WRITE },
+  [LIBEV_OP_SENDMSG]    = { "sendmsg",    BACKEND_OP_DIR_WRITE },
+  [LIBEV_OP_ACCEPT]     = { "accept",     BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_CONNECT]    = { "connect",    BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_SPLICE]     = { "splice",     BACKEND_OP_DIR_NONE },
+  [LIBEV_OP_TEE]        = { "tee",        BACKEND_OP_DIR_NONE }
+};
+
+// Awaits the completion of a wait, recording its latency. A wait interrupted
+// by an exception is counted as cancelled.
+static inline VALUE libev_await(Backend_t *backend, enum libev_op_type op, int fd) {
+  uint64_t since = current_time_ns();
+  VALUE ret;
+
+  USDT_PROBE2(watcher_start, rb_fiber_current(), op);
+  ret = backend_await(&backend->base, op, fd);
+  USDT_PROBE3(watcher_ready, rb_fiber_current(), op, TEST_EXCEPTION(ret));
+
+  backend_op_stats_record(&backend->base, op, since, TEST_EXCEPTION(ret) ? -ECANCELED : 0);
+  return ret;
+}
+
+// Awaits a wait that is an op in its own right (rather than part of an I/O op),
+// tracing it.
+static inline VALUE libev_await_op(Backend_t *backend, enum libev_op_type op, int fd) {
+  struct backend_op_trace trace;
+  VALUE ret;
+
+  backend_trace_op_submit(&backend->base, &trace, 0, op, fd, 0);
+  ret = libev_await(backend, op, fd);
+  backend_trace_op_done(&backend->base, &trace, 0, TEST_EXCEPTION(ret));
+  return ret;
+}
+
 void break_async_callback(struct ev_loop *ev_loop, struct ev_async *ev_async, int revents) {
   // This callback does nothing, the break async is used solely for breaking out
   // of a *blocking* event loop (waking it up) in a thread-safe, signal-safe manner
 }
 
+void signal_watcher_callback(struct ev_loop *ev_loop, struct ev_io *w, int revents) {
+  // Signals are dispatched after ev_run returns, since handlers are scheduled
+  // by calling into Ruby (see Backend_poll)
+  struct libev_signal_watcher *watcher = (struct libev_signal_watcher *)w;
+  watcher->source->ready = 1;
+}
+
+static inline void libev_start_signal_watcher(Backend_t *backend) {
+  ev_io_init(&backend->signal_watcher.io, signal_watcher_callback, backend->base.signal_source.fd, EV_READ);
+  ev_io_start(backend->ev_loop, &backend->signal_watcher.io);
+  // like break_async, the signal watcher does not keep the loop alive
+  ev_unref(backend->ev_loop);
+}
+
+void backend_watch_signal_source(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  if (!ev_is_active(&backend->signal_watcher.io)) libev_start_signal_watcher(backend);
+}
+
 inline struct ev_loop *libev_new_loop(void) {
   #ifdef POLYPHONY_USE_PIDFD_OPEN
     return ev_loop_new(EVFLAG_NOSIGMASK);
@@ -122,6 +237,7 @@ static VALUE Backend_initialize(VALUE self) {
   GetBackend(self, backend);
 
   backend_base_initialize(&backend->base);
+  backend_base_setup_op_stats(&backend->base, libev_op_types, LIBEV_OP_COUNT);
   backend->ev_loop = libev_new_loop();
 
   // start async watcher used for breaking a poll op (from another thread)
@@ -131,6 +247,10 @@ static VALUE Backend_initialize(VALUE self) {
   // block when no other watcher is active
   ev_unref(backend->ev_loop);
 
+  // the signal watcher is started once a signal is trapped using the signalfd
+  ev_io_init(&backend->signal_watcher.io, signal_watcher_callback, -1, EV_READ);
+  backend->signal_watcher.source = &backend->base.signal_source;
+
   return Qnil;
 }
 
@@ -138,7 +258,16 @@ VALUE Backend_finalize(VALUE self) {
   Backend_t *backend;
   GetBackend(self, backend);
 
-   ev_async_stop(backend->ev_loop, &backend->break_async);
+  // the stall detector's watchdog thread and the profiler's sampler thread
+  // signal the backend's thread, so they must be stopped before it exits
+  stall_detector_stop(&backend->base.stall_detector);
+  profiler_stop(&backend->base.profiler);
+
+  ev_async_stop(backend->ev_loop, &backend->break_async);
+  if (ev_is_active(&backend->signal_watcher.io)) {
+    ev_ref(backend->ev_loop);
+    ev_io_stop(backend->ev_loop, &backend->signal_watcher.io);
+  }
 
   if (!ev_is_default_loop(backend->ev_loop)) ev_loop_destroy(backend->ev_loop);
 
@@ -159,15 +288,25 @@ VALUE Backend_post_fork(VALUE self) {
 
   backend_base_reset(&backend->base);
 
+  // trapped signals stay blocked in the child, so the signalfd is watched by
+  // the new loop
+  if (SIGNAL_SOURCE_ACTIVE(&backend->base.signal_source))
+    libev_start_signal_watcher(backend);
+
   return self;
 }
 
 inline VALUE Backend_poll(VALUE self, VALUE blocking) {
   Backend_t *backend;
+  uint64_t trace_stamp;
   GetBackend(self, backend);
 
   backend->base.poll_count++;
+  backend->base.heartbeat++;
 
+  trace_stamp = NATIVE_TRACE_STAMP(&backend->base);
+  NATIVE_TRACE(&backend->base, TRACE_EVENT_ENTER_POLL, rb_fiber_current(), 0, -1, blocking == Qtrue, 0);
+  USDT_PROBE1(poll_enter, blocking == Qtrue);
   COND_TRACE(&backend->base, 2, SYM_enter_poll, rb_fiber_current());
 
 ev_run:
@@ -176,7 +315,10 @@ ev_run:
   ev_run(backend->ev_loop, blocking == Qtrue ? EVRUN_ONCE : EVRUN_NOWAIT);
   backend->base.currently_polling = 0;
   if (errno == EINTR && runqueue_empty_p(&backend->base.runqueue)) goto ev_run;
+  if (backend->base.signal_source.ready) signal_source_dispatch(&backend->base.signal_source);
 
+  NATIVE_TRACE(&backend->base, TRACE_EVENT_LEAVE_POLL, rb_fiber_current(), 0, -1, blocking == Qtrue, trace_stamp);
+  USDT_PROBE1(poll_leave, blocking == Qtrue);
   COND_TRACE(&backend->base, 2, SYM_leave_poll, rb_fiber_current());
 
   return self;
@@ -227,6 +369,13 @@ inline struct backend_stats backend_get_stats(VALUE self) {
   return backend_base_stats(&backend->base);
 }
 
+inline struct Backend_base *backend_get_base(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  return &backend->base;
+}
+
 struct libev_io {
   struct ev_io io;
   VALUE fiber;
@@ -247,7 +396,7 @@ VALUE libev_wait_fd_with_watcher(Backend_t *backend, int fd, struct libev_io *wa
   }
   ev_io_start(backend->ev_loop, &watcher->io);
 
-  switchpoint_result = backend_await((struct Backend_base *)backend);
+  switchpoint_result = libev_await(backend, events == EV_READ ? LIBEV_OP_READABLE : LIBEV_OP_WRITABLE, fd);
 
   ev_io_stop(backend->ev_loop, &watcher->io);
   RB_GC_GUARD(switchpoint_result);
@@ -284,8 +433,25 @@ static inline int fd_from_io(VALUE io, rb_io_t **fptr, int write_mode, int recti
   }
 }
 
+// The libev backend has no notion of registered buffers, so fixed buffers are
+// just regular heap-allocated buffers.
+void Backend_acquire_fixed_buffer(VALUE self, int len, struct buffer_spec *spec) {
+  spec->ptr = malloc(len);
+  spec->len = len;
+  spec->fixed = 0;
+  if (!spec->ptr)
+    rb_raise(rb_eRuntimeError, "Failed to allocate buffer");
+}
+
+void Backend_release_fixed_buffer(VALUE self, struct buffer_spec *spec) {
+  free(spec->ptr);
+  spec->ptr = NULL;
+  spec->len = 0;
+}
+
 VALUE Backend_read(VALUE self, VALUE io, VALUE buffer, VALUE length, VALUE to_eof, VALUE pos) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_io watcher;
   int fd;
   rb_io_t *fptr;
@@ -299,13 +465,15 @@ VALUE Backend_read(VALUE self, VALUE io, VALUE buffer, VALUE length, VALUE to_eo
   backend_prepare_read_buffer(buffer, length, &buffer_spec, FIX2INT(pos));
   fd = fd_from_io(io, &fptr, 0, 1);
   watcher.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_READ, fd, buffer_spec.len);
 
   while (1) {
     backend->base.op_count++;
     ssize_t result = read(fd, buffer_spec.ptr, buffer_spec.len);
+    backend_count_bytes(&backend->base, BACKEND_OP_DIR_READ, result);
     if (result < 0) {
       int e = errno;
-      if (e != EWOULDBLOCK && e != EAGAIN) rb_syserr_fail(e, strerror(e));
+      if (e != EWOULDBLOCK && e != EAGAIN) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_READ);
 
@@ -334,6 +502,7 @@ VALUE Backend_read(VALUE self, VALUE io, VALUE buffer, VALUE length, VALUE to_eo
     }
   }
 
+  backend_trace_op_done(&backend->base, &trace, total, 0);
   if (!total) return Qnil;
 
   if (!buffer_spec.raw) backend_finalize_string_buffer(buffer, &buffer_spec, total, fptr);
@@ -343,6 +512,56 @@ VALUE Backend_read(VALUE self, VALUE io, VALUE buffer, VALUE length, VALUE to_eo
 
   return buffer_spec.raw ? INT2FIX(total) : buffer;
 error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
+  return RAISE_EXCEPTION(switchpoint_result);
+}
+
+VALUE Backend_readv(VALUE self, VALUE io, VALUE buffers, VALUE maxlen) {
+  Backend_t *backend;
+  struct backend_op_trace trace;
+  struct libev_io watcher;
+  int fd;
+  rb_io_t *fptr;
+  struct iovec iovs[BACKEND_READV_MAX];
+  int iov_count = backend_prepare_readv(buffers, maxlen, iovs);
+  VALUE switchpoint_result = Qnil;
+  ssize_t result;
+
+  GetBackend(self, backend);
+  fd = fd_from_io(io, &fptr, 0, 1);
+  watcher.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_READV, fd, 0);
+
+  while (1) {
+    backend->base.op_count++;
+    result = readv(fd, iovs, iov_count);
+    backend_count_bytes(&backend->base, BACKEND_OP_DIR_READ, result);
+    if (result < 0) {
+      int e = errno;
+      if (e != EWOULDBLOCK && e != EAGAIN) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
+
+      switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_READ);
+
+      if (TEST_EXCEPTION(switchpoint_result)) goto error;
+    }
+    else break;
+  }
+
+  if (watcher.fiber == Qnil) {
+    switchpoint_result = backend_snooze(&backend->base);
+    if (TEST_EXCEPTION(switchpoint_result)) goto error;
+  }
+
+  RB_GC_GUARD(watcher.fiber);
+  RB_GC_GUARD(switchpoint_result);
+
+  backend_trace_op_done(&backend->base, &trace, result, 0);
+  if (!result) return Qnil;
+
+  backend_finalize_readv(buffers, iovs, result);
+  return LONG2NUM(result);
+error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
   return RAISE_EXCEPTION(switchpoint_result);
 }
 
@@ -352,6 +571,7 @@ VALUE Backend_recv(VALUE self, VALUE io, VALUE buffer, VALUE length, VALUE pos)
 
 VALUE Backend_recvmsg(VALUE self, VALUE io, VALUE buffer, VALUE maxlen, VALUE pos, VALUE flags, VALUE maxcontrollen, VALUE opts) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_io watcher;
   int fd;
   rb_io_t *fptr;
@@ -364,28 +584,32 @@ VALUE Backend_recvmsg(VALUE self, VALUE io, VALUE buffer, VALUE maxlen, VALUE po
   backend_prepare_read_buffer(buffer, maxlen, &buffer_spec, FIX2INT(pos));
   fd = fd_from_io(io, &fptr, 0, 1);
   watcher.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_RECVMSG, fd, buffer_spec.len);
 
-  char addr_buffer[64];
+  struct sockaddr_storage addr_buffer;
   struct iovec iov;
   struct msghdr msg;
+  long controllen = NIL_P(maxcontrollen) ? 0 : NUM2LONG(maxcontrollen);
+  VALUE control = controllen > 0 ? rb_str_buf_new(controllen) : Qnil;
 
-  iov.iov_base = StringValuePtr(buffer);
-  iov.iov_len = maxlen;
+  iov.iov_base = buffer_spec.ptr;
+  iov.iov_len = buffer_spec.len;
 
-  msg.msg_name = addr_buffer;
+  msg.msg_name = &addr_buffer;
   msg.msg_namelen = sizeof(addr_buffer);
   msg.msg_iov = &iov;
   msg.msg_iovlen = 1;
-  msg.msg_control = 0;
-  msg.msg_controllen = 0;
+  msg.msg_control = controllen > 0 ? RSTRING_PTR(control) : 0;
+  msg.msg_controllen = controllen;
   msg.msg_flags = 0;
 
   while (1) {
     backend->base.op_count++;
     ssize_t result = recvmsg(fd, &msg, NUM2INT(flags));
+    backend_count_bytes(&backend->base, BACKEND_OP_DIR_READ, result);
     if (result < 0) {
       int e = errno;
-      if (e != EWOULDBLOCK && e != EAGAIN) rb_syserr_fail(e, strerror(e));
+      if (e != EWOULDBLOCK && e != EAGAIN) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_READ);
 
@@ -402,21 +626,80 @@ VALUE Backend_recvmsg(VALUE self, VALUE io, VALUE buffer, VALUE maxlen, VALUE po
     }
   }
 
+  backend_trace_op_done(&backend->base, &trace, total, 0);
   if (!total) return Qnil;
 
   if (!buffer_spec.raw) backend_finalize_string_buffer(buffer, &buffer_spec, total, fptr);
   VALUE addr = name_to_addrinfo(msg.msg_name, msg.msg_namelen);
   VALUE rflags = INT2NUM(msg.msg_flags);
 
-  return rb_ary_new_from_args(3, buffer, addr, rflags);
+  VALUE result = rb_ary_new_from_args(3, buffer, addr, rflags);
+  backend_push_cmsgs(result, &msg);
+
+  RB_GC_GUARD(control);
+  return result;
   RB_GC_GUARD(addr);
   RB_GC_GUARD(watcher.fiber);
   RB_GC_GUARD(switchpoint_result);
+error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
+  return RAISE_EXCEPTION(switchpoint_result);
+}
+
+#ifdef POLYPHONY_LINUX
+VALUE Backend_recv_batch(VALUE self, VALUE io, VALUE count, VALUE maxlen, VALUE flags) {
+  Backend_t *backend;
+  struct libev_io watcher;
+  int fd;
+  rb_io_t *fptr;
+  VALUE switchpoint_result = Qnil;
+  VALUE buffer;
+  int count_int = FIX2INT(count);
+  int maxlen_int = FIX2INT(maxlen);
+  int flags_int = FIX2INT(flags);
+  int received;
+
+  struct mmsghdr msgs[BACKEND_BATCH_MAX];
+  struct iovec iovs[BACKEND_BATCH_MAX];
+  struct sockaddr_storage addrs[BACKEND_BATCH_MAX];
+
+  if (count_int < 1 || maxlen_int < 1)
+    rb_raise(rb_eArgError, "count and maxlen must be positive");
+  if (count_int > BACKEND_BATCH_MAX) count_int = BACKEND_BATCH_MAX;
+
+  GetBackend(self, backend);
+  fd = fd_from_io(io, &fptr, 0, 0);
+  watcher.fiber = Qnil;
+
+  buffer = rb_str_buf_new((long)count_int * maxlen_int);
+  backend_recv_batch_prepare(msgs, iovs, addrs, RSTRING_PTR(buffer), count_int, maxlen_int);
+
+  while (1) {
+    backend->base.op_count++;
+    received = recvmmsg(fd, msgs, count_int, flags_int, NULL);
+    if (received >= 0) break;
+
+    int e = errno;
+    if (e != EWOULDBLOCK && e != EAGAIN) LIBEV_SYSERR_FAIL(backend, e);
+
+    switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_READ);
+    if (TEST_EXCEPTION(switchpoint_result)) goto error;
+  }
+
+  switchpoint_result = backend_snooze(&backend->base);
+  if (TEST_EXCEPTION(switchpoint_result)) goto error;
+
+  RB_GC_GUARD(buffer);
+  RB_GC_GUARD(watcher.fiber);
+  RB_GC_GUARD(switchpoint_result);
+
+  return backend_recv_batch_result(msgs, received);
 error:
   return RAISE_EXCEPTION(switchpoint_result);
 }
+#endif
 
-VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen) {
+VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen, VALUE reuse) {
   Backend_t *backend;
   struct libev_io watcher;
   int fd;
@@ -424,11 +707,12 @@ VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen) {
   VALUE buffer;
   long total;
   char *ptr;
-  long len = FIX2INT(maxlen);
+  VALUE io_buffer = backend_read_loop_io_buffer(maxlen);
+  long len = io_buffer == Qnil ? FIX2INT(maxlen) : 0;
   int shrinkable;
   VALUE switchpoint_result = Qnil;
 
-  READ_LOOP_PREPARE_STR();
+  READ_LOOP_PREPARE();
 
   GetBackend(self, backend);
   fd = fd_from_io(io, &fptr, 0, 1);
@@ -437,9 +721,10 @@ VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen) {
   while (1) {
     backend->base.op_count++;
     ssize_t n = read(fd, ptr, len);
+    backend_count_bytes(&backend->base, BACKEND_OP_DIR_READ, n);
     if (n < 0) {
       int e = errno;
-      if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_SYSERR_FAIL(backend, e);
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_READ);
       if (TEST_EXCEPTION(switchpoint_result)) goto error;
@@ -451,7 +736,7 @@ VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen) {
 
       if (n == 0) break; // EOF
       total = n;
-      READ_LOOP_YIELD_STR();
+      READ_LOOP_YIELD();
     }
   }
 
@@ -486,9 +771,10 @@ VALUE Backend_feed_loop(VALUE self, VALUE io, VALUE receiver, VALUE method) {
   while (1) {
     backend->base.op_count++;
     ssize_t n = read(fd, ptr, len);
+    backend_count_bytes(&backend->base, BACKEND_OP_DIR_READ, n);
     if (n < 0) {
       int e = errno;
-      if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_SYSERR_FAIL(backend, e);
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_READ);
       if (TEST_EXCEPTION(switchpoint_result)) goto error;
@@ -515,6 +801,7 @@ error:
 
 VALUE Backend_write(VALUE self, VALUE io, VALUE buffer) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_io watcher;
   int fd;
   rb_io_t *fptr;
@@ -526,13 +813,15 @@ VALUE Backend_write(VALUE self, VALUE io, VALUE buffer) {
   GetBackend(self, backend);
   fd = fd_from_io(io, &fptr, 1, 0);
   watcher.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_WRITE, fd, buffer_spec.len);
 
   while (left > 0) {
     backend->base.op_count++;
     ssize_t result = write(fd, buffer_spec.ptr, left);
+    backend_count_bytes(&backend->base, BACKEND_OP_DIR_WRITE, result);
     if (result < 0) {
       int e = errno;
-      if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_WRITE);
 
@@ -553,13 +842,16 @@ VALUE Backend_write(VALUE self, VALUE io, VALUE buffer) {
   RB_GC_GUARD(watcher.fiber);
   RB_GC_GUARD(switchpoint_result);
 
+  backend_trace_op_done(&backend->base, &trace, buffer_spec.len, 0);
   return INT2FIX(buffer_spec.len);
 error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
   return RAISE_EXCEPTION(switchpoint_result);
 }
 
 VALUE Backend_writev(VALUE self, VALUE io, int argc, VALUE *argv) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_io watcher;
   int fd;
   rb_io_t *fptr;
@@ -576,21 +868,23 @@ VALUE Backend_writev(VALUE self, VALUE io, int argc, VALUE *argv) {
 
   iov = malloc(iov_count * sizeof(struct iovec));
   for (int i = 0; i < argc; i++) {
-    VALUE buffer = argv[i];
-    iov[i].iov_base = StringValuePtr(buffer);
-    iov[i].iov_len = RSTRING_LEN(buffer);
+    struct backend_buffer_spec buffer_spec = backend_get_buffer_spec(coerce_io_string_or_buffer(argv[i]), 1);
+    iov[i].iov_base = buffer_spec.ptr;
+    iov[i].iov_len = buffer_spec.len;
     total_length += iov[i].iov_len;
   }
   iov_ptr = iov;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_WRITEV, fd, total_length);
 
   while (1) {
     backend->base.op_count++;
     ssize_t n = writev(fd, iov_ptr, iov_count);
+    backend_count_bytes(&backend->base, BACKEND_OP_DIR_WRITE, n);
     if (n < 0) {
       int e = errno;
       if ((e != EWOULDBLOCK && e != EAGAIN)) {
         free(iov);
-        rb_syserr_fail(e, strerror(e));
+        LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
       }
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_WRITE);
@@ -623,9 +917,11 @@ VALUE Backend_writev(VALUE self, VALUE io, int argc, VALUE *argv) {
   RB_GC_GUARD(watcher.fiber);
   RB_GC_GUARD(switchpoint_result);
 
+  backend_trace_op_done(&backend->base, &trace, total_written, 0);
   free(iov);
   return INT2FIX(total_written);
 error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
   free(iov);
   return RAISE_EXCEPTION(switchpoint_result);
 }
@@ -642,6 +938,7 @@ VALUE Backend_write_m(int argc, VALUE *argv, VALUE self) {
 
 VALUE Backend_accept(VALUE self, VALUE server_socket, VALUE socket_class) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_io watcher;
   int server_fd;
   rb_io_t *server_fptr;
@@ -653,13 +950,14 @@ VALUE Backend_accept(VALUE self, VALUE server_socket, VALUE socket_class) {
   GetBackend(self, backend);
   server_fd = fd_from_io(server_socket, &server_fptr, 0, 0);
   watcher.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_ACCEPT, server_fd, 0);
 
   while (1) {
     backend->base.op_count++;
     fd = accept(server_fd, &addr, &len);
     if (fd < 0) {
       int e = errno;
-      if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, server_fd, &watcher, EV_READ);
 
@@ -687,12 +985,14 @@ VALUE Backend_accept(VALUE self, VALUE server_socket, VALUE socket_class) {
       // if (rsock_do_not_reverse_lookup) {
 	    //   fp->mode |= FMODE_NOREVLOOKUP;
       // }
+  backend_trace_op_done(&backend->base, &trace, fd, 0);
       return socket;
     }
   }
   RB_GC_GUARD(switchpoint_result);
   return Qnil;
 error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
   return RAISE_EXCEPTION(switchpoint_result);
 }
 
@@ -715,7 +1015,7 @@ VALUE Backend_accept_loop(VALUE self, VALUE server_socket, VALUE socket_class) {
     int fd = accept(server_fd, &addr, &len);
     if (fd < 0) {
       int e = errno;
-      if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_SYSERR_FAIL(backend, e);
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, server_fd, &watcher, EV_READ);
 
@@ -754,6 +1054,7 @@ error:
 
 VALUE Backend_connect(VALUE self, VALUE sock, VALUE host, VALUE port) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_io watcher;
   int fd;
   rb_io_t *fptr;
@@ -766,12 +1067,13 @@ VALUE Backend_connect(VALUE self, VALUE sock, VALUE host, VALUE port) {
   GetBackend(self, backend);
   fd = fd_from_io(sock, &fptr, 1, 0);
   watcher.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_CONNECT, fd, 0);
 
   backend->base.op_count++;
   int result = connect(fd, ai_addr, ai_addrlen);
   if (result < 0) {
     int e = errno;
-    if (e != EINPROGRESS) rb_syserr_fail(e, strerror(e));
+    if (e != EINPROGRESS) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
     switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_WRITE);
 
@@ -783,13 +1085,16 @@ VALUE Backend_connect(VALUE self, VALUE sock, VALUE host, VALUE port) {
     if (TEST_EXCEPTION(switchpoint_result)) goto error;
   }
   RB_GC_GUARD(switchpoint_result);
+  backend_trace_op_done(&backend->base, &trace, 0, 0);
   return sock;
 error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
   return RAISE_EXCEPTION(switchpoint_result);
 }
 
 VALUE Backend_send(VALUE self, VALUE io, VALUE buffer, VALUE flags) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_io watcher;
   int fd;
   rb_io_t *fptr;
@@ -802,13 +1107,15 @@ VALUE Backend_send(VALUE self, VALUE io, VALUE buffer, VALUE flags) {
   GetBackend(self, backend);
   fd = fd_from_io(io, &fptr, 1, 0);
   watcher.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_SEND, fd, buffer_spec.len);
 
   while (left > 0) {
     backend->base.op_count++;
     ssize_t result = send(fd, buffer_spec.ptr, left, flags_int);
+    backend_count_bytes(&backend->base, BACKEND_OP_DIR_WRITE, result);
     if (result < 0) {
       int e = errno;
-      if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_WRITE);
 
@@ -829,13 +1136,16 @@ VALUE Backend_send(VALUE self, VALUE io, VALUE buffer, VALUE flags) {
   RB_GC_GUARD(watcher.fiber);
   RB_GC_GUARD(switchpoint_result);
 
+  backend_trace_op_done(&backend->base, &trace, buffer_spec.len, 0);
   return INT2FIX(buffer_spec.len);
 error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
   return RAISE_EXCEPTION(switchpoint_result);
 }
 
 VALUE Backend_sendmsg(VALUE self, VALUE io, VALUE buffer, VALUE flags, VALUE dest_sockaddr, VALUE controls) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_io watcher;
   int fd;
   rb_io_t *fptr;
@@ -844,10 +1154,12 @@ VALUE Backend_sendmsg(VALUE self, VALUE io, VALUE buffer, VALUE flags, VALUE des
   struct backend_buffer_spec buffer_spec = backend_get_buffer_spec(buffer, 1);
   long left = buffer_spec.len;
   int flags_int = FIX2INT(flags);
+  VALUE control = backend_build_cmsgs(controls);
 
   GetBackend(self, backend);
   fd = fd_from_io(io, &fptr, 1, 0);
   watcher.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_SENDMSG, fd, buffer_spec.len);
 
   struct iovec iov;
   struct msghdr msg;
@@ -865,16 +1177,17 @@ VALUE Backend_sendmsg(VALUE self, VALUE io, VALUE buffer, VALUE flags, VALUE des
   }
   msg.msg_iov = &iov;
   msg.msg_iovlen = 1;
-  msg.msg_control = 0;
-  msg.msg_controllen = 0;
+  msg.msg_control = control == Qnil ? 0 : RSTRING_PTR(control);
+  msg.msg_controllen = control == Qnil ? 0 : RSTRING_LEN(control);
   msg.msg_flags = 0;
 
   while (left > 0) {
     backend->base.op_count++;
     ssize_t result = sendmsg(fd, &msg, flags_int);
+    backend_count_bytes(&backend->base, BACKEND_OP_DIR_WRITE, result);
     if (result < 0) {
       int e = errno;
-      if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
       switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_WRITE);
 
@@ -896,11 +1209,65 @@ VALUE Backend_sendmsg(VALUE self, VALUE io, VALUE buffer, VALUE flags, VALUE des
   RB_GC_GUARD(watcher.fiber);
   RB_GC_GUARD(switchpoint_result);
 
+  backend_trace_op_done(&backend->base, &trace, buffer_spec.len, 0);
   return INT2FIX(buffer_spec.len);
 error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
   return RAISE_EXCEPTION(switchpoint_result);
 }
 
+#ifdef POLYPHONY_LINUX
+VALUE Backend_send_batch(VALUE self, VALUE io, VALUE datagrams, VALUE flags) {
+  Backend_t *backend;
+  struct libev_io watcher;
+  int fd;
+  rb_io_t *fptr;
+  VALUE switchpoint_result = Qnil;
+  int flags_int = FIX2INT(flags);
+  long total;
+  long sent = 0;
+
+  struct mmsghdr msgs[BACKEND_BATCH_MAX];
+  struct iovec iovs[BACKEND_BATCH_MAX];
+
+  Check_Type(datagrams, T_ARRAY);
+  total = RARRAY_LEN(datagrams);
+
+  GetBackend(self, backend);
+  fd = fd_from_io(io, &fptr, 1, 0);
+  watcher.fiber = Qnil;
+
+  while (sent < total) {
+    int count = backend_send_batch_prepare(msgs, iovs, datagrams, sent);
+
+    backend->base.op_count++;
+    int result = sendmmsg(fd, msgs, count, flags_int);
+    if (result < 0) {
+      int e = errno;
+      if (e != EWOULDBLOCK && e != EAGAIN) LIBEV_SYSERR_FAIL(backend, e);
+
+      switchpoint_result = libev_wait_fd_with_watcher(backend, fd, &watcher, EV_WRITE);
+      if (TEST_EXCEPTION(switchpoint_result)) goto error;
+    }
+    else
+      sent += result;
+  }
+
+  if (watcher.fiber == Qnil) {
+    switchpoint_result = backend_snooze(&backend->base);
+    if (TEST_EXCEPTION(switchpoint_result)) goto error;
+  }
+
+  RB_GC_GUARD(datagrams);
+  RB_GC_GUARD(watcher.fiber);
+  RB_GC_GUARD(switchpoint_result);
+
+  return LONG2FIX(sent);
+error:
+  return RAISE_EXCEPTION(switchpoint_result);
+}
+#endif
+
 struct libev_rw_ctx {
   int ref_count;
   VALUE fiber;
@@ -943,7 +1310,7 @@ VALUE libev_wait_rw_fd_with_watcher(Backend_t *backend, int r_fd, int w_fd, stru
     watcher->ctx.ref_count++;
   }
 
-  switchpoint_result = backend_await((struct Backend_base *)backend);
+  switchpoint_result = libev_await(backend, LIBEV_OP_READWRITE, r_fd != -1 ? r_fd : w_fd);
 
   if (r_fd != -1) ev_io_stop(backend->ev_loop, &watcher->r.io);
   if (w_fd != -1) ev_io_stop(backend->ev_loop, &watcher->w.io);
@@ -954,6 +1321,7 @@ VALUE libev_wait_rw_fd_with_watcher(Backend_t *backend, int r_fd, int w_fd, stru
 #ifdef POLYPHONY_LINUX
 VALUE Backend_splice(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_rw_io watcher;
   VALUE switchpoint_result = Qnil;
   int src_fd;
@@ -970,13 +1338,14 @@ VALUE Backend_splice(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   src_fd = fd_from_io(src, &src_fptr, 0, 0);
   dest_fd = fd_from_io(dest, &dest_fptr, 1, 0);
   watcher.ctx.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_SPLICE, src_fd, maxlen_i);
 
   while (1) {
     backend->base.op_count++;
     len = splice(src_fd, 0, dest_fd, 0, maxlen_i, 0);
     if (len < 0) {
       int e = errno;
-      if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
       switchpoint_result = libev_wait_rw_fd_with_watcher(backend, src_fd, dest_fd, &watcher);
       if (TEST_EXCEPTION(switchpoint_result)) goto error;
@@ -995,13 +1364,16 @@ VALUE Backend_splice(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   RB_GC_GUARD(watcher.ctx.fiber);
   RB_GC_GUARD(switchpoint_result);
 
+  backend_trace_op_done(&backend->base, &trace, total, 0);
   return INT2FIX(total);
 error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
   return RAISE_EXCEPTION(switchpoint_result);
 }
 
 VALUE Backend_tee(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_rw_io watcher;
   VALUE switchpoint_result = Qnil;
   int src_fd;
@@ -1014,13 +1386,14 @@ VALUE Backend_tee(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   src_fd = fd_from_io(src, &src_fptr, 0, 0);
   dest_fd = fd_from_io(dest, &dest_fptr, 1, 0);
   watcher.ctx.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_TEE, src_fd, FIX2INT(maxlen));
 
   while (1) {
     backend->base.op_count++;
     len = tee(src_fd, dest_fd, FIX2INT(maxlen), 0);
     if (len < 0) {
       int e = errno;
-      if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
       switchpoint_result = libev_wait_rw_fd_with_watcher(backend, src_fd, dest_fd, &watcher);
       if (TEST_EXCEPTION(switchpoint_result)) goto error;
@@ -1038,13 +1411,66 @@ VALUE Backend_tee(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   RB_GC_GUARD(watcher.ctx.fiber);
   RB_GC_GUARD(switchpoint_result);
 
+  backend_trace_op_done(&backend->base, &trace, len, 0);
   return INT2FIX(len);
+error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
+  return RAISE_EXCEPTION(switchpoint_result);
+}
+#define SEND_FILE_MAX_CHUNK (1 << 20)
+
+VALUE Backend_send_file(VALUE self, VALUE src, VALUE dest, VALUE offset, VALUE length) {
+  Backend_t *backend;
+  struct libev_io watcher;
+  VALUE switchpoint_result = Qnil;
+  int src_fd;
+  int dest_fd;
+  rb_io_t *src_fptr;
+  rb_io_t *dest_fptr;
+  off_t pos = NUM2OFFT(offset);
+  long left = NIL_P(length) ? -1 : NUM2LONG(length);
+  long total = 0;
+
+  GetBackend(self, backend);
+  src_fd = fd_from_io(src, &src_fptr, 0, 0);
+  dest_fd = fd_from_io(dest, &dest_fptr, 1, 0);
+  watcher.fiber = Qnil;
+
+  while (left) {
+    size_t count = (left < 0 || left > SEND_FILE_MAX_CHUNK) ? SEND_FILE_MAX_CHUNK : left;
+    backend->base.op_count++;
+    ssize_t n = sendfile(dest_fd, src_fd, &pos, count);
+    if (n < 0) {
+      int e = errno;
+      if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_SYSERR_FAIL(backend, e);
+
+      switchpoint_result = libev_wait_fd_with_watcher(backend, dest_fd, &watcher, EV_WRITE);
+      if (TEST_EXCEPTION(switchpoint_result)) goto error;
+    }
+    else {
+      if (!n) break; // EOF
+
+      total += n;
+      if (left > 0) left -= n;
+    }
+  }
+
+  if (watcher.fiber == Qnil) {
+    switchpoint_result = backend_snooze(&backend->base);
+    if (TEST_EXCEPTION(switchpoint_result)) goto error;
+  }
+
+  RB_GC_GUARD(watcher.fiber);
+  RB_GC_GUARD(switchpoint_result);
+
+  return LONG2NUM(total);
 error:
   return RAISE_EXCEPTION(switchpoint_result);
 }
 #else
 VALUE Backend_splice(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   struct libev_io watcher;
   VALUE switchpoint_result = Qnil;
   int src_fd;
@@ -1063,6 +1489,7 @@ VALUE Backend_splice(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   src_fd = fd_from_io(src, &src_fptr, 0, 0);
   dest_fd = fd_from_io(dest, &dest_fptr, 1, 0);
   watcher.fiber = Qnil;
+  backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_SPLICE, src_fd, maxlen_i);
 
   while (1) {
     int done;
@@ -1072,7 +1499,7 @@ VALUE Backend_splice(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
       ssize_t n = read(src_fd, ptr, maxlen_i);
       if (n < 0) {
         int e = errno;
-        if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+        if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
         switchpoint_result = libev_wait_fd_with_watcher(backend, src_fd, &watcher, EV_READ);
         if (TEST_EXCEPTION(switchpoint_result)) goto error;
@@ -1089,7 +1516,7 @@ VALUE Backend_splice(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
       ssize_t n = write(dest_fd, ptr, left);
       if (n < 0) {
         int e = errno;
-        if ((e != EWOULDBLOCK && e != EAGAIN)) rb_syserr_fail(e, strerror(e));
+        if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_OP_SYSERR_FAIL(backend, &trace, e);
 
         switchpoint_result = libev_wait_fd_with_watcher(backend, dest_fd, &watcher, EV_WRITE);
 
@@ -1112,27 +1539,98 @@ VALUE Backend_splice(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   RB_GC_GUARD(switchpoint_result);
   RB_GC_GUARD(buffer);
 
+  backend_trace_op_done(&backend->base, &trace, total, 0);
   return INT2FIX(total);
 error:
+  backend_trace_op_done(&backend->base, &trace, 0, 1);
   return RAISE_EXCEPTION(switchpoint_result);
 }
 
 VALUE Backend_tee(VALUE self, VALUE src, VALUE dest, VALUE maxlen) {
   return self;
 }
+
+#define SEND_FILE_MAX_CHUNK (1 << 16)
+
+VALUE Backend_send_file(VALUE self, VALUE src, VALUE dest, VALUE offset, VALUE length) {
+  Backend_t *backend;
+  struct libev_io watcher;
+  VALUE switchpoint_result = Qnil;
+  int src_fd;
+  int dest_fd;
+  rb_io_t *src_fptr;
+  rb_io_t *dest_fptr;
+  off_t pos = NUM2OFFT(offset);
+  long left = NIL_P(length) ? -1 : NUM2LONG(length);
+  long total = 0;
+  VALUE buffer = rb_str_new(0, SEND_FILE_MAX_CHUNK);
+
+  GetBackend(self, backend);
+  src_fd = fd_from_io(src, &src_fptr, 0, 0);
+  dest_fd = fd_from_io(dest, &dest_fptr, 1, 0);
+  watcher.fiber = Qnil;
+
+  while (left) {
+    size_t count = (left < 0 || left > SEND_FILE_MAX_CHUNK) ? SEND_FILE_MAX_CHUNK : left;
+    char *ptr = RSTRING_PTR(buffer);
+    backend->base.op_count++;
+    ssize_t n = pread(src_fd, ptr, count, pos);
+    if (n < 0) LIBEV_SYSERR_FAIL(backend, errno);
+    if (!n) break; // EOF
+
+    pos += n;
+    if (left > 0) left -= n;
+    while (n > 0) {
+      backend->base.op_count++;
+      ssize_t written = write(dest_fd, ptr, n);
+      if (written < 0) {
+        int e = errno;
+        if ((e != EWOULDBLOCK && e != EAGAIN)) LIBEV_SYSERR_FAIL(backend, e);
+
+        switchpoint_result = libev_wait_fd_with_watcher(backend, dest_fd, &watcher, EV_WRITE);
+        if (TEST_EXCEPTION(switchpoint_result)) goto error;
+      }
+      else {
+        ptr += written;
+        n -= written;
+        total += written;
+      }
+    }
+  }
+
+  if (watcher.fiber == Qnil) {
+    switchpoint_result = backend_snooze(&backend->base);
+    if (TEST_EXCEPTION(switchpoint_result)) goto error;
+  }
+
+  RB_GC_GUARD(watcher.fiber);
+  RB_GC_GUARD(switchpoint_result);
+  RB_GC_GUARD(buffer);
+
+  return LONG2NUM(total);
+error:
+  return RAISE_EXCEPTION(switchpoint_result);
+}
 #endif
 
 VALUE Backend_wait_io(VALUE self, VALUE io, VALUE write) {
   Backend_t *backend;
+  struct backend_op_trace trace;
   int fd;
   rb_io_t *fptr;
   int write_mode = RTEST(write);
   int events = write_mode ? EV_WRITE : EV_READ;
+  VALUE switchpoint_result;
   GetBackend(self, backend);
   fd = fd_from_io(io, &fptr, write_mode, 0);
 
   backend->base.op_count++;
-  return libev_wait_fd(backend, fd, events, 1);
+  backend_trace_op_submit(&backend->base, &trace, 0, write_mode ? LIBEV_OP_WRITABLE : LIBEV_OP_READABLE, fd, 0);
+  switchpoint_result = libev_wait_fd(backend, fd, events, 0);
+  backend_trace_op_done(&backend->base, &trace, 0, TEST_EXCEPTION(switchpoint_result));
+  RAISE_IF_EXCEPTION(switchpoint_result);
+  RB_GC_GUARD(switchpoint_result);
+  return switchpoint_result;
 }
 
 struct libev_timer {
@@ -1157,7 +1655,7 @@ VALUE Backend_sleep(VALUE self, VALUE duration) {
   ev_timer_start(backend->ev_loop, &watcher.timer);
   backend->base.op_count++;
 
-  switchpoint_result = backend_await((struct Backend_base *)backend);
+  switchpoint_result = libev_await_op(backend, LIBEV_OP_SLEEP, -1);
 
   ev_timer_stop(backend->ev_loop, &watcher.timer);
   RAISE_IF_EXCEPTION(switchpoint_result);
@@ -1185,7 +1683,7 @@ noreturn VALUE Backend_timer_loop(VALUE self, VALUE interval) {
       ev_timer_init(&watcher.timer, Backend_timer_callback, sleep_duration, 0.);
       ev_timer_start(backend->ev_loop, &watcher.timer);
       backend->base.op_count++;
-      resume_value = backend_await((struct Backend_base *)backend);
+      resume_value = libev_await_op(backend, LIBEV_OP_TIMER, -1);
       ev_timer_stop(backend->ev_loop, &watcher.timer);
       RAISE_IF_EXCEPTION(resume_value);
     }
@@ -1265,10 +1763,13 @@ VALUE Backend_waitpid(VALUE self, VALUE pid) {
   int fd = pidfd_open(pid_int, 0);
   if (fd >= 0) {
     Backend_t *backend;
+    struct backend_op_trace trace;
     GetBackend(self, backend);
     backend->base.op_count++;
 
+    backend_trace_op_submit(&backend->base, &trace, 0, LIBEV_OP_WAITPID, fd, 0);
     VALUE resume_value = libev_wait_fd(backend, fd, EV_READ, 0);
+    backend_trace_op_done(&backend->base, &trace, 0, TEST_EXCEPTION(resume_value));
     close(fd);
     RAISE_IF_EXCEPTION(resume_value);
     RB_GC_GUARD(resume_value);
@@ -1286,6 +1787,52 @@ VALUE Backend_waitpid(VALUE self, VALUE pid) {
   }
   return rb_ary_new_from_args(2, INT2FIX(ret), INT2FIX(WEXITSTATUS(status)));
 }
+
+static inline void libev_stop_pidfd_watchers(Backend_t *backend, struct libev_io *watchers, long count) {
+  for (long i = 0; i < count; i++) {
+    ev_io_stop(backend->ev_loop, &watchers[i].io);
+    close(watchers[i].io.fd);
+  }
+}
+
+VALUE Backend_waitpid_any(VALUE self, VALUE pids) {
+  Backend_t *backend;
+  struct libev_io *watchers;
+  VALUE watchers_alloc = 0;
+  VALUE resume_value;
+  long count;
+  GetBackend(self, backend);
+
+  Check_Type(pids, T_ARRAY);
+  count = RARRAY_LEN(pids);
+  if (!count) return rb_ary_new();
+
+  watchers = ALLOCV_N(struct libev_io, watchers_alloc, count);
+  for (long i = 0; i < count; i++) {
+    int fd = pidfd_open(NUM2INT(RARRAY_AREF(pids, i)), 0);
+    if (fd < 0) {
+      int e = errno;
+      libev_stop_pidfd_watchers(backend, watchers, i);
+      ALLOCV_END(watchers_alloc);
+      // the child was already reaped by other means, so there's nothing to
+      // wait for, and it is returned with a nil exit status
+      if (e == ESRCH) return backend_reap_children(pids);
+      LIBEV_SYSERR_FAIL(backend, e);
+    }
+    watchers[i].fiber = rb_fiber_current();
+    ev_io_init(&watchers[i].io, Backend_io_callback, fd, EV_READ);
+    ev_io_start(backend->ev_loop, &watchers[i].io);
+  }
+  backend->base.op_count++;
+
+  resume_value = libev_await_op(backend, LIBEV_OP_WAITPID, -1);
+  libev_stop_pidfd_watchers(backend, watchers, count);
+  ALLOCV_END(watchers_alloc);
+  RAISE_IF_EXCEPTION(resume_value);
+  RB_GC_GUARD(resume_value);
+
+  return backend_reap_children(pids);
+}
 #else
 struct libev_child {
   struct ev_child child;
@@ -1312,7 +1859,7 @@ VALUE Backend_waitpid(VALUE self, VALUE pid) {
   ev_child_start(backend->ev_loop, &watcher.child);
   backend->base.op_count++;
 
-  switchpoint_result = backend_await((struct Backend_base *)backend);
+  switchpoint_result = libev_await_op(backend, LIBEV_OP_WAITPID, -1);
 
   ev_child_stop(backend->ev_loop, &watcher.child);
   RAISE_IF_EXCEPTION(switchpoint_result);
@@ -1320,6 +1867,61 @@ VALUE Backend_waitpid(VALUE self, VALUE pid) {
   RB_GC_GUARD(switchpoint_result);
   return switchpoint_result;
 }
+
+struct libev_child_any {
+  struct ev_child child;
+  VALUE fiber;
+  VALUE results;
+};
+
+void Backend_child_any_callback(EV_P_ ev_child *w, int revents) {
+  struct libev_child_any *watcher = (struct libev_child_any *)w;
+  int exit_status = WEXITSTATUS(w->rstatus);
+
+  rb_ary_push(watcher->results, rb_ary_new_from_args(2, INT2FIX(w->rpid), INT2FIX(exit_status)));
+  Fiber_make_runnable(watcher->fiber, Qnil);
+}
+
+VALUE Backend_waitpid_any(VALUE self, VALUE pids) {
+  Backend_t *backend;
+  struct libev_child_any *watchers;
+  VALUE watchers_alloc = 0;
+  VALUE results = rb_ary_new();
+  VALUE switchpoint_result;
+  long count;
+  GetBackend(self, backend);
+
+  Check_Type(pids, T_ARRAY);
+  count = RARRAY_LEN(pids);
+  if (!count) return results;
+
+  // a child that was already reaped by other means is returned immediately
+  // with a nil exit status, since its watcher would never be triggered
+  for (long i = 0; i < count; i++) {
+    int pid = NUM2INT(RARRAY_AREF(pids, i));
+    if (kill(pid, 0) < 0 && errno == ESRCH)
+      rb_ary_push(results, rb_ary_new_from_args(2, INT2FIX(pid), Qnil));
+  }
+  if (RARRAY_LEN(results)) return results;
+
+  watchers = ALLOCV_N(struct libev_child_any, watchers_alloc, count);
+  for (long i = 0; i < count; i++) {
+    watchers[i].fiber = rb_fiber_current();
+    watchers[i].results = results;
+    ev_child_init(&watchers[i].child, Backend_child_any_callback, NUM2INT(RARRAY_AREF(pids, i)), 0);
+    ev_child_start(backend->ev_loop, &watchers[i].child);
+  }
+  backend->base.op_count++;
+
+  switchpoint_result = libev_await_op(backend, LIBEV_OP_WAITPID, -1);
+
+  for (long i = 0; i < count; i++) ev_child_stop(backend->ev_loop, &watchers[i].child);
+  ALLOCV_END(watchers_alloc);
+  RAISE_IF_EXCEPTION(switchpoint_result);
+  RB_GC_GUARD(switchpoint_result);
+  RB_GC_GUARD(results);
+  return results;
+}
 #endif
 
 void Backend_async_callback(EV_P_ ev_async *w, int revents) { }
@@ -1335,7 +1937,7 @@ VALUE Backend_wait_event(VALUE self, VALUE raise) {
   ev_async_start(backend->ev_loop, &async);
   backend->base.op_count++;
 
-  switchpoint_result = backend_await((struct Backend_base *)backend);
+  switchpoint_result = libev_await_op(backend, LIBEV_OP_WAIT_EVENT, -1);
 
   ev_async_stop(backend->ev_loop, &async);
   if (RTEST(raise)) RAISE_IF_EXCEPTION(switchpoint_result);
@@ -1347,6 +1949,19 @@ VALUE Backend_kind(VALUE self) {
   return SYM_libev;
 }
 
+VALUE Backend_close(VALUE self, VALUE io) {
+  VALUE underlying_io;
+
+  if (rb_obj_class(io) == cPipe) {
+    if (!RTEST(Pipe_closed_p(io))) Pipe_close(io);
+    return Qnil;
+  }
+
+  underlying_io = rb_ivar_get(io, ID_ivar_io);
+  if (underlying_io != Qnil) io = underlying_io;
+  return rb_io_close(io);
+}
+
 VALUE Backend_chain(int argc,VALUE *argv, VALUE self) {
   VALUE result = Qnil;
   if (argc == 0) return result;
@@ -1555,7 +2170,7 @@ VALUE Backend_splice_chunks(VALUE self, VALUE src, VALUE dest, VALUE prefix, VAL
 syscallerror:
   if (pipefd[0] != -1) close(pipefd[0]);
   if (pipefd[1] != -1) close(pipefd[1]);
-  rb_syserr_fail(err, strerror(err));
+  LIBEV_SYSERR_FAIL(backend, err);
 error:
   if (pipefd[0] != -1) close(pipefd[0]);
   if (pipefd[1] != -1) close(pipefd[1]);
@@ -1573,19 +2188,52 @@ VALUE Backend_trace_proc_set(VALUE self, VALUE block) {
   Backend_t *backend;
   GetBackend(self, backend);
 
-  backend->base.trace_proc = block;
+  backend_trace_proc_set(&backend->base, block);
+  return self;
+}
+
+VALUE Backend_trace_buffer_start(int argc, VALUE *argv, VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  backend_trace_buffer_start(&backend->base, argc, argv);
+  return self;
+}
+
+VALUE Backend_trace_buffer_stop(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  backend_trace_buffer_stop(&backend->base);
   return self;
 }
 
+VALUE Backend_trace_buffer_read(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  return backend_trace_buffer_read(&backend->base);
+}
+
+VALUE Backend_trace_buffer_dropped(VALUE self) {
+  Backend_t *backend;
+  GetBackend(self, backend);
+
+  return backend_trace_buffer_dropped(&backend->base);
+}
+
 VALUE Backend_snooze(VALUE self) {
   VALUE ret;
   VALUE fiber = rb_fiber_current();
   Backend_t *backend;
+  uint64_t trace_stamp;
   GetBackend(self, backend);
 
+  trace_stamp = NATIVE_TRACE_STAMP(&backend->base);
   Fiber_make_runnable(fiber, Qnil);
   ret = backend_base_switch_fiber(self, &backend->base);
 
+  NATIVE_TRACE(&backend->base, TRACE_EVENT_UNBLOCK, fiber, 0, -1, 0, trace_stamp);
   COND_TRACE(&backend->base, 4, SYM_unblock, rb_fiber_current(), ret, CALLER());
 
   RAISE_IF_EXCEPTION(ret);
@@ -1618,12 +2266,26 @@ void Init_Backend(void) {
   rb_define_method(cBackend, "post_fork", Backend_post_fork, 0);
   rb_define_method(cBackend, "trace", Backend_trace, -1);
   rb_define_method(cBackend, "trace_proc=", Backend_trace_proc_set, 1);
+  rb_define_method(cBackend, "trace_buffer_start", Backend_trace_buffer_start, -1);
+  rb_define_method(cBackend, "trace_buffer_stop", Backend_trace_buffer_stop, 0);
+  rb_define_method(cBackend, "trace_buffer_read", Backend_trace_buffer_read, 0);
+  rb_define_method(cBackend, "trace_buffer_dropped", Backend_trace_buffer_dropped, 0);
+  rb_define_method(cBackend, "trace_ops=", Backend_trace_ops_set, 1);
   rb_define_method(cBackend, "stats", Backend_stats, 0);
+  rb_define_method(cBackend, "measure_schedule_delay=", Backend_measure_schedule_delay_set, 1);
+  rb_define_method(cBackend, "stall_detector_start", Backend_stall_detector_start, -1);
+  rb_define_method(cBackend, "stall_detector_stop", Backend_stall_detector_stop, 0);
+  rb_define_method(cBackend, "stall_events", Backend_stall_events, 0);
+  rb_define_method(cBackend, "profile_start", Backend_profile_start, -1);
+  rb_define_method(cBackend, "profile_stop", Backend_profile_stop, 0);
+  rb_define_method(cBackend, "profile_result", Backend_profile_result, 0);
+  rb_define_method(cBackend, "signalfd_trap", Backend_signalfd_trap, 2);
 
   rb_define_method(cBackend, "poll", Backend_poll, 1);
   rb_define_method(cBackend, "break", Backend_wakeup, 0);
   rb_define_method(cBackend, "kind", Backend_kind, 0);
   rb_define_method(cBackend, "chain", Backend_chain, -1);
+  rb_define_method(cBackend, "close", Backend_close, 1);
   rb_define_method(cBackend, "idle_gc_period=", Backend_idle_gc_period_set, 1);
   rb_define_method(cBackend, "idle_proc=", Backend_idle_proc_set, 1);
   rb_define_method(cBackend, "splice_chunks", Backend_splice_chunks, 7);
@@ -1633,14 +2295,20 @@ void Init_Backend(void) {
   rb_define_method(cBackend, "connect", Backend_connect, 3);
   rb_define_method(cBackend, "feed_loop", Backend_feed_loop, 3);
   rb_define_method(cBackend, "read", Backend_read, 5);
-  rb_define_method(cBackend, "read_loop", Backend_read_loop, 2);
+  rb_define_method(cBackend, "readv", Backend_readv, 3);
+  rb_define_method(cBackend, "read_loop", Backend_read_loop_m, -1);
   rb_define_method(cBackend, "recv", Backend_recv, 4);
   rb_define_method(cBackend, "recvmsg", Backend_recvmsg, 7);
-  rb_define_method(cBackend, "recv_loop", Backend_read_loop, 2);
+  rb_define_method(cBackend, "recv_loop", Backend_recv_loop_m, -1);
   rb_define_method(cBackend, "recv_feed_loop", Backend_feed_loop, 3);
   rb_define_method(cBackend, "send", Backend_send, 3);
   rb_define_method(cBackend, "sendmsg", Backend_sendmsg, 5);
+  #ifdef POLYPHONY_LINUX
+  rb_define_method(cBackend, "recv_batch", Backend_recv_batch, 4);
+  rb_define_method(cBackend, "send_batch", Backend_send_batch, 3);
+  #endif
   rb_define_method(cBackend, "sendv", Backend_sendv, 3);
+  rb_define_method(cBackend, "send_file", Backend_send_file, 4);
   rb_define_method(cBackend, "sleep", Backend_sleep, 1);
 
   rb_define_method(cBackend, "splice", Backend_splice, 3);
@@ -1653,6 +2321,8 @@ void Init_Backend(void) {
   rb_define_method(cBackend, "wait_event", Backend_wait_event, 1);
   rb_define_method(cBackend, "wait_io", Backend_wait_io, 2);
   rb_define_method(cBackend, "waitpid", Backend_waitpid, 1);
+  rb_define_method(cBackend, "waitpid_any", Backend_waitpid_any, 1);
+  rb_define_method(cBackend, "with_fixed_buffer", Backend_with_fixed_buffer, 1);
   rb_define_method(cBackend, "write", Backend_write_m, -1);
 
   SYM_libev = ID2SYM(rb_intern("libev"));
@@ -24,6 +24,7 @@ def get_config
   config[:multishot_accept]   = combined_version >= 519
   config[:submit_all_flag]    = combined_version >= 518
   config[:coop_taskrun_flag]  = combined_version >= 519
+  config[:cancel_fd]          = combined_version >= 519
 
   force_libev = ENV['POLYPHONY_LIBEV'] != nil
   config[:io_uring] = !force_libev && (combined_version >= 506) && (distribution != 'linuxkit')
@@ -65,6 +66,7 @@ if config[:io_uring]
   $defs << "-DHAVE_IO_URING_PREP_RECVMSG_MULTISHOT" if config[:multishot_recvmsg]
   $defs << "-DHAVE_IORING_SETUP_SUBMIT_ALL" if config[:submit_all_flag]
   $defs << "-DHAVE_IORING_SETUP_COOP_TASKRUN" if config[:coop_taskrun_flag]
+  $defs << "-DHAVE_IORING_ASYNC_CANCEL_FD" if config[:cancel_fd]
   $CFLAGS << " -Wno-pointer-arith"
 else
   $defs << "-DPOLYPHONY_BACKEND_LIBEV"
@@ -97,5 +99,7 @@ if RUBY_VERSION >= '3.1'
 end
 
 have_header('ruby/io/buffer.h')
+have_func('rb_postponed_job_preregister', 'ruby/debug.h')
+have_header('sys/sdt.h')
 
 create_makefile 'polyphony_ext'
@@ -190,6 +190,16 @@ VALUE Fiber_parked_p(VALUE self) {
   return rb_ivar_get(self, ID_ivar_parked);
 }
 
+/* Returns the id used to identify the fiber in native trace records (see
+ * `Polyphony::Trace.start_native`).
+ *
+ * @return [Integer] fiber trace id
+ */
+
+VALUE Fiber_trace_id(VALUE self) {
+  return ULL2NUM((uint64_t)self);
+}
+
 void Init_Fiber(void) {
   VALUE cFiber = rb_const_get(rb_cObject, rb_intern("Fiber"));
   rb_define_method(cFiber, "safe_transfer", Fiber_safe_transfer, -1);
@@ -197,6 +207,7 @@ void Init_Fiber(void) {
   rb_define_method(cFiber, "schedule_with_priority", Fiber_schedule_with_priority, -1);
   rb_define_method(cFiber, "state", Fiber_state, 0);
   rb_define_method(cFiber, "auto_watcher", Fiber_auto_watcher, 0);
+  rb_define_method(cFiber, "trace_id", Fiber_trace_id, 0);
 
   rb_define_method(cFiber, "<<", Fiber_send, 1);
   rb_define_method(cFiber, "send", Fiber_send, 1);
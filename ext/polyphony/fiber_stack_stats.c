@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "polyphony.h"
+
+// Fiber stacks are allocated by Ruby's fiber pool, which maps stacks in bulk
+// and reuses the stacks of terminated fibers, advising the kernel that their
+// memory may be reclaimed. Each stack is preceded by a guard page, so on Linux
+// the fiber stacks show up in /proc/self/maps as private anonymous read-write
+// mappings of the pool's stack size, each directly preceded by a single page
+// mapping with no access permissions. The pool's stack size is the sum of the
+// configured machine and VM stack sizes, rounded up to a whole page plus an
+// additional page.
+
+static VALUE SYM_machine_stack_size;
+static VALUE SYM_vm_stack_size;
+static VALUE SYM_stack_size;
+static VALUE SYM_stacks;
+static VALUE SYM_reserved;
+static VALUE SYM_resident;
+
+static inline size_t default_param(VALUE params, const char *name) {
+  VALUE value = rb_hash_aref(params, ID2SYM(rb_intern(name)));
+  return NIL_P(value) ? 0 : NUM2SIZET(value);
+}
+
+#ifdef POLYPHONY_LINUX
+
+// Scans the process's mappings for fiber stacks of the given size, counting
+// their number and their resident size using mincore.
+static int scan_fiber_stacks(size_t stack_size, size_t page_size, size_t *count, size_t *resident) {
+  FILE *maps = fopen("/proc/self/maps", "r");
+  char line[512];
+  unsigned char *vec;
+  unsigned long guard_end = 0;
+
+  if (!maps) return -1;
+
+  vec = malloc(stack_size / page_size);
+  while (fgets(line, sizeof(line), maps)) {
+    unsigned long start, end, inode;
+    char perms[5];
+    int path_offset = 0;
+
+    if (sscanf(line, "%lx-%lx %4s %*s %*s %lu %n", &start, &end, perms, &inode, &path_offset) < 4) continue;
+    if (inode || (path_offset && line[path_offset] != '\0' && line[path_offset] != '\n')) {
+      guard_end = 0;
+      continue;
+    }
+
+    if (!strcmp(perms, "---p") && end - start == page_size) {
+      guard_end = end;
+      continue;
+    }
+
+    if (start == guard_end && end - start == stack_size && !strcmp(perms, "rw-p")) {
+      size_t pages = stack_size / page_size;
+      (*count)++;
+      if (!mincore((void *)start, stack_size, vec)) {
+        for (size_t i = 0; i < pages; i++)
+          if (vec[i] & 1) (*resident) += page_size;
+      }
+    }
+    guard_end = 0;
+  }
+
+  free(vec);
+  fclose(maps);
+  return 0;
+}
+
+#endif
+
+/* Returns statistics on the memory used for fiber stacks. Fiber stacks are
+ * allocated by Ruby's fiber pool, with a stack size that is set at startup
+ * using the `RUBY_FIBER_MACHINE_STACK_SIZE` and `RUBY_FIBER_VM_STACK_SIZE`
+ * environment variables, and cannot be set per fiber. Stacks of terminated
+ * fibers are kept in the pool for reuse, and their memory is released to the
+ * kernel. Idle fibers mostly hold the stack pages they have touched, so the
+ * resident size, rather than the reserved size, reflects the actual memory
+ * cost of fibers.
+ *
+ * The returned hash contains the following entries:
+ *
+ * - `:machine_stack_size`: configured machine stack size.
+ * - `:vm_stack_size`: configured VM stack size.
+ * - `:stack_size`: size of each fiber stack (including both machine and VM
+ *   stacks).
+ * - `:stacks`: number of fiber stacks allocated by the pool, whether in use or
+ *   not.
+ * - `:reserved`: total size of allocated fiber stacks.
+ * - `:resident`: total resident size of allocated fiber stacks.
+ *
+ * The stack count and sizes are available only on Linux, and are computed by
+ * scanning the process's memory mappings, which is relatively costly with a
+ * large number of fibers.
+ *
+ * @return [Hash] fiber stack stats
+ */
+
+VALUE Polyphony_fiber_stack_stats(VALUE self) {
+  VALUE params = rb_const_get(rb_const_get(rb_cObject, rb_intern("RubyVM")), rb_intern("DEFAULT_PARAMS"));
+  size_t machine_stack_size = default_param(params, "fiber_machine_stack_size");
+  size_t vm_stack_size = default_param(params, "fiber_vm_stack_size");
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t stack_size = ((machine_stack_size + vm_stack_size) / page_size + 1) * page_size;
+  VALUE stats = rb_hash_new();
+
+  rb_hash_aset(stats, SYM_machine_stack_size, SIZET2NUM(machine_stack_size));
+  rb_hash_aset(stats, SYM_vm_stack_size, SIZET2NUM(vm_stack_size));
+  rb_hash_aset(stats, SYM_stack_size, SIZET2NUM(stack_size));
+
+#ifdef POLYPHONY_LINUX
+  {
+    size_t count = 0;
+    size_t resident = 0;
+
+    if (!scan_fiber_stacks(stack_size, page_size, &count, &resident)) {
+      rb_hash_aset(stats, SYM_stacks, SIZET2NUM(count));
+      rb_hash_aset(stats, SYM_reserved, SIZET2NUM(count * stack_size));
+      rb_hash_aset(stats, SYM_resident, SIZET2NUM(resident));
+    }
+  }
+#endif
+
+  RB_GC_GUARD(params);
+  return stats;
+}
+
+void Init_FiberStackStats(void) {
+  rb_define_singleton_method(mPolyphony, "fiber_stack_stats", Polyphony_fiber_stack_stats, 0);
+
+  SYM_machine_stack_size = ID2SYM(rb_intern("machine_stack_size"));
+  SYM_vm_stack_size = ID2SYM(rb_intern("vm_stack_size"));
+  SYM_stack_size = ID2SYM(rb_intern("stack_size"));
+  SYM_stacks = ID2SYM(rb_intern("stacks"));
+  SYM_reserved = ID2SYM(rb_intern("reserved"));
+  SYM_resident = ID2SYM(rb_intern("resident"));
+  rb_global_variable(&SYM_machine_stack_size);
+  rb_global_variable(&SYM_vm_stack_size);
+  rb_global_variable(&SYM_stack_size);
+  rb_global_variable(&SYM_stacks);
+  rb_global_variable(&SYM_reserved);
+  rb_global_variable(&SYM_resident);
+}
@@ -0,0 +1,272 @@
+#include <string.h>
+#include "polyphony.h"
+#include "histogram.h"
+
+inline void histogram_init(histogram_t *histogram) {
+  memset(histogram, 0, sizeof(histogram_t));
+}
+
+static inline unsigned int histogram_bucket_index(uint64_t value) {
+  unsigned int exp;
+
+  if (value < HISTOGRAM_SUB_COUNT) return value;
+
+  exp = 63 - __builtin_clzll(value);
+  if (exp > HISTOGRAM_MAX_EXP) return HISTOGRAM_BUCKETS - 1;
+
+  return (exp - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT +
+    ((value >> (exp - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_COUNT - 1));
+}
+
+// Returns the highest value counted in the given bucket.
+static inline uint64_t histogram_bucket_upper_bound(unsigned int idx) {
+  unsigned int group = idx / HISTOGRAM_SUB_COUNT;
+  unsigned int sub = idx % HISTOGRAM_SUB_COUNT;
+
+  if (!group) return sub;
+  return (((uint64_t)(HISTOGRAM_SUB_COUNT + sub + 1)) << (group - 1)) - 1;
+}
+
+inline void histogram_record(histogram_t *histogram, uint64_t value) {
+  histogram->count++;
+  histogram->sum += value;
+  if (value > histogram->max) histogram->max = value;
+  histogram->buckets[histogram_bucket_index(value)]++;
+}
+
+void histogram_merge(histogram_t *dest, histogram_t *src) {
+  dest->count += src->count;
+  dest->sum += src->sum;
+  if (src->max > dest->max) dest->max = src->max;
+  for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    dest->buckets[i] += src->buckets[i];
+}
+
+// Returns the value at the given percentile (0..100). The returned value is
+// the upper bound of the bucket containing the percentile, capped at the
+// maximum recorded value.
+uint64_t histogram_percentile(histogram_t *histogram, double percentile) {
+  uint64_t rank;
+  uint64_t seen = 0;
+
+  if (!histogram->count) return 0;
+
+  rank = (uint64_t)(histogram->count * percentile / 100 + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > histogram->count) rank = histogram->count;
+
+  for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= rank) {
+      uint64_t value = histogram_bucket_upper_bound(i);
+      return value < histogram->max ? value : histogram->max;
+    }
+  }
+  return histogram->max;
+}
+
+VALUE SYM_count;
+VALUE SYM_sum;
+VALUE SYM_max;
+VALUE SYM_p50;
+VALUE SYM_p90;
+VALUE SYM_p99;
+VALUE SYM_p999;
+
+// Returns a summary of the histogram as a hash with count, sum, max and
+// percentile values.
+VALUE histogram_to_hash(histogram_t *histogram) {
+  VALUE hash = rb_hash_new();
+
+  rb_hash_aset(hash, SYM_count, ULL2NUM(histogram->count));
+  rb_hash_aset(hash, SYM_sum,   ULL2NUM(histogram->sum));
+  rb_hash_aset(hash, SYM_max,   ULL2NUM(histogram->max));
+  rb_hash_aset(hash, SYM_p50,   ULL2NUM(histogram_percentile(histogram, 50)));
+  rb_hash_aset(hash, SYM_p90,   ULL2NUM(histogram_percentile(histogram, 90)));
+  rb_hash_aset(hash, SYM_p99,   ULL2NUM(histogram_percentile(histogram, 99)));
+  rb_hash_aset(hash, SYM_p999,  ULL2NUM(histogram_percentile(histogram, 99.9)));
+  RB_GC_GUARD(hash);
+  return hash;
+}
+
+void histogram_setup_symbols(void) {
+  SYM_count = ID2SYM(rb_intern("count"));
+  SYM_sum   = ID2SYM(rb_intern("sum"));
+  SYM_max   = ID2SYM(rb_intern("max"));
+  SYM_p50   = ID2SYM(rb_intern("p50"));
+  SYM_p90   = ID2SYM(rb_intern("p90"));
+  SYM_p99   = ID2SYM(rb_intern("p99"));
+  SYM_p999  = ID2SYM(rb_intern("p999"));
+
+  rb_global_variable(&SYM_count);
+  rb_global_variable(&SYM_sum);
+  rb_global_variable(&SYM_max);
+  rb_global_variable(&SYM_p50);
+  rb_global_variable(&SYM_p90);
+  rb_global_variable(&SYM_p99);
+  rb_global_variable(&SYM_p999);
+}
+
+/*
+ * Document-class: Polyphony::Histogram
+ *
+ * A log-linear (HDR-style) histogram for recording latencies or other
+ * unsigned integer values, normally durations in nanoseconds. Recorded values
+ * are counted in buckets with a relative error of at most 12.5%, allowing
+ * percentiles to be computed using a fixed amount of memory.
+ */
+
+VALUE cHistogram = Qnil;
+
+static void Histogram_free(void *ptr) {
+  xfree(ptr);
+}
+
+static size_t Histogram_size(const void *ptr) {
+  return sizeof(histogram_t);
+}
+
+static const rb_data_type_t Histogram_type = {
+  "Histogram",
+  {0, Histogram_free, Histogram_size,},
+  0, 0, 0
+};
+
+static VALUE Histogram_allocate(VALUE klass) {
+  histogram_t *histogram;
+
+  histogram = ALLOC(histogram_t);
+  histogram_init(histogram);
+  return TypedData_Wrap_Struct(klass, &Histogram_type, histogram);
+}
+
+#define GetHistogram(obj, histogram) \
+  TypedData_Get_Struct((obj), histogram_t, &Histogram_type, (histogram))
+
+static inline uint64_t histogram_value(VALUE value) {
+  long long v = NUM2LL(value);
+  if (v < 0) rb_raise(rb_eArgError, "Invalid negative value");
+  return v;
+}
+
+/* Records the given value.
+ *
+ * @param value [Integer] value to record
+ * @return [Polyphony::Histogram] self
+ */
+
+VALUE Histogram_record(VALUE self, VALUE value) {
+  histogram_t *histogram;
+  GetHistogram(self, histogram);
+
+  histogram_record(histogram, histogram_value(value));
+  return self;
+}
+
+/* Adds all values recorded in the given histogram to the receiver.
+ *
+ * @param other [Polyphony::Histogram] histogram to merge
+ * @return [Polyphony::Histogram] self
+ */
+
+VALUE Histogram_merge(VALUE self, VALUE other) {
+  histogram_t *histogram;
+  histogram_t *other_histogram;
+  GetHistogram(self, histogram);
+  GetHistogram(other, other_histogram);
+
+  histogram_merge(histogram, other_histogram);
+  return self;
+}
+
+/* Clears all recorded values.
+ *
+ * @return [Polyphony::Histogram] self
+ */
+
+VALUE Histogram_reset(VALUE self) {
+  histogram_t *histogram;
+  GetHistogram(self, histogram);
+
+  histogram_init(histogram);
+  return self;
+}
+
+/* Returns the number of recorded values.
+ *
+ * @return [Integer] value count
+ */
+
+VALUE Histogram_count(VALUE self) {
+  histogram_t *histogram;
+  GetHistogram(self, histogram);
+
+  return ULL2NUM(histogram->count);
+}
+
+/* Returns the maximum recorded value.
+ *
+ * @return [Integer] maximum value
+ */
+
+VALUE Histogram_max(VALUE self) {
+  histogram_t *histogram;
+  GetHistogram(self, histogram);
+
+  return ULL2NUM(histogram->max);
+}
+
+/* Returns the mean of all recorded values.
+ *
+ * @return [Float] mean value
+ */
+
+VALUE Histogram_mean(VALUE self) {
+  histogram_t *histogram;
+  GetHistogram(self, histogram);
+
+  return DBL2NUM(histogram->count ? (double)histogram->sum / histogram->count : 0);
+}
+
+/* Returns the value at the given percentile (0..100).
+ *
+ * @param percentile [Number] percentile
+ * @return [Integer] value at percentile
+ */
+
+VALUE Histogram_percentile(VALUE self, VALUE percentile) {
+  histogram_t *histogram;
+  double pct = NUM2DBL(percentile);
+  GetHistogram(self, histogram);
+
+  if (pct < 0 || pct > 100) rb_raise(rb_eArgError, "Invalid percentile");
+  return ULL2NUM(histogram_percentile(histogram, pct));
+}
+
+/* Returns a summary of recorded values as a hash with count, sum, max, p50,
+ * p90, p99 and p999 entries.
+ *
+ * @return [Hash] histogram summary
+ */
+
+VALUE Histogram_to_h(VALUE self) {
+  histogram_t *histogram;
+  GetHistogram(self, histogram);
+
+  return histogram_to_hash(histogram);
+}
+
+void Init_Histogram(void) {
+  cHistogram = rb_define_class_under(mPolyphony, "Histogram", rb_cObject);
+  rb_define_alloc_func(cHistogram, Histogram_allocate);
+
+  rb_define_method(cHistogram, "record", Histogram_record, 1);
+  rb_define_method(cHistogram, "<<", Histogram_record, 1);
+  rb_define_method(cHistogram, "merge", Histogram_merge, 1);
+  rb_define_method(cHistogram, "reset", Histogram_reset, 0);
+  rb_define_method(cHistogram, "count", Histogram_count, 0);
+  rb_define_method(cHistogram, "max", Histogram_max, 0);
+  rb_define_method(cHistogram, "mean", Histogram_mean, 0);
+  rb_define_method(cHistogram, "percentile", Histogram_percentile, 1);
+  rb_define_method(cHistogram, "to_h", Histogram_to_h, 0);
+}
@@ -0,0 +1,33 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include "ruby.h"
+
+// A log-linear (HDR-style) histogram of unsigned 64-bit values. Each power of
+// two range is split into 2^HISTOGRAM_SUB_BITS equally sized buckets, giving a
+// relative error of at most 1/2^HISTOGRAM_SUB_BITS. Values are normally
+// durations in nanoseconds. Values above 2^(HISTOGRAM_MAX_EXP + 1) are counted
+// in the last bucket.
+#define HISTOGRAM_SUB_BITS  3
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_EXP   40
+#define HISTOGRAM_BUCKETS   ((HISTOGRAM_MAX_EXP - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_COUNT)
+
+typedef struct histogram {
+  uint64_t count;
+  uint64_t sum;
+  uint64_t max;
+  uint64_t buckets[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+extern VALUE SYM_count;
+
+void histogram_init(histogram_t *histogram);
+void histogram_record(histogram_t *histogram, uint64_t value);
+void histogram_merge(histogram_t *dest, histogram_t *src);
+uint64_t histogram_percentile(histogram_t *histogram, double percentile);
+VALUE histogram_to_hash(histogram_t *histogram);
+void histogram_setup_symbols();
+
+#endif /* HISTOGRAM_H */
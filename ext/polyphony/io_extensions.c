@@ -302,8 +302,15 @@ struct z_stream_ctx {
   int f_gzip_footer; // should a gzip footer be generated
   z_stream strm;
 
-  unsigned char in[CHUNK];
-  unsigned char out[CHUNK];
+  // gzip header to be written (deflate) or read (inflate)
+  struct gzip_header_ctx *gzip_header;
+
+  // I/O buffers are acquired from the backend, so they can be registered
+  // buffers
+  struct buffer_spec in_buffer;
+  struct buffer_spec out_buffer;
+  unsigned char *in;
+  unsigned char *out;
   unsigned int in_pos;
   unsigned int out_pos;
   unsigned long in_total;
@@ -334,11 +341,11 @@ void gzip_read_header(struct z_stream_ctx *ctx, struct gzip_header_ctx *header_c
   if (ctx->src_read_method == RM_STRING) {
     in_buffer_spec.ptr = (unsigned char *)RSTRING_PTR(ctx->src);
     in_buffer_spec.len = RSTRING_LEN(ctx->src);
+    in_buffer_spec.fixed = 0;
     ctx->in_total = in_buffer_spec.len;
   }
   else {
-    in_buffer_spec.ptr = ctx->in;
-    in_buffer_spec.len = CHUNK;
+    in_buffer_spec = ctx->in_buffer;
     while (ctx->in_total < 10) {
       int read = read_to_raw_buffer(ctx->backend, ctx->src, ctx->src_read_method, &in_buffer_spec);
       if (read == 0) goto error;
@@ -402,6 +409,7 @@ static inline int z_stream_write_out(struct z_stream_ctx *ctx, zlib_func fun, in
   written = avail_out_pre - ctx->strm.avail_out;
   out_buffer_spec.ptr = ctx->out;
   out_buffer_spec.len = ctx->out_pos + written;
+  out_buffer_spec.fixed = ctx->out_buffer.fixed;
 
   if (eof && ctx->f_gzip_footer && (CHUNK - out_buffer_spec.len >= GZIP_FOOTER_LEN)) {
     gzip_prepare_footer(ctx->crc32, ctx->in_total, out_buffer_spec.ptr + out_buffer_spec.len, 8);
@@ -421,6 +429,18 @@ static inline int z_stream_write_out(struct z_stream_ctx *ctx, zlib_func fun, in
 VALUE z_stream_io_loop(struct z_stream_ctx *ctx) {
   zlib_func fun = (ctx->mode == SM_DEFLATE) ? deflate : inflate;
 
+  Backend_acquire_fixed_buffer(ctx->backend, CHUNK, &ctx->in_buffer);
+  ctx->in = ctx->in_buffer.ptr;
+  Backend_acquire_fixed_buffer(ctx->backend, CHUNK, &ctx->out_buffer);
+  ctx->out = ctx->out_buffer.ptr;
+
+  if (ctx->gzip_header) {
+    if (ctx->mode == SM_DEFLATE)
+      ctx->out_total = ctx->out_pos = gzip_prepare_header(ctx->gzip_header, ctx->out, CHUNK);
+    else
+      gzip_read_header(ctx, ctx->gzip_header);
+  }
+
   if ((ctx->src_read_method != RM_STRING) && (ctx->in_total > ctx->in_pos)) {
     // In bytes already read for parsing gzip header, so we need to process the
     // rest.
@@ -449,7 +469,7 @@ VALUE z_stream_io_loop(struct z_stream_ctx *ctx) {
       if (ctx->mode == SM_DEFLATE) ctx->crc32 = crc32(ctx->crc32, in_buffer_spec.ptr, read_len);
     }
     else {
-      struct buffer_spec in_buffer_spec = {ctx->in, CHUNK};
+      struct buffer_spec in_buffer_spec = ctx->in_buffer;
       ctx->strm.next_in = ctx->in;
       read_len = ctx->strm.avail_in = read_to_raw_buffer(ctx->backend, ctx->src, ctx->src_read_method, &in_buffer_spec);
       if (!read_len) break;
@@ -494,6 +514,9 @@ static inline void setup_ctx(struct z_stream_ctx *ctx, enum stream_mode mode, VA
   ctx->in_total = 0;
   ctx->out_total = 0;
   ctx->crc32 = 0;
+  ctx->gzip_header = NULL;
+  ctx->in_buffer.ptr = ctx->out_buffer.ptr = NULL;
+  ctx->in = ctx->out = NULL;
 }
 
 static inline VALUE z_stream_cleanup(struct z_stream_ctx *ctx) {
@@ -501,6 +524,8 @@ static inline VALUE z_stream_cleanup(struct z_stream_ctx *ctx) {
     deflateEnd(&ctx->strm);
   else
     inflateEnd(&ctx->strm);
+  if (ctx->in_buffer.ptr) Backend_release_fixed_buffer(ctx->backend, &ctx->in_buffer);
+  if (ctx->out_buffer.ptr) Backend_release_fixed_buffer(ctx->backend, &ctx->out_buffer);
   return Qnil;
 }
 
@@ -541,7 +566,7 @@ VALUE IO_gzip(int argc, VALUE *argv, VALUE self) {
 
   setup_ctx(&ctx, SM_DEFLATE, src, dest);
   ctx.f_gzip_footer = 1; // write gzip footer
-  ctx.out_total = ctx.out_pos = gzip_prepare_header(&header_ctx, ctx.out, sizeof(ctx.out));
+  ctx.gzip_header = &header_ctx;
 
   ret = deflateInit2(&ctx.strm, DEFAULT_LEVEL, Z_DEFLATED, -MAX_WBITS, DEFAULT_MEM_LEVEL, Z_DEFAULT_STRATEGY);
   if (ret != Z_OK)
@@ -579,7 +604,7 @@ VALUE IO_gunzip(int argc, VALUE *argv, VALUE self) {
   int ret;
 
   setup_ctx(&ctx, SM_INFLATE, src, dest);
-  gzip_read_header(&ctx, &header_ctx);
+  ctx.gzip_header = &header_ctx;
 
   ret = inflateInit2(&ctx.strm, -MAX_WBITS);
   if (ret != Z_OK)
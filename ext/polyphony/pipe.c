@@ -1,9 +1,15 @@
+#ifdef POLYPHONY_LINUX
+#define _GNU_SOURCE 1
+#endif
+
 #include <unistd.h>
+#include <fcntl.h>
 #include "polyphony.h"
 
 typedef struct pipe {
   int fds[2];
   unsigned int w_closed;
+  unsigned int r_closed;
 } Pipe_t;
 
 VALUE cPipe = Qnil;
@@ -11,7 +17,7 @@ VALUE cClosedPipeError = Qnil;
 
 static void Pipe_free(void *ptr) {
   Pipe_t *pipe = ptr;
-  close(pipe->fds[0]);
+  if (!pipe->r_closed) close(pipe->fds[0]);
   if (!pipe->w_closed) close(pipe->fds[1]);
   xfree(ptr);
 }
@@ -36,6 +42,21 @@ static VALUE Pipe_allocate(VALUE klass) {
 #define GetPipe(obj, pipe) \
   TypedData_Get_Struct((obj), Pipe_t, &Pipe_type, (pipe))
 
+// Creates a pipe with both fds set to close-on-exec, as Ruby does for all fds
+// it opens, so that pipe fds are not inherited by spawned processes.
+static inline int pipe_cloexec(int fds[2]) {
+#ifdef POLYPHONY_LINUX
+  return pipe2(fds, O_CLOEXEC);
+#else
+  int ret = pipe(fds);
+  if (ret) return ret;
+
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  return 0;
+#endif
+}
+
 /* Creates a new pipe.
  */
 
@@ -43,12 +64,13 @@ static VALUE Pipe_initialize(VALUE self) {
   Pipe_t *pipe_struct;
   GetPipe(self, pipe_struct);
 
-  int ret = pipe(pipe_struct->fds);
+  int ret = pipe_cloexec(pipe_struct->fds);
   if (ret) {
     int e = errno;
     rb_syserr_fail(e, strerror(e));
   }
   pipe_struct->w_closed = 0;
+  pipe_struct->r_closed = 0;
 
   return self;
 }
@@ -61,8 +83,8 @@ void Pipe_verify_blocking_mode(VALUE self, VALUE blocking) {
   rb_ivar_set(self, ID_ivar_blocking_mode, blocking);
   GetPipe(self, pipe_struct);
 
-  set_fd_blocking_mode(pipe_struct->fds[0], blocking == Qtrue);
-  set_fd_blocking_mode(pipe_struct->fds[1], blocking == Qtrue);
+  if (!pipe_struct->r_closed) set_fd_blocking_mode(pipe_struct->fds[0], blocking == Qtrue);
+  if (!pipe_struct->w_closed) set_fd_blocking_mode(pipe_struct->fds[1], blocking == Qtrue);
 }
 
 int Pipe_get_fd(VALUE self, int write_mode) {
@@ -71,6 +93,8 @@ int Pipe_get_fd(VALUE self, int write_mode) {
 
   if (write_mode && pipe->w_closed)
     rb_raise(cClosedPipeError, "Pipe is closed for writing");
+  if (!write_mode && pipe->r_closed)
+    rb_raise(cClosedPipeError, "Pipe is closed for reading");
 
   return pipe->fds[write_mode ? 1 : 0];
 }
@@ -102,6 +126,23 @@ VALUE Pipe_close(VALUE self) {
   return self;
 }
 
+/* Closes the read end of the pipe. Once both ends of the pipe are closed, no
+ * fds are held by the pipe. Calling this method on a pipe that is already
+ * closed for reading has no effect.
+ *
+ * @return [Pipe] self
+ */
+
+VALUE Pipe_close_read(VALUE self) {
+  Pipe_t *pipe;
+  GetPipe(self, pipe);
+  if (pipe->r_closed) return self;
+
+  pipe->r_closed = 1;
+  close(pipe->fds[0]);
+  return self;
+}
+
 /* Returns an array containing the read and write fds for the pipe,
  * respectively.
  *
@@ -131,5 +172,6 @@ void Init_Pipe(void) {
   rb_define_method(cPipe, "initialize", Pipe_initialize, 0);
   rb_define_method(cPipe, "closed?", Pipe_closed_p, 0);
   rb_define_method(cPipe, "close", Pipe_close, 0);
+  rb_define_method(cPipe, "close_read", Pipe_close_read, 0);
   rb_define_method(cPipe, "fds", Pipe_fds, 0);
 }
@@ -15,6 +15,7 @@ ID ID_ivar_multishot_accept_queue;
 ID ID_ivar_parked;
 ID ID_ivar_runnable;
 ID ID_ivar_running;
+ID ID_ivar_tag;
 ID ID_ivar_thread;
 ID ID_new;
 ID ID_raise;
@@ -137,17 +138,35 @@ VALUE Polyphony_backend_read(VALUE self, VALUE io, VALUE buffer, VALUE length, V
   return Backend_read(BACKEND(), io, buffer, length, to_eof, pos);
 }
 
-/* Performs an infinite loop reading data from the given io. The loop terminates
- * when EOF is encountered.
+/* Reads from the given io into multiple buffers using a single vectored read.
+ * String buffers are filled starting at their current length up to their
+ * capacity (see `String.new(capacity:)`), or up to `maxlen` bytes if given,
+ * IO::Buffer instances are filled from their start.
  *
  * @param io [IO] io to read from
- * @param maxlen [Integer] maximum bytes to read
+ * @param buffers [Array<String, IO::Buffer>] buffers to read into
+ * @param maxlen [Integer, nil] maximum length of String buffers
  *
- * @return [IO] io
+ * @return [Integer, nil] total bytes read, or nil on EOF
+ */
+
+VALUE Polyphony_backend_readv(VALUE self, VALUE io, VALUE buffers, VALUE maxlen) {
+  return Backend_readv(BACKEND(), io, buffers, maxlen);
+}
+
+/* Performs an infinite loop reading data from the given io. The loop terminates
+ * when EOF is encountered.
+ *
+ * @overload backend_read_loop(io, maxlen, reuse_buffer = false)
+ *   @param io [IO] io to read from
+ *   @param maxlen [Integer, IO::Buffer] maximum bytes to read, or buffer to
+ *     read into, in which case a slice of the buffer is yielded for each chunk
+ *   @param reuse_buffer [bool] whether to read each chunk into the same string
+ *   @return [IO] io
  */
 
-VALUE Polyphony_backend_read_loop(VALUE self, VALUE io, VALUE maxlen) {
-  return Backend_read_loop(BACKEND(), io, maxlen);
+VALUE Polyphony_backend_read_loop(int argc, VALUE *argv, VALUE self) {
+  return Backend_read_loop_m(argc, argv, BACKEND());
 }
 
 /* Receives data on the given io.
@@ -180,17 +199,37 @@ VALUE Polyphony_backend_recvmsg(VALUE self, VALUE socket, VALUE buffer, VALUE ma
   return Backend_recvmsg(BACKEND(), socket, buffer, maxlen, pos, flags, maxcontrollen, opts);
 }
 
+#ifdef POLYPHONY_LINUX
+/* Receives a batch of up to `count` datagrams on the given socket, waiting for
+ * at least one datagram to become available.
+ *
+ * @param socket [UDPSocket] socket to receive on
+ * @param count [Integer] maximum number of datagrams to receive
+ * @param maxlen [Integer] maximum bytes to read per datagram
+ * @param flags [Integer] Flags
+ * @return [Array<Array>] array of [data, addr] pairs
+ */
+
+VALUE Polyphony_backend_recv_batch(VALUE self, VALUE socket, VALUE count, VALUE maxlen, VALUE flags) {
+  return Backend_recv_batch(BACKEND(), socket, count, maxlen, flags);
+}
+#endif
+
 /* Performs an infinite loop receiving data on the given socket. The loop
  * terminates when the socket is closed.
  *
- * @param socket [Socket] socket to receive on
- * @param maxlen [Integer] maximum bytes to read
- * @yield [data] received data
- * @return [Socket] socket
+ * @overload backend_recv_loop(socket, maxlen, reuse_buffer = false)
+ *   @param socket [Socket] socket to receive on
+ *   @param maxlen [Integer, IO::Buffer] maximum bytes to read, or buffer to
+ *     read into, in which case a slice of the buffer is yielded for each chunk
+ *   @param reuse_buffer [bool] whether to receive each chunk into the same
+ *     string
+ *   @yield [data] received data
+ *   @return [Socket] socket
  */
 
-VALUE Polyphony_backend_recv_loop(VALUE self, VALUE socket, VALUE maxlen) {
-  return Backend_recv_loop(BACKEND(), socket, maxlen);
+VALUE Polyphony_backend_recv_loop(int argc, VALUE *argv, VALUE self) {
+  return Backend_recv_loop_m(argc, argv, BACKEND());
 }
 
 /* Runs a feed loop, receiving data on the given socket, feeding it to the
@@ -236,6 +275,21 @@ VALUE Polyphony_backend_sendmsg(VALUE self, VALUE socket, VALUE msg, VALUE flags
   return Backend_sendmsg(BACKEND(), socket, msg, flags, dest_sockaddr, controls);
 }
 
+#ifdef POLYPHONY_LINUX
+/* Sends a batch of datagrams on the given socket. Each datagram is either a
+ * string (for connected sockets), or a [string, dest_sockaddr] pair.
+ *
+ * @param socket [UDPSocket] socket to send on
+ * @param datagrams [Array] datagrams to send
+ * @param flags [Integer] Flags
+ * @return [Integer] number of datagrams sent
+ */
+
+VALUE Polyphony_backend_send_batch(VALUE self, VALUE socket, VALUE datagrams, VALUE flags) {
+  return Backend_send_batch(BACKEND(), socket, datagrams, flags);
+}
+#endif
+
 /* Sends multiple strings on the given socket, returning the number of bytes
  * sent.
  *
@@ -249,6 +303,23 @@ VALUE Polyphony_backend_sendv(VALUE self, VALUE socket, VALUE ary, VALUE flags)
   return Backend_sendv(BACKEND(), socket, ary, flags);
 }
 
+/* Sends data from the given file to the given destination, starting at the
+ * given offset. If a length is given, up to `length` bytes are sent, otherwise
+ * data is sent until EOF is encountered. The file position of the source file
+ * is not changed. On Linux, the data is transferred without being copied to
+ * userspace.
+ *
+ * @param src [IO] source file
+ * @param dest [IO] destination io
+ * @param offset [Integer] offset in source file
+ * @param length [Integer, nil] number of bytes to send
+ * @return [Integer] number of bytes sent
+ */
+
+VALUE Polyphony_backend_send_file(VALUE self, VALUE src, VALUE dest, VALUE offset, VALUE length) {
+  return Backend_send_file(BACKEND(), src, dest, offset, length);
+}
+
 /* Sleeps for the given duration, yielding execution to other fibers.
  *
  * @param duration [Number] duration in seconds
@@ -347,6 +418,18 @@ VALUE Polyphony_backend_waitpid(VALUE self, VALUE pid) {
   return Backend_waitpid(BACKEND(), pid);
 }
 
+/* Waits for one or more of the given processes to terminate. A single wait is
+ * registered for each process, and all terminated processes are reaped at
+ * once, returning their pids and exit codes.
+ *
+ * @param pids [Array<Integer>] pids
+ * @return [Array<Array<Integer>>] array of [pid, exit code] pairs
+ */
+
+VALUE Polyphony_backend_waitpid_any(VALUE self, VALUE pids) {
+  return Backend_waitpid_any(BACKEND(), pids);
+}
+
 /* Writes one or more strings to the given io, returning the total number of
  * bytes written.
  */
@@ -355,11 +438,58 @@ VALUE Polyphony_backend_write(int argc, VALUE *argv, VALUE self) {
   return Backend_write_m(argc, argv, BACKEND());
 }
 
+/* Allocates a raw buffer of the given size and passes it to the given block.
+ * On the io_uring backend, the buffer is taken from a pool of buffers
+ * registered with the kernel, so that reads and writes on it are performed
+ * using fixed buffer ops, avoiding the cost of mapping the buffer's pages on
+ * each op. If no registered buffer is available, or the requested size is too
+ * big, a regular buffer is allocated instead. The buffer is released when the
+ * block returns.
+ *
+ * The raw buffer can be passed as the buffer argument to `backend_read` and
+ * `backend_write`.
+ *
+ * @param size [Integer] buffer size
+ * @yield [Integer] raw buffer
+ * @return [any] block's return value
+ */
+
+VALUE Polyphony_with_fixed_buffer(VALUE self, VALUE size) {
+  return Backend_with_fixed_buffer(BACKEND(), size);
+}
+
+/* Enables or disables poisoning of reused read buffers. When enabled, read
+ * loops that reuse their buffer (see `IO#read_loop`) overwrite each chunk with
+ * poison bytes and freeze it once the block returns, and read the next chunk
+ * into a new string. Consumers that retain chunks will then see corrupted data
+ * or fail when modifying them. This is meant to be used when testing, as it
+ * defeats the purpose of reusing the buffer.
+ *
+ * @param value [bool] whether to poison reused buffers
+ * @return [bool] value
+ */
+
+VALUE Polyphony_poison_reused_buffers_set(VALUE self, VALUE value) {
+  backend_poison_reused_buffers = RTEST(value);
+  return value;
+}
+
+/* Returns true if reused read buffers are poisoned (see
+ * `Polyphony.poison_reused_buffers=`).
+ *
+ * @return [bool]
+ */
+
+VALUE Polyphony_poison_reused_buffers_p(VALUE self) {
+  return backend_poison_reused_buffers ? Qtrue : Qfalse;
+}
+
 /* @!visibility private */
 
 VALUE Polyphony_with_raw_buffer(VALUE self, VALUE size) {
   struct buffer_spec buffer_spec;
   buffer_spec.len = FIX2INT(size);
+  buffer_spec.fixed = 0;
   buffer_spec.ptr = malloc(buffer_spec.len);
   if (!buffer_spec.ptr)
     rb_raise(rb_eRuntimeError, "Failed to allocate buffer");
@@ -403,9 +533,25 @@ VALUE Polyphony_raw_buffer_size(VALUE self, VALUE buffer) {
   return INT2FIX(buffer_spec->len);
 }
 
-// VALUE Polyphony_backend_close(VALUE self, VALUE io) {
-//   return Backend_close(BACKEND(), io);
-// }
+/* @!visibility private */
+
+VALUE Polyphony_raw_buffer_fixed(VALUE self, VALUE buffer) {
+  struct buffer_spec *buffer_spec = FIX2PTR(buffer);
+  return buffer_spec->fixed ? Qtrue : Qfalse;
+}
+
+/* Closes the given io. On the io_uring backend, the fd is closed
+ * asynchronously, and any pending ops on the fd are cancelled, their fibers
+ * raising `Errno::EBADF`. On the libev backend, the io is closed
+ * synchronously.
+ *
+ * @param io [IO] io to close
+ * @return [nil]
+ */
+
+VALUE Polyphony_backend_close(VALUE self, VALUE io) {
+  return Backend_close(BACKEND(), io);
+}
 
 void Init_Polyphony(void) {
   mPolyphony = rb_define_module("Polyphony");
@@ -422,14 +568,22 @@ void Init_Polyphony(void) {
 
 
   rb_define_singleton_method(mPolyphony, "backend_read", Polyphony_backend_read, 5);
-  rb_define_singleton_method(mPolyphony, "backend_read_loop", Polyphony_backend_read_loop, 2);
+  rb_define_singleton_method(mPolyphony, "backend_readv", Polyphony_backend_readv, 3);
+  rb_define_singleton_method(mPolyphony, "backend_read_loop", Polyphony_backend_read_loop, -1);
   rb_define_singleton_method(mPolyphony, "backend_recv", Polyphony_backend_recv, 4);
   rb_define_singleton_method(mPolyphony, "backend_recvmsg", Polyphony_backend_recvmsg, 7);
-  rb_define_singleton_method(mPolyphony, "backend_recv_loop", Polyphony_backend_recv_loop, 2);
+  rb_define_singleton_method(mPolyphony, "backend_recv_loop", Polyphony_backend_recv_loop, -1);
   rb_define_singleton_method(mPolyphony, "backend_recv_feed_loop", Polyphony_backend_recv_feed_loop, 3);
   rb_define_singleton_method(mPolyphony, "backend_send", Polyphony_backend_send, 3);
   rb_define_singleton_method(mPolyphony, "backend_sendmsg", Polyphony_backend_sendmsg, 5);
   rb_define_singleton_method(mPolyphony, "backend_sendv", Polyphony_backend_sendv, 3);
+  rb_define_singleton_method(mPolyphony, "backend_send_file", Polyphony_backend_send_file, 4);
+
+  #ifdef POLYPHONY_LINUX
+  rb_define_singleton_method(mPolyphony, "backend_recv_batch", Polyphony_backend_recv_batch, 4);
+  rb_define_singleton_method(mPolyphony, "backend_send_batch", Polyphony_backend_send_batch, 3);
+  #endif
+
   rb_define_singleton_method(mPolyphony, "backend_sleep", Polyphony_backend_sleep, 1);
   rb_define_singleton_method(mPolyphony, "backend_splice", Polyphony_backend_splice, 3);
 
@@ -446,14 +600,19 @@ void Init_Polyphony(void) {
   rb_define_singleton_method(mPolyphony, "backend_wait_event", Polyphony_backend_wait_event, 1);
   rb_define_singleton_method(mPolyphony, "backend_wait_io", Polyphony_backend_wait_io, 2);
   rb_define_singleton_method(mPolyphony, "backend_waitpid", Polyphony_backend_waitpid, 1);
+  rb_define_singleton_method(mPolyphony, "backend_waitpid_any", Polyphony_backend_waitpid_any, 1);
   rb_define_singleton_method(mPolyphony, "backend_write", Polyphony_backend_write, -1);
-  // rb_define_singleton_method(mPolyphony, "backend_close", Polyphony_backend_close, 1);
+  rb_define_singleton_method(mPolyphony, "backend_close", Polyphony_backend_close, 1);
   rb_define_singleton_method(mPolyphony, "backend_verify_blocking_mode", Backend_verify_blocking_mode, 2);
 
+  rb_define_singleton_method(mPolyphony, "with_fixed_buffer", Polyphony_with_fixed_buffer, 1);
   rb_define_singleton_method(mPolyphony, "__with_raw_buffer__", Polyphony_with_raw_buffer, 1);
   rb_define_singleton_method(mPolyphony, "__raw_buffer_get__", Polyphony_raw_buffer_get, -1);
   rb_define_singleton_method(mPolyphony, "__raw_buffer_set__", Polyphony_raw_buffer_set, 2);
   rb_define_singleton_method(mPolyphony, "__raw_buffer_size__", Polyphony_raw_buffer_size, 1);
+  rb_define_singleton_method(mPolyphony, "__raw_buffer_fixed__", Polyphony_raw_buffer_fixed, 1);
+  rb_define_singleton_method(mPolyphony, "poison_reused_buffers=", Polyphony_poison_reused_buffers_set, 1);
+  rb_define_singleton_method(mPolyphony, "poison_reused_buffers?", Polyphony_poison_reused_buffers_p, 0);
 
   rb_define_global_function("snooze", Polyphony_snooze, 0);
   rb_define_global_function("suspend", Polyphony_suspend, 0);
@@ -478,6 +637,7 @@ void Init_Polyphony(void) {
   ID_ivar_parked                  = rb_intern("@parked");
   ID_ivar_runnable                = rb_intern("@runnable");
   ID_ivar_running                 = rb_intern("@running");
+  ID_ivar_tag                     = rb_intern("@tag");
   ID_ivar_thread                  = rb_intern("@thread");
   ID_new                          = rb_intern("new");
   ID_raise                        = rb_intern("raise");
@@ -49,6 +49,7 @@ extern ID ID_ivar_multishot_accept_queue;
 extern ID ID_ivar_parked;
 extern ID ID_ivar_runnable;
 extern ID ID_ivar_running;
+extern ID ID_ivar_tag;
 extern ID ID_ivar_thread;
 extern ID ID_new;
 extern ID ID_raise;
@@ -87,6 +88,7 @@ int Runqueue_should_poll_nonblocking(VALUE self);
 void Pipe_verify_blocking_mode(VALUE self, VALUE blocking);
 int Pipe_get_fd(VALUE self, int write_mode);
 VALUE Pipe_close(VALUE self);
+VALUE Pipe_closed_p(VALUE self);
 
 #ifdef POLYPHONY_BACKEND_LIBEV
 #define Backend_recv_loop Backend_read_loop
@@ -105,14 +107,23 @@ VALUE Backend_multishot_accept(VALUE self, VALUE io);
 #endif
 
 VALUE Backend_read(VALUE self, VALUE io, VALUE str, VALUE length, VALUE to_eof, VALUE pos);
-VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen);
+VALUE Backend_readv(VALUE self, VALUE io, VALUE buffers, VALUE maxlen);
+VALUE Backend_read_loop(VALUE self, VALUE io, VALUE maxlen, VALUE reuse);
+VALUE Backend_read_loop_m(int argc, VALUE *argv, VALUE self);
 VALUE Backend_recv(VALUE self, VALUE io, VALUE str, VALUE length, VALUE pos);
 VALUE Backend_recvmsg(VALUE self, VALUE io, VALUE buffer, VALUE maxlen, VALUE pos, VALUE flags, VALUE maxcontrollen, VALUE opts);
-VALUE Backend_recv_loop(VALUE self, VALUE io, VALUE maxlen);
+VALUE Backend_recv_loop(VALUE self, VALUE io, VALUE maxlen, VALUE reuse);
+VALUE Backend_recv_loop_m(int argc, VALUE *argv, VALUE self);
 VALUE Backend_recv_feed_loop(VALUE self, VALUE io, VALUE receiver, VALUE method);
 VALUE Backend_send(VALUE self, VALUE io, VALUE msg, VALUE flags);
 VALUE Backend_sendmsg(VALUE self, VALUE io, VALUE msg, VALUE flags, VALUE dest_sockaddr, VALUE controls);
 VALUE Backend_sendv(VALUE self, VALUE io, VALUE ary, VALUE flags);
+VALUE Backend_send_file(VALUE self, VALUE src, VALUE dest, VALUE offset, VALUE length);
+
+#ifdef POLYPHONY_LINUX
+VALUE Backend_recv_batch(VALUE self, VALUE io, VALUE count, VALUE maxlen, VALUE flags);
+VALUE Backend_send_batch(VALUE self, VALUE io, VALUE datagrams, VALUE flags);
+#endif
 VALUE Backend_sleep(VALUE self, VALUE duration);
 VALUE Backend_splice(VALUE self, VALUE src, VALUE dest, VALUE maxlen);
 
@@ -129,9 +140,11 @@ VALUE Backend_timer_loop(VALUE self, VALUE interval);
 VALUE Backend_wait_event(VALUE self, VALUE raise);
 VALUE Backend_wait_io(VALUE self, VALUE io, VALUE write);
 VALUE Backend_waitpid(VALUE self, VALUE pid);
+VALUE Backend_waitpid_any(VALUE self, VALUE pids);
+VALUE Backend_with_fixed_buffer(VALUE self, VALUE size);
 VALUE Backend_write(VALUE self, VALUE io, VALUE str);
 VALUE Backend_write_m(int argc, VALUE *argv, VALUE self);
-// VALUE Backend_close(VALUE self, VALUE io);
+VALUE Backend_close(VALUE self, VALUE io);
 
 VALUE Backend_poll(VALUE self, VALUE blocking);
 VALUE Backend_wait_event(VALUE self, VALUE raise_on_exception);
@@ -7,6 +7,10 @@ void Init_Queue();
 void Init_Event();
 void Init_Fiber();
 void Init_Thread();
+void Init_Histogram();
+void Init_Spawn();
+void Init_SignalSource();
+void Init_FiberStackStats();
 
 void Init_IOExtensions();
 void Init_SocketExtensions();
@@ -24,6 +28,10 @@ void Init_polyphony_ext(void) {
   Init_Event();
   Init_Fiber();
   Init_Thread();
+  Init_Histogram();
+  Init_Spawn();
+  Init_SignalSource();
+  Init_FiberStackStats();
 
   Init_IOExtensions();
   Init_SocketExtensions();
@@ -0,0 +1,43 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT (SystemTap/DTrace style) static probes, for use with bpftrace, perf or
+// SystemTap on live processes, e.g.:
+//
+//   bpftrace -e 'usdt:./polyphony_ext.so:polyphony:fiber_switch { @[arg1] = count(); }'
+//
+// When sys/sdt.h is available, each probe compiles to a single nop plus an ELF
+// note describing the probe's location and arguments, and costs nothing unless
+// a tracer is attached. Otherwise probes compile to nothing. Probe arguments
+// are evaluated even when no tracer is attached, so they should be cheap.
+//
+// Provided probes (provider: polyphony):
+//
+//   fiber_spin(fiber)
+//   fiber_terminate(fiber)
+//   fiber_schedule(fiber, prioritize)
+//   fiber_switch(from_fiber, to_fiber)
+//   op_submit(op_id, op_type)               (io_uring)
+//   op_complete(op_id, op_type, result)     (io_uring)
+//   watcher_start(fiber, op_type)           (libev)
+//   watcher_ready(fiber, op_type, cancelled) (libev)
+//   poll_enter(blocking)
+//   poll_leave(blocking)
+//   idle_gc_start()
+//   idle_gc_done()
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define USDT_PROBE0(name)             DTRACE_PROBE(polyphony, name)
+#define USDT_PROBE1(name, a)          DTRACE_PROBE1(polyphony, name, a)
+#define USDT_PROBE2(name, a, b)       DTRACE_PROBE2(polyphony, name, a, b)
+#define USDT_PROBE3(name, a, b, c)    DTRACE_PROBE3(polyphony, name, a, b, c)
+#else
+#define USDT_PROBE0(name)             do {} while (0)
+#define USDT_PROBE1(name, a)          do {} while (0)
+#define USDT_PROBE2(name, a, b)       do {} while (0)
+#define USDT_PROBE3(name, a, b, c)    do {} while (0)
+#endif
+
+#endif /* PROBES_H */
@@ -0,0 +1,254 @@
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include "ruby/debug.h"
+#include "polyphony.h"
+#include "backend_common.h"
+
+// A dedicated real-time signal is used where available, so as not to interfere
+// with other profilers, which commonly use SIGPROF.
+#ifdef SIGRTMIN
+#define PROFILER_SIGNAL (SIGRTMIN + 4)
+#else
+#define PROFILER_SIGNAL SIGPROF
+#endif
+#define PROFILER_MIN_INTERVAL 100000 // 100us
+
+// Active profilers are kept in a linked list, which is only modified and
+// traversed while holding the GVL.
+static profiler_t *active_profilers = NULL;
+static int signal_handler_installed = 0;
+static struct sigaction saved_action;
+
+#ifdef HAVE_RB_POSTPONED_JOB_PREREGISTER
+static rb_postponed_job_handle_t profiler_job_handle;
+#endif
+
+VALUE SYM_on_cpu;
+VALUE SYM_off_cpu;
+
+inline void profiler_init(profiler_t *profiler, struct Backend_base *base) {
+  profiler->base = base;
+  profiler->running = 0;
+  profiler->pending = 0;
+  profiler->interval = 0;
+  profiler->on_cpu = Qnil;
+  profiler->off_cpu = Qnil;
+  profiler->next = NULL;
+}
+
+inline void profiler_mark(profiler_t *profiler) {
+  if (profiler->on_cpu != Qnil) rb_gc_mark(profiler->on_cpu);
+  if (profiler->off_cpu != Qnil) rb_gc_mark(profiler->off_cpu);
+}
+
+// Returns the collapsed stack of the current fiber, from the outermost frame
+// to the innermost one, separated by semicolons. If the fiber is tagged, the
+// tag is used as the root frame. If a leaf is given, it is appended as the
+// innermost frame.
+static VALUE profiler_collapsed_stack(VALUE leaf) {
+  VALUE frames[PROFILER_MAX_FRAMES];
+  int lines[PROFILER_MAX_FRAMES];
+  int count = rb_profile_frames(0, PROFILER_MAX_FRAMES, frames, lines);
+  VALUE tag = rb_ivar_get(rb_fiber_current(), ID_ivar_tag);
+  VALUE stack = rb_str_new(0, 0);
+
+  if (tag != Qnil) {
+    rb_str_cat_cstr(stack, "fiber:");
+    rb_str_append(stack, rb_obj_as_string(tag));
+  }
+  for (int i = count - 1; i >= 0; i--) {
+    VALUE label = rb_profile_frame_full_label(frames[i]);
+    if (RSTRING_LEN(stack)) rb_str_cat(stack, ";", 1);
+    if (label == Qnil)
+      rb_str_cat_cstr(stack, "(unknown)");
+    else
+      rb_str_append(stack, label);
+  }
+  if (leaf != Qnil) {
+    if (RSTRING_LEN(stack)) rb_str_cat(stack, ";", 1);
+    rb_str_append(stack, leaf);
+  }
+  RB_GC_GUARD(tag);
+  return stack;
+}
+
+static void profiler_add(VALUE hash, VALUE stack, uint64_t weight) {
+  VALUE prev = rb_hash_lookup2(hash, stack, INT2FIX(0));
+  rb_hash_aset(hash, stack, ULL2NUM(NUM2ULL(prev) + weight));
+}
+
+// Records the wait of the current fiber for the given op. The wait duration is
+// given in nanoseconds.
+void profiler_record_wait(profiler_t *profiler, const char *op, int fd, uint64_t duration) {
+  VALUE leaf;
+
+  if (fd >= 0)
+    leaf = rb_sprintf("[%s fd:%d]", op ? op : "wait", fd);
+  else
+    leaf = rb_sprintf("[%s]", op ? op : "wait");
+
+  profiler_add(profiler->off_cpu, profiler_collapsed_stack(leaf), duration / 1000);
+  RB_GC_GUARD(leaf);
+}
+
+// Runs on the sampled thread at the next safe point.
+static void profiler_job(void *data) {
+  pthread_t self = pthread_self();
+
+  for (profiler_t *profiler = active_profilers; profiler; profiler = profiler->next) {
+    if (!profiler->pending || !pthread_equal(profiler->thread, self)) continue;
+
+    profiler->pending = 0;
+    profiler_add(profiler->on_cpu, profiler_collapsed_stack(Qnil), profiler->interval / 1000);
+  }
+}
+
+static void profiler_signal_handler(int sig, siginfo_t *info, void *ucontext) {
+  int saved_errno = errno;
+  #ifdef HAVE_RB_POSTPONED_JOB_PREREGISTER
+  rb_postponed_job_trigger(profiler_job_handle);
+  #else
+  rb_postponed_job_register_one(0, profiler_job, 0);
+  #endif
+  errno = saved_errno;
+}
+
+static void profiler_install_signal_handler(void) {
+  struct sigaction sa;
+
+  if (signal_handler_installed) return;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = profiler_signal_handler;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(PROFILER_SIGNAL, &sa, &saved_action))
+    rb_syserr_fail(errno, strerror(errno));
+  signal_handler_installed = 1;
+}
+
+// Restores the signal's previous disposition once no profiler is active.
+static void profiler_restore_signal_handler(void) {
+  if (!signal_handler_installed || active_profilers) return;
+
+  sigaction(PROFILER_SIGNAL, &saved_action, NULL);
+  signal_handler_installed = 0;
+}
+
+static void *profiler_sampler(void *arg) {
+  profiler_t *profiler = arg;
+  struct Backend_base *base = profiler->base;
+  struct timespec ts;
+
+  ts.tv_sec = profiler->interval / 1000000000;
+  ts.tv_nsec = profiler->interval % 1000000000;
+
+  while (profiler->running) {
+    nanosleep(&ts, NULL);
+    if (!profiler->running) break;
+
+    // time spent polling is accounted for by the waiting fibers
+    if (profiler->pending || *(volatile unsigned int *)&base->currently_polling) continue;
+
+    profiler->pending = 1;
+    pthread_kill(profiler->thread, PROFILER_SIGNAL);
+  }
+  return NULL;
+}
+
+static void profiler_unlink(profiler_t *profiler) {
+  profiler_t **ptr = &active_profilers;
+
+  while (*ptr) {
+    if (*ptr == profiler) {
+      *ptr = profiler->next;
+      break;
+    }
+    ptr = &(*ptr)->next;
+  }
+  profiler->next = NULL;
+}
+
+// Starts profiling the current thread's backend. The sampling interval is
+// given in seconds. Any previously collected samples are discarded.
+void profiler_start(profiler_t *profiler, double interval) {
+  int ret;
+
+  if (interval <= 0) rb_raise(rb_eArgError, "Invalid sampling interval");
+  profiler_stop(profiler);
+  profiler_install_signal_handler();
+
+  profiler->on_cpu = rb_hash_new();
+  profiler->off_cpu = rb_hash_new();
+  profiler->interval = interval * 1e9;
+  if (profiler->interval < PROFILER_MIN_INTERVAL) profiler->interval = PROFILER_MIN_INTERVAL;
+  profiler->thread = pthread_self();
+  profiler->pending = 0;
+  profiler->running = 1;
+
+  ret = pthread_create(&profiler->sampler, NULL, profiler_sampler, profiler);
+  if (ret) {
+    profiler->running = 0;
+    rb_syserr_fail(ret, strerror(ret));
+  }
+
+  profiler->next = active_profilers;
+  active_profilers = profiler;
+}
+
+void profiler_stop(profiler_t *profiler) {
+  if (!profiler->running) return;
+
+  profiler->running = 0;
+  pthread_join(profiler->sampler, NULL);
+  profiler->pending = 0;
+  profiler_unlink(profiler);
+  profiler_restore_signal_handler();
+}
+
+// Resets the profiler after a fork. The sampler thread does not exist in the
+// child process, so it is not joined.
+void profiler_reset(profiler_t *profiler) {
+  if (profiler->running) {
+    profiler->running = 0;
+    profiler_unlink(profiler);
+    profiler_restore_signal_handler();
+  }
+  profiler->pending = 0;
+  profiler->on_cpu = Qnil;
+  profiler->off_cpu = Qnil;
+}
+
+// Returns the samples collected so far as a hash with :on_cpu and :off_cpu
+// entries, each mapping collapsed stacks to weights in microseconds. The
+// collected samples are then cleared.
+VALUE profiler_result(profiler_t *profiler) {
+  VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, SYM_on_cpu, profiler->on_cpu == Qnil ? rb_hash_new() : profiler->on_cpu);
+  rb_hash_aset(result, SYM_off_cpu, profiler->off_cpu == Qnil ? rb_hash_new() : profiler->off_cpu);
+  if (profiler->running) {
+    profiler->on_cpu = rb_hash_new();
+    profiler->off_cpu = rb_hash_new();
+  }
+  else {
+    profiler->on_cpu = Qnil;
+    profiler->off_cpu = Qnil;
+  }
+  RB_GC_GUARD(result);
+  return result;
+}
+
+void profiler_setup(void) {
+  #ifdef HAVE_RB_POSTPONED_JOB_PREREGISTER
+  profiler_job_handle = rb_postponed_job_preregister(0, profiler_job, NULL);
+  #endif
+
+  SYM_on_cpu  = ID2SYM(rb_intern("on_cpu"));
+  SYM_off_cpu = ID2SYM(rb_intern("off_cpu"));
+
+  rb_global_variable(&SYM_on_cpu);
+  rb_global_variable(&SYM_off_cpu);
+}
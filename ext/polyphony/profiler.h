@@ -0,0 +1,42 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "ruby.h"
+
+struct Backend_base;
+
+// The profiler samples the stack of the running fiber at a regular interval
+// (on-CPU time), and records the stack of each fiber waiting in backend_await,
+// along with the op it waited on and the wait duration (off-CPU time). Samples
+// are aggregated by collapsed stack, weighted in microseconds, for use in
+// flamegraphs.
+//
+// On-CPU sampling works like the stall detector: a native sampler thread
+// periodically signals the backend's thread (unless it is polling), and the
+// signal handler schedules a postponed job which records the current stack.
+typedef struct profiler {
+  struct Backend_base     *base;
+  pthread_t               sampler;
+  pthread_t               thread;
+  volatile int            running;
+  volatile int            pending;
+  uint64_t                interval;
+  VALUE                   on_cpu;
+  VALUE                   off_cpu;
+  struct profiler         *next;
+} profiler_t;
+
+#define PROFILER_MAX_FRAMES 256
+
+void profiler_init(profiler_t *profiler, struct Backend_base *base);
+void profiler_start(profiler_t *profiler, double interval);
+void profiler_stop(profiler_t *profiler);
+void profiler_reset(profiler_t *profiler);
+void profiler_mark(profiler_t *profiler);
+void profiler_record_wait(profiler_t *profiler, const char *op, int fd, uint64_t duration);
+VALUE profiler_result(profiler_t *profiler);
+void profiler_setup();
+
+#endif /* PROFILER_H */
@@ -22,6 +22,18 @@ typedef struct queue {
   unsigned int capacity;
 } Queue_t;
 
+// Global queue counters, used for Polyphony.stats. These are only updated while
+// holding the GVL.
+static struct {
+  uint64_t count;
+  uint64_t pushed;
+  uint64_t shifted;
+} queue_stats = {0, 0, 0};
+
+VALUE SYM_queue_count;
+VALUE SYM_queue_pushed;
+VALUE SYM_queue_shifted;
+
 VALUE cQueue = Qnil;
 VALUE cClosedQueueError = Qnil;
 VALUE cThreadError = Qnil;
@@ -39,6 +51,7 @@ static void Queue_free(void *ptr) {
   ring_buffer_free(&queue->shift_queue);
   ring_buffer_free(&queue->push_queue);
   xfree(ptr);
+  queue_stats.count--;
 }
 
 static size_t Queue_size(const void *ptr) {
@@ -55,6 +68,7 @@ static VALUE Queue_allocate(VALUE klass) {
   Queue_t *queue;
 
   queue = ALLOC(Queue_t);
+  queue_stats.count++;
   return TypedData_Wrap_Struct(klass, &Queue_type, queue);
 }
 
@@ -145,6 +159,7 @@ VALUE Queue_push(VALUE self, VALUE value) {
 
   queue_schedule_first_blocked_fiber(&queue->shift_queue);
   ring_buffer_push(&queue->values, value);
+  queue_stats.pushed++;
 
   return self;
 }
@@ -167,6 +182,7 @@ VALUE Queue_unshift(VALUE self, VALUE value) {
 
   queue_schedule_first_blocked_fiber(&queue->shift_queue);
   ring_buffer_unshift(&queue->values, value);
+  queue_stats.pushed++;
 
   return self;
 }
@@ -174,6 +190,7 @@ VALUE Queue_unshift(VALUE self, VALUE value) {
 VALUE Queue_shift_nonblock(Queue_t *queue) {
   if (queue->values.count) {
     VALUE value = ring_buffer_shift(&queue->values);
+    queue_stats.shifted++;
     if ((queue->capacity) && (queue->capacity > queue->values.count))
       queue_schedule_first_blocked_fiber(&queue->push_queue);
     RB_GC_GUARD(value);
@@ -206,6 +223,7 @@ VALUE Queue_shift_block(Queue_t *queue) {
     if (queue->closed) return Qnil;
   }
   value = ring_buffer_shift(&queue->values);
+  queue_stats.shifted++;
   if ((queue->capacity) && (queue->capacity > queue->values.count))
     queue_schedule_first_blocked_fiber(&queue->push_queue);
   RB_GC_GUARD(value);
@@ -322,6 +340,7 @@ VALUE Queue_shift_each(VALUE self) {
   Queue_t *queue;
   GetQueue(self, queue);
 
+  queue_stats.shifted += queue->values.count;
   ring_buffer_shift_each(&queue->values);
   if (queue->capacity) queue_schedule_blocked_fibers_to_capacity(queue);
   return self;
@@ -338,6 +357,7 @@ VALUE Queue_shift_all(VALUE self) {
 
   GetQueue(self, queue);
 
+  queue_stats.shifted += queue->values.count;
   result = ring_buffer_shift_all(&queue->values);
   if (queue->capacity) queue_schedule_blocked_fibers_to_capacity(queue);
   return result;
@@ -455,6 +475,23 @@ end:
   return self;
 }
 
+/* Returns global queue statistics: the number of live queues, and the total
+ * number of values pushed to and shifted from all queues. Counters are
+ * cumulative and are never reset.
+ *
+ * @return [Hash] queue statistics
+ */
+
+VALUE Queue_s_stats(VALUE klass) {
+  VALUE stats = rb_hash_new();
+
+  rb_hash_aset(stats, SYM_queue_count, ULL2NUM(queue_stats.count));
+  rb_hash_aset(stats, SYM_queue_pushed, ULL2NUM(queue_stats.pushed));
+  rb_hash_aset(stats, SYM_queue_shifted, ULL2NUM(queue_stats.shifted));
+  RB_GC_GUARD(stats);
+  return stats;
+}
+
 void Init_Queue(void) {
   cClosedQueueError = rb_const_get(rb_cObject, rb_intern("ClosedQueueError"));
   cThreadError = rb_const_get(rb_cObject, rb_intern("ThreadError"));
@@ -491,4 +528,13 @@ void Init_Queue(void) {
 
   rb_define_method(cQueue, "closed?", Queue_closed_p, 0);
   rb_define_method(cQueue, "close", Queue_close, 0);
+
+  rb_define_singleton_method(cQueue, "stats", Queue_s_stats, 0);
+
+  SYM_queue_count   = ID2SYM(rb_intern("count"));
+  SYM_queue_pushed  = ID2SYM(rb_intern("pushed"));
+  SYM_queue_shifted = ID2SYM(rb_intern("shifted"));
+  rb_global_variable(&SYM_queue_count);
+  rb_global_variable(&SYM_queue_pushed);
+  rb_global_variable(&SYM_queue_shifted);
 }
@@ -14,7 +14,7 @@ inline void runqueue_mark(runqueue_t *runqueue) {
   runqueue_ring_buffer_mark(&runqueue->entries);
 }
 
-inline void runqueue_push(runqueue_t *runqueue, VALUE fiber, VALUE value, int reschedule) {
+inline void runqueue_push(runqueue_t *runqueue, VALUE fiber, VALUE value, int reschedule, uint64_t stamp) {
   if (reschedule) {
     if (IS_EXCEPTION(value))
       runqueue_ring_buffer_delete(&runqueue->entries, fiber);
@@ -23,14 +23,14 @@ inline void runqueue_push(runqueue_t *runqueue, VALUE fiber, VALUE value, int re
       if (exception_scheduled) return;
     }
   }
-  runqueue_ring_buffer_push(&runqueue->entries, fiber, value);
+  runqueue_ring_buffer_push(&runqueue->entries, fiber, value, stamp);
   if (runqueue->entries.count > runqueue->high_watermark)
     runqueue->high_watermark = runqueue->entries.count;
 }
 
-inline void runqueue_unshift(runqueue_t *runqueue, VALUE fiber, VALUE value, int reschedule) {
+inline void runqueue_unshift(runqueue_t *runqueue, VALUE fiber, VALUE value, int reschedule, uint64_t stamp) {
   if (reschedule) runqueue_ring_buffer_delete(&runqueue->entries, fiber);
-  runqueue_ring_buffer_unshift(&runqueue->entries, fiber, value);
+  runqueue_ring_buffer_unshift(&runqueue->entries, fiber, value, stamp);
   if (runqueue->entries.count > runqueue->high_watermark)
     runqueue->high_watermark = runqueue->entries.count;
 }
@@ -64,9 +64,7 @@ inline unsigned int runqueue_len(runqueue_t *runqueue) {
 }
 
 inline unsigned int runqueue_max_len(runqueue_t *runqueue) {
-  unsigned int max_len = runqueue->high_watermark;
-  runqueue->high_watermark = 0;
-  return max_len;
+  return runqueue->high_watermark;
 }
 
 inline int runqueue_empty_p(runqueue_t *runqueue) {
@@ -13,8 +13,8 @@ void runqueue_initialize(runqueue_t *runqueue);
 void runqueue_finalize(runqueue_t *runqueue);
 void runqueue_mark(runqueue_t *runqueue);
 
-void runqueue_push(runqueue_t *runqueue, VALUE fiber, VALUE value, int reschedule);
-void runqueue_unshift(runqueue_t *runqueue, VALUE fiber, VALUE value, int reschedule);
+void runqueue_push(runqueue_t *runqueue, VALUE fiber, VALUE value, int reschedule, uint64_t stamp);
+void runqueue_unshift(runqueue_t *runqueue, VALUE fiber, VALUE value, int reschedule, uint64_t stamp);
 runqueue_entry runqueue_shift(runqueue_t *runqueue);
 void runqueue_delete(runqueue_t *runqueue, VALUE fiber);
 int runqueue_index_of(runqueue_t *runqueue, VALUE fiber);
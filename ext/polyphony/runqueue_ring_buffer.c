@@ -21,7 +21,7 @@ inline void runqueue_ring_buffer_clear(runqueue_ring_buffer *buffer) {
   buffer->count = buffer->head = buffer->tail = 0;
 }
 
-static runqueue_entry nil_runqueue_entry = {(Qnil), (Qnil)};
+static runqueue_entry nil_runqueue_entry = {(Qnil), (Qnil), 0};
 
 inline runqueue_entry runqueue_ring_buffer_shift(runqueue_ring_buffer *buffer) {
   runqueue_entry value;
@@ -43,20 +43,22 @@ inline void runqueue_ring_buffer_resize(runqueue_ring_buffer *buffer) {
   buffer->tail = buffer->head + buffer->count;
 }
 
-inline void runqueue_ring_buffer_unshift(runqueue_ring_buffer *buffer, VALUE fiber, VALUE value) {
+inline void runqueue_ring_buffer_unshift(runqueue_ring_buffer *buffer, VALUE fiber, VALUE value, uint64_t stamp) {
   if (buffer->count == buffer->size) runqueue_ring_buffer_resize(buffer);
 
   buffer->head = (buffer->head - 1) % buffer->size;
   buffer->entries[buffer->head].fiber = fiber;
   buffer->entries[buffer->head].value = value;
+  buffer->entries[buffer->head].stamp = stamp;
   buffer->count++;
 }
 
-inline void runqueue_ring_buffer_push(runqueue_ring_buffer *buffer, VALUE fiber, VALUE value) {
+inline void runqueue_ring_buffer_push(runqueue_ring_buffer *buffer, VALUE fiber, VALUE value, uint64_t stamp) {
   if (buffer->count == buffer->size) runqueue_ring_buffer_resize(buffer);
 
   buffer->entries[buffer->tail].fiber = fiber;
   buffer->entries[buffer->tail].value = value;
+  buffer->entries[buffer->tail].stamp = stamp;
   buffer->tail = (buffer->tail + 1) % buffer->size;
   buffer->count++;
 }
@@ -113,7 +115,7 @@ inline void runqueue_ring_buffer_migrate(runqueue_ring_buffer *src, runqueue_rin
   for (unsigned int i = 0; i < src->count; i++) {
     unsigned int idx = (src->head + i) % src->size;
     if (src->entries[idx].fiber == fiber) {
-      runqueue_ring_buffer_push(dest, src->entries[idx].fiber, src->entries[idx].value);
+      runqueue_ring_buffer_push(dest, src->entries[idx].fiber, src->entries[idx].value, src->entries[idx].stamp);
       runqueue_ring_buffer_delete_at(src, idx);
       return;
     }
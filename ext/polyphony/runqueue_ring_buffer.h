@@ -6,6 +6,7 @@
 typedef struct runqueue_entry {
   VALUE fiber;
   VALUE value;
+  uint64_t stamp; // enqueue time in nanoseconds, or 0 if not measured
 } runqueue_entry;
 
 typedef struct runqueue_ring_buffer {
@@ -23,8 +24,8 @@ int runqueue_ring_buffer_empty_p(runqueue_ring_buffer *buffer);
 void runqueue_ring_buffer_clear(runqueue_ring_buffer *buffer);
 
 runqueue_entry runqueue_ring_buffer_shift(runqueue_ring_buffer *buffer);
-void runqueue_ring_buffer_unshift(runqueue_ring_buffer *buffer, VALUE fiber, VALUE value);
-void runqueue_ring_buffer_push(runqueue_ring_buffer *buffer, VALUE fiber, VALUE value);
+void runqueue_ring_buffer_unshift(runqueue_ring_buffer *buffer, VALUE fiber, VALUE value, uint64_t stamp);
+void runqueue_ring_buffer_push(runqueue_ring_buffer *buffer, VALUE fiber, VALUE value, uint64_t stamp);
 
 void runqueue_ring_buffer_delete(runqueue_ring_buffer *buffer, VALUE fiber);
 int runqueue_ring_buffer_delete_if_not_exception(runqueue_ring_buffer *buffer, VALUE fiber);
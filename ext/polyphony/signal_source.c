@@ -0,0 +1,205 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "polyphony.h"
+#include "signal_source.h"
+
+#ifdef POLYPHONY_LINUX
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#endif
+
+#define SIGNAL_SOURCE_BATCH 16
+
+static VALUE cFiber;
+static ID ID_schedule_priority_oob_fiber;
+
+void signal_source_init(signal_source_t *src) {
+  src->fd = -1;
+  src->ready = 0;
+  sigemptyset(&src->mask);
+  src->handlers = Qnil;
+}
+
+static void signal_source_restore_actions(signal_source_t *src);
+
+void signal_source_free(signal_source_t *src) {
+  if (src->fd == -1) return;
+
+  signal_source_restore_actions(src);
+  close(src->fd);
+  src->fd = -1;
+}
+
+void signal_source_mark(signal_source_t *src) {
+  if (src->handlers != Qnil) rb_gc_mark(src->handlers);
+}
+
+#ifdef POLYPHONY_LINUX
+
+// Trapped signals are blocked only in the trapping thread, but the process may
+// have other threads (such as Ruby's timer thread) that do not block them, and
+// to which the kernel would deliver them. The signal dispositions are therefore
+// set to a forwarding handler that resends the signal to the trapping thread,
+// in which it stays pending until read from the signalfd. Dispositions are
+// process-wide, so the forwarding state is global.
+static volatile pid_t signal_owner_tids[NSIG];
+static struct sigaction signal_saved_actions[NSIG];
+
+static void signal_source_forward(int signo) {
+  int saved_errno = errno;
+  pid_t tid = signal_owner_tids[signo];
+
+  if (tid) syscall(SYS_tgkill, getpid(), tid, signo);
+  errno = saved_errno;
+}
+
+static inline pid_t current_tid(void) {
+  return (pid_t)syscall(SYS_gettid);
+}
+
+// Updates the signalfd with the current mask, creating it if needed.
+static inline void signal_source_update_fd(signal_source_t *src) {
+  int fd = signalfd(src->fd, &src->mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (fd == -1) {
+    int e = errno;
+    rb_syserr_fail(e, strerror(e));
+  }
+  src->fd = fd;
+}
+
+// Signals reserved by Ruby's VM, which Signal.trap refuses to trap.
+static const struct {
+  int signo;
+  const char *name;
+} signal_reserved[] = {
+  { SIGSEGV, "SIGSEGV" },
+  { SIGBUS, "SIGBUS" },
+  { SIGILL, "SIGILL" },
+  { SIGFPE, "SIGFPE" },
+  { SIGVTALRM, "SIGVTALRM" }
+};
+
+static inline void signal_source_check_signo(int signo) {
+  if (signo <= 0 || signo >= NSIG) rb_raise(rb_eArgError, "Invalid signal number %d", signo);
+
+  for (size_t i = 0; i < sizeof(signal_reserved) / sizeof(signal_reserved[0]); i++)
+    if (signal_reserved[i].signo == signo)
+      rb_raise(rb_eArgError, "can't trap reserved signal: %s", signal_reserved[i].name);
+}
+
+// Sets the handler for the given signal, returning the previous handler. A nil
+// handler removes the signal from the signal source, unblocking it in the
+// current thread.
+VALUE signal_source_trap(signal_source_t *src, int signo, VALUE handler) {
+  sigset_t set;
+  VALUE key = INT2NUM(signo);
+  VALUE prev;
+
+  signal_source_check_signo(signo);
+  if (src->handlers == Qnil) src->handlers = rb_hash_new();
+  prev = rb_hash_aref(src->handlers, key);
+
+  sigemptyset(&set);
+  sigaddset(&set, signo);
+  if (handler == Qnil) {
+    if (prev == Qnil) return Qnil;
+
+    sigdelset(&src->mask, signo);
+    signal_source_update_fd(src);
+    rb_hash_delete(src->handlers, key);
+    sigaction(signo, &signal_saved_actions[signo], NULL);
+    signal_owner_tids[signo] = 0;
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+  }
+  else {
+    sigaddset(&src->mask, signo);
+    signal_source_update_fd(src);
+    rb_hash_aset(src->handlers, key, handler);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    signal_owner_tids[signo] = current_tid();
+    if (prev == Qnil) {
+      struct sigaction sa;
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_handler = signal_source_forward;
+      sa.sa_flags = SA_RESTART;
+      sigfillset(&sa.sa_mask);
+      if (sigaction(signo, &sa, &signal_saved_actions[signo])) {
+        // the signal cannot be caught (SIGKILL, SIGSTOP), undo the above
+        int e = errno;
+        signal_owner_tids[signo] = 0;
+        pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+        rb_hash_delete(src->handlers, key);
+        sigdelset(&src->mask, signo);
+        signal_source_update_fd(src);
+        rb_syserr_fail(e, strerror(e));
+      }
+    }
+  }
+  return prev;
+}
+
+// Restores the dispositions of all trapped signals.
+static void signal_source_restore_actions(signal_source_t *src) {
+  for (int signo = 1; signo < NSIG; signo++) {
+    if (!sigismember(&src->mask, signo)) continue;
+
+    signal_owner_tids[signo] = 0;
+    sigaction(signo, &signal_saved_actions[signo], NULL);
+  }
+}
+
+// Makes the current thread the owner of trapped signals. This is called after
+// forking, since the forked process's thread has a different thread id.
+void signal_source_post_fork(signal_source_t *src) {
+  pid_t tid = current_tid();
+
+  for (int signo = 1; signo < NSIG; signo++)
+    if (sigismember(&src->mask, signo)) signal_owner_tids[signo] = tid;
+}
+
+// Reads all pending signals from the signalfd and schedules their handlers.
+void signal_source_dispatch(signal_source_t *src) {
+  struct signalfd_siginfo infos[SIGNAL_SOURCE_BATCH];
+  ssize_t n;
+
+  src->ready = 0;
+  if (src->fd == -1) return;
+
+  do {
+    n = read(src->fd, infos, sizeof(infos));
+    if (n <= 0) break;
+
+    for (unsigned int i = 0; i < n / sizeof(struct signalfd_siginfo); i++) {
+      VALUE handler = rb_hash_aref(src->handlers, INT2NUM(infos[i].ssi_signo));
+      if (handler != Qnil)
+        rb_funcall_with_block(cFiber, ID_schedule_priority_oob_fiber, 0, NULL, handler);
+    }
+  } while (n == sizeof(infos));
+}
+
+#else
+
+VALUE signal_source_trap(signal_source_t *src, int signo, VALUE handler) {
+  if (handler == Qnil) return Qnil;
+
+  rb_raise(rb_eNotImpError, "signalfd is not available on this platform");
+}
+
+static void signal_source_restore_actions(signal_source_t *src) {
+}
+
+void signal_source_post_fork(signal_source_t *src) {
+}
+
+void signal_source_dispatch(signal_source_t *src) {
+  src->ready = 0;
+}
+
+#endif
+
+void Init_SignalSource(void) {
+  cFiber = rb_const_get(rb_cObject, rb_intern("Fiber"));
+  ID_schedule_priority_oob_fiber = rb_intern("schedule_priority_oob_fiber");
+}
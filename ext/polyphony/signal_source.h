@@ -0,0 +1,35 @@
+#ifndef SIGNAL_SOURCE_H
+#define SIGNAL_SOURCE_H
+
+#include <signal.h>
+#include "ruby.h"
+
+// A signal source delivers trapped signals through a signalfd owned by the
+// backend, instead of through Ruby's signal handling machinery. Trapped signals
+// are blocked in the trapping thread, so they remain pending until read from
+// the signalfd, which is watched by the backend along with any other fd. When
+// the signalfd becomes readable, the backend sets the ready flag, and after
+// polling reads the pending signals in a single batch, scheduling the handler
+// for each signal as a prioritised out-of-band fiber (see
+// `Fiber.schedule_priority_oob_fiber`).
+//
+// Since other threads may not block trapped signals, a forwarding handler
+// resends trapped signals delivered to other threads to the trapping thread.
+// Signal sources are only available on Linux.
+typedef struct signal_source {
+  int       fd;
+  int       ready;
+  sigset_t  mask;
+  VALUE     handlers;
+} signal_source_t;
+
+#define SIGNAL_SOURCE_ACTIVE(src) ((src)->fd != -1)
+
+void signal_source_init(signal_source_t *src);
+void signal_source_free(signal_source_t *src);
+void signal_source_mark(signal_source_t *src);
+VALUE signal_source_trap(signal_source_t *src, int signo, VALUE handler);
+void signal_source_post_fork(signal_source_t *src);
+void signal_source_dispatch(signal_source_t *src);
+
+#endif /* SIGNAL_SOURCE_H */
@@ -0,0 +1,94 @@
+#include <spawn.h>
+#include <signal.h>
+#include "polyphony.h"
+
+extern char **environ;
+
+// Fills the given NULL-terminated array of C strings from an array of strings.
+static inline void spawn_fill_cstr_array(VALUE ary, char **ptr) {
+  long len = RARRAY_LEN(ary);
+
+  for (long i = 0; i < len; i++) {
+    VALUE str = RARRAY_AREF(ary, i);
+    ptr[i] = StringValueCStr(str);
+  }
+  ptr[len] = NULL;
+}
+
+/* Spawns a child process using `posix_spawnp`, returning its pid. The program
+ * is searched for in `PATH`. The child's stdin, stdout and stderr are set to
+ * the given fds, a nil fd meaning the corresponding fd is inherited. All other
+ * fds opened by Ruby and by Polyphony are close-on-exec, and are therefore not
+ * inherited. Signal dispositions and the signal mask are reset to their
+ * defaults in the child process.
+ *
+ * This method is used by `Polyphony.spawn`, which should normally be used
+ * instead.
+ *
+ * @param argv [Array<String>] program and arguments
+ * @param env [Array<String>, nil] environment as `NAME=VALUE` strings, or nil to inherit
+ * @param fds [Array<Integer, nil>] stdin, stdout and stderr fds
+ * @return [Integer] child pid
+ */
+
+static VALUE Polyphony_posix_spawn(VALUE self, VALUE argv, VALUE env, VALUE fds) {
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  sigset_t sigset;
+  char **c_argv;
+  char **c_env = environ;
+  VALUE argv_alloc = 0;
+  VALUE env_alloc = 0;
+  pid_t pid;
+  int ret;
+
+  Check_Type(argv, T_ARRAY);
+  Check_Type(fds, T_ARRAY);
+  if (!RARRAY_LEN(argv)) rb_raise(rb_eArgError, "Missing program");
+  if (RARRAY_LEN(fds) != 3) rb_raise(rb_eArgError, "Expected 3 fds");
+
+  c_argv = ALLOCV_N(char *, argv_alloc, RARRAY_LEN(argv) + 1);
+  spawn_fill_cstr_array(argv, c_argv);
+  if (env != Qnil) {
+    Check_Type(env, T_ARRAY);
+    c_env = ALLOCV_N(char *, env_alloc, RARRAY_LEN(env) + 1);
+    spawn_fill_cstr_array(env, c_env);
+  }
+
+  posix_spawn_file_actions_init(&actions);
+  for (int i = 0; i < 3; i++) {
+    VALUE fd = RARRAY_AREF(fds, i);
+    if (fd != Qnil && NUM2INT(fd) != i)
+      posix_spawn_file_actions_adddup2(&actions, NUM2INT(fd), i);
+  }
+
+  posix_spawnattr_init(&attr);
+  sigemptyset(&sigset);
+  posix_spawnattr_setsigmask(&attr, &sigset);
+  sigfillset(&sigset);
+  sigdelset(&sigset, SIGKILL);
+  sigdelset(&sigset, SIGSTOP);
+  posix_spawnattr_setsigdefault(&attr, &sigset);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+  ret = posix_spawnp(&pid, c_argv[0], &actions, &attr, c_argv, c_env);
+
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  if (env_alloc) ALLOCV_END(env_alloc);
+
+  if (ret) {
+    VALUE program = RARRAY_AREF(argv, 0);
+    if (argv_alloc) ALLOCV_END(argv_alloc);
+    rb_syserr_fail_str(ret, program);
+  }
+  if (argv_alloc) ALLOCV_END(argv_alloc);
+
+  RB_GC_GUARD(argv);
+  RB_GC_GUARD(env);
+  return INT2NUM(pid);
+}
+
+void Init_Spawn(void) {
+  rb_define_singleton_method(mPolyphony, "posix_spawn", Polyphony_posix_spawn, 3);
+}
@@ -0,0 +1,219 @@
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include "ruby/debug.h"
+#include "polyphony.h"
+#include "backend_common.h"
+
+#ifdef SIGRTMIN
+#define STALL_DETECTOR_SIGNAL (SIGRTMIN + 3)
+#else
+#define STALL_DETECTOR_SIGNAL SIGUSR2
+#endif
+
+#define STALL_DETECTOR_MIN_INTERVAL 1000000 // 1ms
+
+// Active detectors are kept in a linked list, which is only modified and
+// traversed while holding the GVL.
+static stall_detector_t *active_detectors = NULL;
+static int signal_handler_installed = 0;
+
+#ifdef HAVE_RB_POSTPONED_JOB_PREREGISTER
+static rb_postponed_job_handle_t stall_detector_job_handle;
+#endif
+
+VALUE SYM_fiber;
+VALUE SYM_tag;
+VALUE SYM_backtrace;
+VALUE SYM_duration;
+
+inline void stall_detector_init(stall_detector_t *detector, struct Backend_base *base) {
+  detector->base = base;
+  detector->running = 0;
+  detector->pending = 0;
+  detector->pending_duration = 0;
+  detector->threshold = 0;
+  detector->count = 0;
+  detector->events = Qnil;
+  detector->next = NULL;
+}
+
+inline void stall_detector_mark(stall_detector_t *detector) {
+  if (detector->events != Qnil) rb_gc_mark(detector->events);
+}
+
+static void stall_detector_record(stall_detector_t *detector) {
+  VALUE fiber = rb_fiber_current();
+  VALUE event = rb_hash_new();
+
+  rb_hash_aset(event, SYM_fiber, fiber);
+  rb_hash_aset(event, SYM_tag, rb_ivar_get(fiber, ID_ivar_tag));
+  rb_hash_aset(event, SYM_backtrace, rb_make_backtrace());
+  rb_hash_aset(event, SYM_duration, DBL2NUM(detector->pending_duration / 1e9));
+
+  if (RARRAY_LEN(detector->events) >= STALL_DETECTOR_MAX_EVENTS)
+    rb_ary_shift(detector->events);
+  rb_ary_push(detector->events, event);
+  detector->count++;
+  RB_GC_GUARD(event);
+}
+
+// Runs on the stalled thread at the next safe point.
+static void stall_detector_job(void *data) {
+  pthread_t self = pthread_self();
+
+  for (stall_detector_t *detector = active_detectors; detector; detector = detector->next) {
+    if (!detector->pending || !pthread_equal(detector->thread, self)) continue;
+
+    detector->pending = 0;
+    stall_detector_record(detector);
+  }
+}
+
+static void stall_detector_signal_handler(int sig, siginfo_t *info, void *ucontext) {
+  int saved_errno = errno;
+  #ifdef HAVE_RB_POSTPONED_JOB_PREREGISTER
+  rb_postponed_job_trigger(stall_detector_job_handle);
+  #else
+  rb_postponed_job_register_one(0, stall_detector_job, 0);
+  #endif
+  errno = saved_errno;
+}
+
+static void stall_detector_install_signal_handler(void) {
+  struct sigaction sa;
+
+  if (signal_handler_installed) return;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = stall_detector_signal_handler;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(STALL_DETECTOR_SIGNAL, &sa, NULL))
+    rb_syserr_fail(errno, strerror(errno));
+  signal_handler_installed = 1;
+}
+
+static void *stall_detector_watchdog(void *arg) {
+  stall_detector_t *detector = arg;
+  struct Backend_base *base = detector->base;
+  uint64_t interval = detector->threshold / 4;
+  unsigned int last_heartbeat = base->heartbeat;
+  uint64_t last_change = current_time_ns();
+  int reported = 0;
+  struct timespec ts;
+
+  if (interval < STALL_DETECTOR_MIN_INTERVAL) interval = STALL_DETECTOR_MIN_INTERVAL;
+  ts.tv_sec = interval / 1000000000;
+  ts.tv_nsec = interval % 1000000000;
+
+  while (detector->running) {
+    unsigned int heartbeat;
+    uint64_t now;
+
+    nanosleep(&ts, NULL);
+    if (!detector->running) break;
+
+    heartbeat = base->heartbeat;
+    now = current_time_ns();
+    if (heartbeat != last_heartbeat || *(volatile unsigned int *)&base->currently_polling) {
+      last_heartbeat = heartbeat;
+      last_change = now;
+      reported = 0;
+      continue;
+    }
+
+    if (!reported && (now - last_change) >= detector->threshold) {
+      reported = 1;
+      detector->pending_duration = now - last_change;
+      detector->pending = 1;
+      pthread_kill(detector->thread, STALL_DETECTOR_SIGNAL);
+    }
+  }
+  return NULL;
+}
+
+static void stall_detector_unlink(stall_detector_t *detector) {
+  stall_detector_t **ptr = &active_detectors;
+
+  while (*ptr) {
+    if (*ptr == detector) {
+      *ptr = detector->next;
+      break;
+    }
+    ptr = &(*ptr)->next;
+  }
+  detector->next = NULL;
+}
+
+// Starts the stall detector for the current thread's backend. The threshold is
+// given in seconds.
+void stall_detector_start(stall_detector_t *detector, double threshold) {
+  int ret;
+
+  if (threshold <= 0) rb_raise(rb_eArgError, "Invalid stall threshold");
+  stall_detector_stop(detector);
+  stall_detector_install_signal_handler();
+
+  if (detector->events == Qnil) detector->events = rb_ary_new();
+  detector->threshold = threshold * 1e9;
+  detector->thread = pthread_self();
+  detector->pending = 0;
+  detector->running = 1;
+
+  ret = pthread_create(&detector->watchdog, NULL, stall_detector_watchdog, detector);
+  if (ret) {
+    detector->running = 0;
+    rb_syserr_fail(ret, strerror(ret));
+  }
+
+  detector->next = active_detectors;
+  active_detectors = detector;
+}
+
+void stall_detector_stop(stall_detector_t *detector) {
+  if (!detector->running) return;
+
+  detector->running = 0;
+  pthread_join(detector->watchdog, NULL);
+  detector->pending = 0;
+  stall_detector_unlink(detector);
+}
+
+// Resets the detector after a fork. The watchdog thread does not exist in the
+// child process, so it is not joined.
+void stall_detector_reset(stall_detector_t *detector) {
+  if (detector->running) {
+    detector->running = 0;
+    stall_detector_unlink(detector);
+  }
+  detector->pending = 0;
+  detector->count = 0;
+  if (detector->events != Qnil) rb_ary_clear(detector->events);
+}
+
+// Returns all stall events recorded since the last call.
+VALUE stall_detector_events(stall_detector_t *detector) {
+  VALUE events = detector->events;
+
+  if (events == Qnil) return rb_ary_new();
+  detector->events = rb_ary_new();
+  return events;
+}
+
+void stall_detector_setup(void) {
+  #ifdef HAVE_RB_POSTPONED_JOB_PREREGISTER
+  stall_detector_job_handle = rb_postponed_job_preregister(0, stall_detector_job, NULL);
+  #endif
+
+  SYM_fiber     = ID2SYM(rb_intern("fiber"));
+  SYM_tag       = ID2SYM(rb_intern("tag"));
+  SYM_backtrace = ID2SYM(rb_intern("backtrace"));
+  SYM_duration  = ID2SYM(rb_intern("duration"));
+
+  rb_global_variable(&SYM_fiber);
+  rb_global_variable(&SYM_tag);
+  rb_global_variable(&SYM_backtrace);
+  rb_global_variable(&SYM_duration);
+}
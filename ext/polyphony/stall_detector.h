@@ -0,0 +1,40 @@
+#ifndef STALL_DETECTOR_H
+#define STALL_DETECTOR_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "ruby.h"
+
+struct Backend_base;
+
+// The stall detector runs a native watchdog thread that checks that the
+// backend's heartbeat (incremented on each fiber switch and poll) keeps
+// changing. If the heartbeat does not change for longer than the threshold
+// while the backend is not polling, the thread is considered stalled, and the
+// watchdog signals the backend's thread. The signal handler then schedules a
+// postponed job which, running on the stalled thread, records the running
+// fiber, its tag and its backtrace.
+typedef struct stall_detector {
+  struct Backend_base     *base;
+  pthread_t               watchdog;
+  pthread_t               thread;
+  volatile int            running;
+  volatile int            pending;
+  volatile uint64_t       pending_duration;
+  uint64_t                threshold;
+  uint64_t                count;
+  VALUE                   events;
+  struct stall_detector   *next;
+} stall_detector_t;
+
+#define STALL_DETECTOR_MAX_EVENTS 64
+
+void stall_detector_init(stall_detector_t *detector, struct Backend_base *base);
+void stall_detector_start(stall_detector_t *detector, double threshold);
+void stall_detector_stop(stall_detector_t *detector);
+void stall_detector_reset(stall_detector_t *detector);
+void stall_detector_mark(stall_detector_t *detector);
+VALUE stall_detector_events(stall_detector_t *detector);
+void stall_detector_setup();
+
+#endif /* STALL_DETECTOR_H */
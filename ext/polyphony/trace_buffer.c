@@ -0,0 +1,80 @@
+#include <string.h>
+#include "polyphony.h"
+#include "trace_buffer.h"
+
+inline void trace_buffer_init(trace_buffer *buffer) {
+  buffer->records = NULL;
+  buffer->mask = 0;
+  buffer->head = 0;
+  buffer->tail = 0;
+  buffer->dropped = 0;
+  buffer->enabled = 0;
+}
+
+inline void trace_buffer_free(trace_buffer *buffer) {
+  if (buffer->records) free(buffer->records);
+  trace_buffer_init(buffer);
+}
+
+// Starts recording into a buffer of the given capacity, rounded up to the next
+// power of two. Any previously recorded (unread) records are discarded.
+void trace_buffer_start(trace_buffer *buffer, unsigned long capacity) {
+  uint64_t size = 1;
+
+  if (capacity < 1) rb_raise(rb_eArgError, "Invalid trace buffer capacity");
+  while (size < capacity) size <<= 1;
+
+  if (buffer->records && size != buffer->mask + 1) trace_buffer_free(buffer);
+  if (!buffer->records) {
+    buffer->records = malloc(size * sizeof(trace_record));
+    if (!buffer->records) rb_raise(rb_eNoMemError, "Failed to allocate trace buffer");
+  }
+
+  buffer->mask = size - 1;
+  buffer->head = buffer->tail = buffer->dropped = 0;
+  buffer->enabled = 1;
+}
+
+// Stops recording. Records already in the buffer can still be read.
+inline void trace_buffer_stop(trace_buffer *buffer) {
+  buffer->enabled = 0;
+}
+
+// Returns all records written since the last read as a binary string, and
+// advances the read position.
+VALUE trace_buffer_read(trace_buffer *buffer) {
+  uint64_t head = buffer->head;
+  uint64_t size = buffer->mask + 1;
+  uint64_t count;
+  uint64_t start;
+  uint64_t first;
+  VALUE str;
+  char *ptr;
+
+  if (!buffer->records) return rb_str_new(0, 0);
+
+  if (head - buffer->tail > size) {
+    buffer->dropped += head - buffer->tail - size;
+    buffer->tail = head - size;
+  }
+  count = head - buffer->tail;
+  start = buffer->tail & buffer->mask;
+  first = (start + count > size) ? size - start : count;
+
+  str = rb_str_new(0, count * sizeof(trace_record));
+  ptr = RSTRING_PTR(str);
+  memcpy(ptr, buffer->records + start, first * sizeof(trace_record));
+  if (count > first)
+    memcpy(ptr + first * sizeof(trace_record), buffer->records, (count - first) * sizeof(trace_record));
+
+  buffer->tail = head;
+  return str;
+}
+
+// Returns the number of records overwritten before being read.
+inline uint64_t trace_buffer_dropped(trace_buffer *buffer) {
+  uint64_t size = buffer->mask + 1;
+  uint64_t pending = buffer->head - buffer->tail;
+
+  return buffer->dropped + ((buffer->records && pending > size) ? pending - size : 0);
+}
@@ -0,0 +1,85 @@
+#ifndef TRACE_BUFFER_H
+#define TRACE_BUFFER_H
+
+#include <stdint.h>
+#include "ruby.h"
+
+// Native trace events. The numbering is part of the binary record format and
+// is mirrored by Polyphony::Trace::NATIVE_EVENTS, so new events should only
+// ever be appended.
+enum trace_event {
+  TRACE_EVENT_NONE = 0,
+  TRACE_EVENT_BLOCK,
+  TRACE_EVENT_UNBLOCK,
+  TRACE_EVENT_SCHEDULE,
+  TRACE_EVENT_ENTER_POLL,
+  TRACE_EVENT_LEAVE_POLL,
+  TRACE_EVENT_OP_SUBMIT,
+  TRACE_EVENT_OP_COMPLETE,
+  TRACE_EVENT_OP_CANCEL
+};
+
+// A fixed-size (48 bytes) binary trace record. Records are written and dumped
+// in native byte order.
+typedef struct trace_record {
+  uint64_t stamp;     // monotonic clock, nanoseconds
+  uint64_t fiber;     // fiber id (see Fiber#trace_id)
+  uint64_t duration;  // nanoseconds, or 0 if not applicable
+  int64_t result;     // for op submit events, the requested length
+  uint64_t id;        // op id for op events, otherwise 0
+  int32_t fd;
+  uint16_t event;
+  uint16_t op;
+} trace_record;
+
+// A single-producer ring buffer of trace records. Each backend (and therefore
+// each thread) has its own buffer, which is written only by the owning thread,
+// so no locking is needed. When the buffer is full, the oldest records are
+// overwritten and counted as dropped.
+typedef struct trace_buffer {
+  trace_record *records;
+  uint64_t mask;
+  uint64_t head;
+  uint64_t tail;
+  uint64_t dropped;
+  int enabled;
+} trace_buffer;
+
+void trace_buffer_init(trace_buffer *buffer);
+void trace_buffer_free(trace_buffer *buffer);
+void trace_buffer_start(trace_buffer *buffer, unsigned long capacity);
+void trace_buffer_stop(trace_buffer *buffer);
+VALUE trace_buffer_read(trace_buffer *buffer);
+uint64_t trace_buffer_dropped(trace_buffer *buffer);
+
+uint64_t current_time_ns();
+
+static inline void trace_buffer_push(
+  trace_buffer *buffer, uint16_t event, VALUE fiber, uint16_t op, int32_t fd,
+  int64_t result, uint64_t since, uint64_t id
+) {
+  uint64_t now = current_time_ns();
+  trace_record *record = &buffer->records[buffer->head & buffer->mask];
+
+  record->stamp = now;
+  record->fiber = (uint64_t)fiber;
+  record->duration = since ? now - since : 0;
+  record->result = result;
+  record->id = id;
+  record->fd = fd;
+  record->event = event;
+  record->op = op;
+  buffer->head++;
+}
+
+// Records a trace event if native tracing is enabled. When disabled, this
+// costs a single branch.
+#define NATIVE_TRACE(base, event, fiber, op, fd, result, since) \
+  if ((base)->trace_buffer.enabled) \
+    trace_buffer_push(&(base)->trace_buffer, event, fiber, op, fd, result, since, 0);
+
+// Returns a timestamp for measuring an event's duration, or 0 if native
+// tracing is disabled.
+#define NATIVE_TRACE_STAMP(base) ((base)->trace_buffer.enabled ? current_time_ns() : 0)
+
+#endif /* TRACE_BUFFER_H */
@@ -14,6 +14,9 @@ require_relative './polyphony/core/sync'
 require_relative './polyphony/core/timer'
 require_relative './polyphony/net'
 require_relative './polyphony/adapters/process'
+require_relative './polyphony/core/stats'
+require_relative './polyphony/core/profiler'
+require_relative './polyphony/core/spawn'
 
 # Polyphony API
 module Polyphony
@@ -49,6 +52,59 @@ module Polyphony
       Polyphony::Process.watch(cmd, &block)
     end
 
+    # Waits for the given child processes to terminate, reaping them as they
+    # exit. A single wait is registered with the backend for each process
+    # (using a pidfd where available), and processes terminating at the same
+    # time are reaped in a single batch.
+    #
+    # If a block is given, the pid and exit status of each process is yielded
+    # as it terminates, until all processes have terminated. Otherwise, returns
+    # once at least one of the processes has terminated.
+    #
+    # A process that was already reaped by other means (e.g. `Process.wait`) is
+    # returned immediately with a nil exit status.
+    #
+    # @param pids [Array<Integer>] pids
+    # @yield [Integer, Integer] pid and exit status
+    # @return [Array<Array>] array of [pid, exit status] pairs
+    def waitpid_any(pids)
+      return backend_waitpid_any(pids) unless block_given?
+
+      pending = pids.dup
+      results = []
+      until pending.empty?
+        backend_waitpid_any(pending).each do |pid, status|
+          pending.delete(pid)
+          results << [pid, status]
+          yield pid, status
+        end
+      end
+      results
+    end
+
+    # Sets whether signals trapped on the main thread using `Kernel#trap` are
+    # delivered through a signalfd polled by the backend (Linux only), instead
+    # of through Ruby's signal handling. Trapped signals are blocked in the main
+    # thread, and their handlers are run in prioritised out-of-band fibers as
+    # soon as the backend polls for events. Signalfd delivery can also be
+    # enabled by setting the `POLYPHONY_SIGNALFD` environment variable.
+    #
+    # Since trapped signals are blocked, child processes created with
+    # `Kernel#fork` or Ruby's own process spawning methods inherit them as
+    # blocked. Processes spawned using `Polyphony.spawn` have all signals
+    # unblocked.
+    #
+    # @param enabled [bool] whether to use signalfd delivery
+    attr_writer :signalfd
+
+    # Returns true if signals trapped on the main thread are delivered through
+    # a signalfd.
+    #
+    # @return [bool]
+    def signalfd?
+      @signalfd
+    end
+
     private
 
     # @!visibility private
@@ -139,6 +195,8 @@ module Polyphony
   Object.const_set(:ConditionVariable, Polyphony::ConditionVariable)
   $VERBOSE = verbose
 
+  @signalfd = !!ENV['POLYPHONY_SIGNALFD']
+  self.poison_reused_buffers = !!ENV['POLYPHONY_POISON_REUSED_BUFFERS']
   install_terminating_signal_handlers
   install_at_exit_handler
 end
@@ -0,0 +1,207 @@
+# frozen_string_literal: true
+
+require 'polyphony'
+require 'socket'
+
+module Polyphony
+
+  # Implements a load generator for benchmarking servers over loopback TCP or
+  # UNIX sockets. The load generator opens a number of connections, each driven
+  # by a separate fiber, and reports throughput and latency percentiles.
+  #
+  # Three patterns are supported:
+  #
+  # - `:echo` - sends a request and waits for the same number of bytes to be
+  #   sent back.
+  # - `:http` - sends an HTTP/1.1 request and reads a response with a
+  #   `Content-Length` header.
+  # - `:stream` - continuously writes the request data, while separately reading
+  #   any data sent back. Only throughput is measured.
+  #
+  # If a rate is given, requests are sent at a fixed rate (spread evenly among
+  # all connections). The latency of each request is then measured from the
+  # time it was supposed to be sent, rather than the time it was actually sent,
+  # correcting for coordinated omission: a slow response delays all subsequent
+  # requests on the same connection, and their latency includes that delay.
+  #
+  # Example:
+  #
+  #   report = Polyphony::Bench.run('tcp://127.0.0.1:1234', connections: 10, duration: 5)
+  #   puts Polyphony::Bench.format_report(report)
+  module Bench
+    # Default options.
+    DEFAULTS = {
+      pattern: :echo,
+      connections: 10,
+      duration: 10,
+      warmup: 0,
+      rate: nil,
+      request: "#{'x' * 63}\n"
+    }.freeze
+
+    # Reported latency percentiles.
+    PERCENTILES = [50, 90, 99, 99.9].freeze
+
+    class << self
+      # Runs a benchmark against the given target, which is either a
+      # `tcp://host:port` or a `unix:path` URL.
+      #
+      # @param target [String] target URL
+      # @param opts [Hash] options
+      # @option opts [Symbol] :pattern :echo, :http or :stream
+      # @option opts [Integer] :connections number of connections
+      # @option opts [Number] :duration duration in seconds
+      # @option opts [Number] :warmup warmup duration in seconds
+      # @option opts [Number, nil] :rate total requests per second
+      # @option opts [String] :request request data
+      # @option opts [String] :path request path for the :http pattern
+      # @return [Hash] report
+      def run(target, **opts)
+        http_default = opts[:pattern] == :http && !opts.key?(:request)
+        opts = DEFAULTS.merge(opts)
+        opts[:request] = http_request(target, opts[:path] || '/') if http_default
+        connections = opts[:connections].times.map { connect(target) }
+        run_phase(connections, opts, opts[:warmup]) if opts[:warmup] > 0
+        report = run_phase(connections, opts, opts[:duration])
+        report.merge(target: target, pattern: opts[:pattern], connections: connections.size, rate_limit: opts[:rate])
+      ensure
+        connections&.each(&:close)
+      end
+
+      # Formats a report as a human-readable string.
+      #
+      # @param report [Hash] report as returned by `Bench.run`
+      # @return [String] formatted report
+      def format_report(report)
+        lines = []
+        lines << format('%<target>s, %<pattern>s, %<connections>d connections', report)
+        lines << format('  %d requests in %.2fs, %.1f req/s, %.1f MB/s',
+                        report[:requests], report[:elapsed], report[:throughput],
+                        report[:bytes] / report[:elapsed] / 1_000_000.0)
+        lines << format('  %d errors', report[:errors]) if report[:errors] > 0
+        if (latency = report[:latency])
+          values = latency.map { |k, v| format('%s %.3fms', k, v * 1000) }
+          lines << "  latency: #{values.join(', ')}"
+        end
+        lines.join("\n")
+      end
+
+      private
+
+      def connect(target)
+        case target
+        when %r{^tcp://(.+):(\d+)$}
+          TCPSocket.new(Regexp.last_match(1), Regexp.last_match(2).to_i)
+        when /^unix:(.+)$/
+          UNIXSocket.new(Regexp.last_match(1))
+        else
+          raise ArgumentError, "Invalid target #{target.inspect}"
+        end
+      end
+
+      def http_request(target, path)
+        host = target =~ %r{^tcp://(.+)$} ? Regexp.last_match(1) : 'localhost'
+        "GET #{path} HTTP/1.1\r\nHost: #{host}\r\n\r\n"
+      end
+
+      def run_phase(connections, opts, duration)
+        state = { requests: 0, errors: 0, bytes: 0, histogram: Histogram.new }
+        interval = opts[:rate] && (connections.size / opts[:rate].to_f)
+        t0 = now
+        deadline = t0 + duration
+        fibers = connections.map do |conn|
+          spin { drive_connection(conn, opts, state, deadline, interval) }
+        end
+        Fiber.await(*fibers)
+        elapsed = now - t0
+        phase_report(state, elapsed, opts[:pattern])
+      end
+
+      def phase_report(state, elapsed, pattern)
+        report = {
+          requests: state[:requests],
+          errors: state[:errors],
+          bytes: state[:bytes],
+          elapsed: elapsed,
+          throughput: state[:requests] / elapsed
+        }
+        return report if pattern == :stream
+
+        histogram = state[:histogram]
+        report[:latency] = PERCENTILES.each_with_object({}) do |pct, h|
+          h[:"p#{pct.to_s.delete('.')}"] = histogram.percentile(pct) / 1e9
+        end
+        report[:latency][:max] = histogram.max / 1e9
+        report[:latency][:mean] = histogram.mean / 1e9
+        report
+      end
+
+      def drive_connection(conn, opts, state, deadline, interval)
+        return drive_stream(conn, opts, state, deadline) if opts[:pattern] == :stream
+
+        request = opts[:request]
+        buffer = String.new(encoding: Encoding::BINARY)
+        intended = now
+        while (t = now) < deadline
+          if interval
+            sleep(intended - t) if intended > t
+            start = intended
+            intended += interval
+          else
+            start = t
+          end
+          conn << request
+          bytes = read_response(conn, buffer, opts[:pattern], request.bytesize)
+          state[:bytes] += bytes
+          state[:histogram].record([((now - start) * 1e9).to_i, 0].max)
+          state[:requests] += 1
+        end
+      rescue SystemCallError, IOError, EOFError
+        state[:errors] += 1
+      end
+
+      def drive_stream(conn, opts, state, deadline)
+        request = opts[:request]
+        reader = spin do
+          conn.read_loop { |data| state[:bytes] += data.bytesize }
+        rescue SystemCallError, IOError
+          # connection closed
+        end
+        while now < deadline
+          conn << request
+          state[:requests] += 1
+        end
+        reader.stop
+      rescue SystemCallError, IOError
+        state[:errors] += 1
+      end
+
+      def read_response(conn, buffer, pattern, request_size)
+        pattern == :http ? read_http_response(conn, buffer) : read_exactly(conn, request_size)
+      end
+
+      def read_exactly(conn, len)
+        left = len
+        left -= conn.readpartial(left).bytesize while left > 0
+        len
+      end
+
+      # Reads an HTTP response, using the given buffer for any data read past
+      # the end of the response.
+      def read_http_response(conn, buffer)
+        conn.readpartial(65536, buffer, -1) until (header_end = buffer.index("\r\n\r\n"))
+
+        headers = buffer[0, header_end]
+        length = headers =~ /^content-length:\s*(\d+)/i ? Regexp.last_match(1).to_i : 0
+        total = header_end + 4 + length
+        conn.readpartial(65536, buffer, -1) while buffer.bytesize < total
+        buffer.slice!(0, total)
+        total
+      end
+
+      def now
+        ::Process.clock_gettime(::Process::CLOCK_MONOTONIC)
+      end
+    end
+  end
+end
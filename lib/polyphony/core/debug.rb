@@ -24,19 +24,131 @@ module Polyphony
   # Trace provides tools for tracing the activity of the current thread's
   # backend.
   module Trace
+    # Native trace event types, indexed by their numeric value in trace records.
+    NATIVE_EVENTS = %i[
+      none block unblock schedule enter_poll leave_poll op_submit op_complete op_cancel
+    ].freeze
+
+    # Native trace record layout: stamp, fiber, duration, result, id, fd, event,
+    # op. For op events, the result is the requested length for `:op_submit`
+    # and the op result for `:op_complete`, and the id identifies the op.
+    NATIVE_RECORD_FORMAT = 'QQQqQlSS'
+
     class << self
 
+      # Starts native tracing for the current thread's backend. Events are
+      # recorded as fixed-size binary records into a ring buffer of the given
+      # capacity (rounded up to a power of two). When the buffer is full, the
+      # oldest unread records are overwritten. If a dump destination is given,
+      # the records left in the buffer are appended to it when tracing is
+      # stopped. If ops is true, op events (`:op_submit`, `:op_complete` and
+      # `:op_cancel`) are also recorded. Op events are enabled or disabled for
+      # the backend as a whole, and are disabled once tracing stops.
+      #
+      # @param capacity [Integer] ring buffer capacity in records
+      # @param dump [String, IO, nil] dump file path or IO instance
+      # @param ops [bool] whether to record op events
+      # @return [void]
+      def start_native(capacity = 65536, dump: nil, ops: false)
+        Thread.current.thread_variable_set(:native_trace_dump, dump)
+        Thread.backend.trace_ops = ops
+        Thread.backend.trace_buffer_start(capacity)
+      end
+
+      # Stops native tracing for the current thread's backend, dumping pending
+      # records if a dump destination was given to `#start_native`. Records
+      # still in the buffer can be read using `#read_native`.
+      #
+      # @return [void]
+      def stop_native
+        Thread.backend.trace_buffer_stop
+        dump = Thread.current.thread_variable_get(:native_trace_dump)
+        return unless dump
+
+        Thread.current.thread_variable_set(:native_trace_dump, nil)
+        dump_native(dump)
+      end
+
+      # Reads and decodes all native trace records written since the last read.
+      #
+      # @return [Array<Hash>] trace records
+      def read_native
+        decode_native(Thread.backend.trace_buffer_read)
+      end
+
+      # Appends all native trace records written since the last read to the
+      # given file or IO, in binary form.
+      #
+      # @param dest [String, IO] file path or IO instance
+      # @return [Integer] number of records written
+      def dump_native(dest)
+        data = Thread.backend.trace_buffer_read
+        if dest.is_a?(String)
+          File.open(dest, 'ab') { |f| f.orig_write(data) }
+        else
+          dest.orig_write(data)
+        end
+        data.bytesize / native_record_size
+      end
+
+      # Loads and decodes native trace records from the given dump file.
+      #
+      # @param path [String] file path
+      # @return [Array<Hash>] trace records
+      def load_native(path)
+        decode_native(IO.binread(path))
+      end
+
+      # Decodes binary native trace records.
+      #
+      # @param data [String] binary trace records
+      # @return [Array<Hash>] trace records
+      def decode_native(data)
+        count = data.bytesize / native_record_size
+        data.unpack(NATIVE_RECORD_FORMAT * count).each_slice(8).map do |stamp, fiber, duration, result, id, fd, event, op|
+          {
+            stamp: stamp,
+            event: NATIVE_EVENTS[event],
+            fiber: fiber,
+            op: op,
+            id: id,
+            fd: fd,
+            result: result,
+            duration: duration
+          }
+        end
+      end
+
+      # Returns the number of native trace records dropped (overwritten before
+      # being read) for the current thread's backend.
+      #
+      # @return [Integer] dropped record count
+      def native_dropped_count
+        Thread.backend.trace_buffer_dropped
+      end
+
       # Starts tracing, emitting events converted to hashes to the given block.
-      # If an IO instance is given, events are dumped to it instead.
+      # If an IO instance is given, events are dumped to it instead. If ops is
+      # true, op events are also emitted. The firehose is stopped (and op
+      # events disabled) by setting the backend's trace proc to nil.
       #
       # @param io [IO, nil] IO instance
+      # @param ops [bool] whether to emit op events
       # @yield [Hash] event information
-      def start_event_firehose(io = nil, &block)
+      def start_event_firehose(io = nil, ops: false, &block)
+        Thread.backend.trace_ops = ops
         Thread.backend.trace_proc = firehose_proc(io, block)
       end
 
       private
 
+      # Returns the size of a native trace record in bytes.
+      #
+      # @return [Integer] record size
+      def native_record_size
+        @native_record_size ||= [0, 0, 0, 0, 0, 0, 0, 0].pack(NATIVE_RECORD_FORMAT).bytesize
+      end
+
       # Returns a firehose proc for the given io and block.
       #
       # @param io [IO, nil] IO instance
@@ -92,6 +204,49 @@ module Polyphony
         {}
       end
 
+      # Returns an event hash for a `:op_submit` event.
+      #
+      # @param e [Array] event array
+      # @return [Hash] event hash
+      def event_props_op_submit(e)
+        {
+          fiber: e[1],
+          id: e[2],
+          op: e[3],
+          fd: e[4],
+          length: e[5]
+        }
+      end
+
+      # Returns an event hash for a `:op_complete` event.
+      #
+      # @param e [Array] event array
+      # @return [Hash] event hash
+      def event_props_op_complete(e)
+        {
+          fiber: e[1],
+          id: e[2],
+          op: e[3],
+          fd: e[4],
+          result: e[5],
+          latency: e[6]
+        }
+      end
+
+      # Returns an event hash for a `:op_cancel` event.
+      #
+      # @param e [Array] event array
+      # @return [Hash] event hash
+      def event_props_op_cancel(e)
+        {
+          fiber: e[1],
+          id: e[2],
+          op: e[3],
+          fd: e[4],
+          latency: e[5]
+        }
+      end
+
       # Returns an event hash for a `:schedule` event.
       #
       # @param e [Array] event array
@@ -0,0 +1,76 @@
+# frozen_string_literal: true
+
+module Polyphony
+
+  # Profiles the current thread, recording both on-CPU time (by sampling the
+  # running fiber's stack) and off-CPU time (by recording the stack of each
+  # fiber waiting for an I/O op or other event, along with the op and fd it
+  # waited on). Profiles are output in the collapsed stack format used by
+  # flamegraph tools, with weights in microseconds.
+  #
+  # Example:
+  #
+  #   profile = Polyphony::Profiler.profile { run_workload }
+  #   File.write('profile.txt', Polyphony::Profiler.collapsed(profile))
+  #   # flamegraph.pl profile.txt > profile.svg
+  #
+  # On-CPU sampling uses a dedicated real-time signal (or SIGPROF on platforms
+  # without real-time signals, in which case it cannot be used together with
+  # other profilers relying on SIGPROF). The signal's previous disposition is
+  # restored once profiling stops.
+  module Profiler
+    class << self
+      # Starts profiling the current thread.
+      #
+      # @param interval [Number] sampling interval in seconds
+      # @return [void]
+      def start(interval: 0.001)
+        Thread.current.backend.profile_start(interval)
+      end
+
+      # Stops profiling the current thread, returning the collected profile.
+      #
+      # @return [Hash] profile with :on_cpu and :off_cpu entries
+      def stop
+        backend = Thread.current.backend
+        backend.profile_stop
+        backend.profile_result
+      end
+
+      # Profiles the given block, returning the collected profile.
+      #
+      # @param interval [Number] sampling interval in seconds
+      # @return [Hash] profile with :on_cpu and :off_cpu entries
+      def profile(interval: 0.001)
+        start(interval: interval)
+        yield
+        stop
+      rescue Exception
+        Thread.current.backend.profile_stop
+        raise
+      end
+
+      # Converts the given profile to the collapsed stack format, one stack per
+      # line followed by its weight in microseconds. In :all mode, on-CPU and
+      # off-CPU stacks are included under `on-cpu` and `off-cpu` root frames.
+      #
+      # @param profile [Hash] profile
+      # @param mode [Symbol] :on_cpu, :off_cpu or :all
+      # @return [String] collapsed stacks
+      def collapsed(profile, mode = :all)
+        buf = +''
+        %i[on_cpu off_cpu].each do |kind|
+          next unless mode == :all || mode == kind
+
+          root = mode == :all ? "#{kind.to_s.tr('_', '-')};" : ''
+          profile[kind].each do |stack, weight|
+            next if weight == 0
+
+            buf << root << stack << ' ' << weight.to_s << "\n"
+          end
+        end
+        buf
+      end
+    end
+  end
+end
@@ -0,0 +1,176 @@
+# frozen_string_literal: true
+
+module Polyphony
+
+  # Represents a child process spawned using `Polyphony.spawn`. The process's
+  # stdin, stdout and stderr are available as `Polyphony::Pipe` instances when
+  # spawned with the `:pipe` option.
+  class ChildProcess
+    # @return [Integer] process id
+    attr_reader :pid
+
+    # @return [Polyphony::Pipe, nil] pipe connected to the child's stdin
+    attr_reader :stdin
+
+    # @return [Polyphony::Pipe, nil] pipe connected to the child's stdout
+    attr_reader :stdout
+
+    # @return [Polyphony::Pipe, nil] pipe connected to the child's stderr
+    attr_reader :stderr
+
+    # Initializes a child process instance.
+    #
+    # @param pid [Integer] process id
+    # @param stdin [Polyphony::Pipe, nil] stdin pipe
+    # @param stdout [Polyphony::Pipe, nil] stdout pipe
+    # @param stderr [Polyphony::Pipe, nil] stderr pipe
+    def initialize(pid, stdin, stdout, stderr)
+      @pid = pid
+      @stdin = stdin
+      @stdout = stdout
+      @stderr = stderr
+    end
+
+    # Waits for the child process to terminate, returning its exit status.
+    # Further calls return the same exit status.
+    #
+    # @return [Integer] exit status
+    def wait
+      @exit_status ||= Polyphony.backend_waitpid(@pid).last
+    end
+
+    # Returns true if the child process has been waited for.
+    #
+    # @return [bool]
+    def done?
+      !!@exit_status
+    end
+
+    # Closes the pipes connected to the child process, releasing their fds.
+    #
+    # @return [Polyphony::ChildProcess] self
+    def close
+      [@stdin, @stdout, @stderr].each do |pipe|
+        next unless pipe
+
+        pipe.close unless pipe.closed?
+        pipe.close_read
+      end
+      self
+    end
+
+    # Sends the given signal to the child process.
+    #
+    # @param sig [String, Symbol, Integer] signal
+    # @return [Polyphony::ChildProcess] self
+    def kill(sig = 'TERM')
+      ::Process.kill(sig, @pid)
+      self
+    end
+  end
+
+  # Characters that cause a command string to be run using the shell, as in
+  # `Kernel#spawn`.
+  SPAWN_SHELL_CHARS = /[*?{}\[\]<>()~&|\\$;'`"\n#=%]/.freeze
+
+  # Shell reserved words and special builtins that cause a command string to be
+  # run using the shell, as in `Kernel#spawn`.
+  SPAWN_SHELL_WORDS = %w[
+    ! . : break case continue do done elif else esac eval exec exit export fi
+    for if in readonly return set shift then times trap until unset while
+  ].freeze
+
+  class << self
+    # Spawns a child process, without forking the Ruby process and without
+    # using a waiter thread. The process is spawned using `posix_spawnp`, and is
+    # waited for using the backend (see `ChildProcess#wait`).
+    #
+    # The command is given either as an array of program and arguments, or as a
+    # string. A string containing shell metacharacters is run using `/bin/sh`,
+    # otherwise it is split on whitespace.
+    #
+    # Each of `stdin`, `stdout` and `stderr` may be:
+    #
+    # - `nil`: the fd is inherited.
+    # - `:pipe`: a `Polyphony::Pipe` is created, available on the returned
+    #   child process instance.
+    # - an IO or `Polyphony::Pipe` instance (the read end of a pipe is used for
+    #   stdin, the write end for stdout and stderr).
+    # - an Integer fd.
+    #
+    # In addition, `stderr` may be `:stdout`, in order to redirect the child's
+    # stderr to its stdout.
+    #
+    # @param cmd [String, Array<String>] command
+    # @param env [Hash, nil] environment variables to set (or unset if nil)
+    # @param stdin [any] stdin
+    # @param stdout [any] stdout
+    # @param stderr [any] stderr
+    # @return [Polyphony::ChildProcess] child process
+    def spawn(cmd, env: nil, stdin: nil, stdout: nil, stderr: nil)
+      pipes = [stdin, stdout, stderr].map { |io| io == :pipe ? Pipe.new : nil }
+      fds = [
+        spawn_fd(pipes[0] || stdin, false),
+        spawn_fd(pipes[1] || stdout, true)
+      ]
+      fds << (stderr == :stdout ? fds[1] : spawn_fd(pipes[2] || stderr, true))
+
+      pid = posix_spawn(spawn_argv(cmd), spawn_env(env), fds)
+      # close the ends of the pipes used by the child, so the child's output is
+      # read until the child closes them
+      pipes[0]&.close_read
+      pipes[1]&.close
+      pipes[2]&.close
+      ChildProcess.new(pid, *pipes)
+    end
+
+    private
+
+    # Converts a command to an argv array.
+    #
+    # @param cmd [String, Array<String>] command
+    # @return [Array<String>] argv
+    def spawn_argv(cmd)
+      return cmd.map(&:to_s) if cmd.is_a?(Array)
+
+      argv = cmd.split
+      raise ArgumentError, 'Empty command' if argv.empty?
+      return ['/bin/sh', '-c', cmd] if cmd =~ SPAWN_SHELL_CHARS || SPAWN_SHELL_WORDS.include?(argv.first)
+
+      argv
+    end
+
+    # Returns the environment for a spawned process.
+    #
+    # @param env [Hash, nil] environment variables to set or unset
+    # @return [Array<String>, nil] environment
+    def spawn_env(env)
+      return nil unless env
+
+      merged = ENV.to_h
+      env.each do |k, v|
+        if v.nil?
+          merged.delete(k.to_s)
+        else
+          merged[k.to_s] = v.to_s
+        end
+      end
+      merged.map { |k, v| "#{k}=#{v}" }
+    end
+
+    # Returns the fd for the given stdio option.
+    #
+    # @param io [any] stdio option
+    # @param write [bool] whether the fd is written to by the child
+    # @return [Integer, nil] fd
+    def spawn_fd(io, write)
+      case io
+      when nil then nil
+      when Integer then io
+      when Pipe then io.fds[write ? 1 : 0]
+      when ::IO then io.fileno
+      else raise ArgumentError, "Invalid stdio option #{io.inspect}"
+      end
+    end
+  end
+end
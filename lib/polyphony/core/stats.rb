@@ -0,0 +1,206 @@
+# frozen_string_literal: true
+
+module Polyphony
+
+  # Aggregates runtime statistics across all threads, and renders them in the
+  # OpenMetrics text format.
+  module Stats
+    # Backend stats entries summed across all threads.
+    TOTAL_KEYS = %i[
+      op_count switch_count poll_count pending_ops runqueue_length
+      bytes_read bytes_written stall_count
+    ].freeze
+
+    # Content type for the OpenMetrics text format.
+    CONTENT_TYPE = 'application/openmetrics-text; version=1.0.0; charset=utf-8'
+
+    class << self
+      # Returns stats for all threads with a Polyphony backend, totals summed
+      # across all threads, and thread pool, timer and queue statistics. All
+      # counters are cumulative, so stats can be sampled by any number of
+      # readers without interfering with each other.
+      #
+      # @return [Hash] aggregated stats
+      def collect
+        threads = {}
+        Thread.list.each do |thread|
+          backend = thread.backend
+          next unless backend
+
+          threads[thread_label(thread)] = backend.stats
+        end
+
+        {
+          threads: threads,
+          totals: totals(threads.values),
+          thread_pool: Polyphony::ThreadPool.stats,
+          timers: Polyphony::Timer.stats,
+          queues: Polyphony::Queue.stats
+        }
+      end
+
+      # Renders the given stats (or freshly collected stats) in the OpenMetrics
+      # text format. Durations are given in seconds.
+      #
+      # @param stats [Hash, nil] stats as returned by `Polyphony.stats`
+      # @return [String] OpenMetrics text
+      def openmetrics(stats = collect)
+        families = {}
+        stats[:threads].each { |label, s| add_thread_metrics(families, label, s) }
+        add_global_metrics(families, stats)
+
+        buf = +''
+        families.each do |name, (type, help, samples)|
+          buf << "# TYPE #{name} #{type}\n"
+          buf << "# HELP #{name} #{help}\n"
+          samples.each { |sample| buf << sample << "\n" }
+        end
+        buf << "# EOF\n"
+      end
+
+      # Spins up a fiber serving metrics in the OpenMetrics text format over
+      # HTTP on the given port.
+      #
+      # @param port [Integer] port to listen on
+      # @param host [String] host to bind to
+      # @return [Fiber] server fiber
+      def serve(port, host = '127.0.0.1')
+        server = TCPServer.new(host, port)
+        spin(:polyphony_stats_server) do
+          server.accept_loop { |conn| spin { handle_request(conn) } }
+        ensure
+          server.close
+        end
+      end
+
+      private
+
+      # @param thread [Thread] thread
+      # @return [String] thread label
+      def thread_label(thread)
+        return 'main' if thread == Thread.main
+
+        thread.name || "thread-#{thread.object_id}"
+      end
+
+      # @param thread_stats [Array<Hash>] per-thread backend stats
+      # @return [Hash] totals
+      def totals(thread_stats)
+        TOTAL_KEYS.each_with_object({}) do |key, totals|
+          totals[key] = thread_stats.sum { |s| s[key] || 0 }
+        end
+      end
+
+      # @!visibility private
+      def add_thread_metrics(families, label, stats)
+        labels = { thread: label }
+        add(families, 'polyphony_ops', :counter, 'Backend operations', labels, stats[:op_count])
+        add(families, 'polyphony_switches', :counter, 'Fiber switches', labels, stats[:switch_count])
+        add(families, 'polyphony_polls', :counter, 'Backend polls', labels, stats[:poll_count])
+        add(families, 'polyphony_read_bytes', :counter, 'Bytes read', labels, stats[:bytes_read])
+        add(families, 'polyphony_written_bytes', :counter, 'Bytes written', labels, stats[:bytes_written])
+        add(families, 'polyphony_stalls', :counter, 'Detected stalls', labels, stats[:stall_count])
+        add(families, 'polyphony_pending_ops', :gauge, 'Pending backend operations', labels, stats[:pending_ops])
+        add(families, 'polyphony_runqueue_length', :gauge, 'Runqueue length', labels, stats[:runqueue_length])
+        add(families, 'polyphony_runqueue_max_length', :gauge, 'Runqueue high watermark', labels, stats[:runqueue_max_length])
+
+        stats[:errors]&.each do |errno, count|
+          add(families, 'polyphony_errors', :counter, 'Operation errors', labels.merge(errno: errno_name(errno)), count)
+        end
+        stats[:ops]&.each do |op, op_stats|
+          op_labels = labels.merge(op: op)
+          add(families, 'polyphony_op_errors', :counter, 'Operation errors by op', op_labels, op_stats[:errors])
+          add(families, 'polyphony_op_cancelled', :counter, 'Cancelled operations by op', op_labels, op_stats[:cancelled])
+          add(families, 'polyphony_op_bytes', :counter, 'Bytes transferred by op', op_labels, op_stats[:bytes]) if op_stats[:bytes]
+          add_summary(families, 'polyphony_op_latency_seconds', 'Operation latency', op_labels, op_stats[:latency])
+        end
+        return unless (delay = stats[:schedule_delay]) && delay[:count] > 0
+
+        add_summary(families, 'polyphony_schedule_delay_seconds', 'Fiber schedule-to-run delay', labels, delay)
+      end
+
+      # @!visibility private
+      def add_global_metrics(families, stats)
+        pool = stats[:thread_pool]
+        add(families, 'polyphony_thread_pool_threads', :gauge, 'Thread pool worker threads', {}, pool[:threads])
+        add(families, 'polyphony_thread_pool_queued', :gauge, 'Thread pool queued tasks', {}, pool[:queued])
+        add(families, 'polyphony_thread_pool_processed', :counter, 'Thread pool processed tasks', {}, pool[:processed])
+        add(families, 'polyphony_timers', :gauge, 'Running timers', {}, stats[:timers][:count])
+        add(families, 'polyphony_timer_timeouts', :gauge, 'Pending timer timeouts', {}, stats[:timers][:timeouts])
+        queues = stats[:queues]
+        add(families, 'polyphony_queues', :gauge, 'Live queues', {}, queues[:count])
+        add(families, 'polyphony_queue_pushed', :counter, 'Values pushed to queues', {}, queues[:pushed])
+        add(families, 'polyphony_queue_shifted', :counter, 'Values shifted from queues', {}, queues[:shifted])
+      end
+
+      # @!visibility private
+      def add(families, name, type, help, labels, value)
+        family = (families[name] ||= [type, help, []])
+        suffix = type == :counter ? '_total' : ''
+        family[2] << "#{name}#{suffix}#{format_labels(labels)} #{value || 0}"
+      end
+
+      # Adds a summary from a histogram hash, converting nanoseconds to
+      # seconds.
+      #
+      # @!visibility private
+      def add_summary(families, name, help, labels, histogram)
+        family = (families[name] ||= [:summary, help, []])
+        samples = family[2]
+        { '0.5' => :p50, '0.9' => :p90, '0.99' => :p99, '0.999' => :p999 }.each do |quantile, key|
+          samples << "#{name}#{format_labels(labels.merge(quantile: quantile))} #{histogram[key] / 1e9}"
+        end
+        samples << "#{name}_sum#{format_labels(labels)} #{histogram[:sum] / 1e9}"
+        samples << "#{name}_count#{format_labels(labels)} #{histogram[:count]}"
+      end
+
+      # @!visibility private
+      def format_labels(labels)
+        return '' if labels.empty?
+
+        pairs = labels.map do |k, v|
+          escaped = v.to_s.gsub(/[\\"\n]/, '\\' => '\\\\', '"' => '\\"', "\n" => '\\n')
+          "#{k}=\"#{escaped}\""
+        end
+        "{#{pairs.join(',')}}"
+      end
+
+      # @!visibility private
+      def errno_name(errno)
+        SystemCallError.new(nil, errno).class.name.sub('Errno::', '')
+      end
+
+      # @!visibility private
+      def handle_request(conn)
+        request_line = conn.gets
+        return unless request_line
+
+        while (line = conn.gets)
+          break if line.chomp.empty?
+        end
+
+        if request_line.start_with?('GET ')
+          body = openmetrics
+          conn << "HTTP/1.1 200 OK\r\nContent-Type: #{CONTENT_TYPE}\r\n" \
+                  "Content-Length: #{body.bytesize}\r\nConnection: close\r\n\r\n#{body}"
+        else
+          conn << "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+        end
+      rescue SystemCallError, IOError
+        # ignore disconnected clients
+      ensure
+        conn.close
+      end
+    end
+  end
+
+  class << self
+    # Returns aggregated stats for all threads, thread pools, timers and
+    # queues. See `Polyphony::Stats.collect`.
+    #
+    # @return [Hash] aggregated stats
+    def stats
+      Stats.collect
+    end
+  end
+end
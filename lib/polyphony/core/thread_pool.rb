@@ -18,6 +18,36 @@ module Polyphony
       @default_pool.process(&block)
     end
 
+    # Returns statistics for all running thread pools: the number of pools,
+    # the total number of worker threads, the number of queued tasks and the
+    # cumulative number of processed tasks.
+    #
+    # @return [Hash] thread pool statistics
+    def self.stats
+      pools = registry.keys.select { |pool| registry[pool] }
+      {
+        pools: pools.size,
+        threads: pools.sum(&:size),
+        queued: pools.sum(&:queued_count),
+        processed: @processed_count + pools.sum(&:processed_count)
+      }
+    end
+
+    # @!visibility private
+    def self.registry
+      @registry ||= ObjectSpace::WeakMap.new
+    end
+
+    # @!visibility private
+    def self.unregister(pool)
+      return unless registry[pool]
+
+      @processed_count += pool.processed_count
+      registry[pool] = false
+    end
+
+    @processed_count = 0
+
     # Resets the default thread pool.
     #
     # @return [nil]
@@ -35,7 +65,19 @@ module Polyphony
     def initialize(size = Etc.nprocessors)
       @size = size
       @task_queue = Polyphony::Queue.new
+      @processed_count = 0
       @threads = (1..@size).map { Thread.new { thread_loop } }
+      ThreadPool.registry[self] = true
+    end
+
+    # @!visibility private
+    attr_reader :processed_count
+
+    # Returns the number of tasks waiting for a thread to become available.
+    #
+    # @return [Integer] number of queued tasks
+    def queued_count
+      @task_queue.size
     end
 
     # Runs the given block on an available thread from the pool.
@@ -73,6 +115,7 @@ module Polyphony
     def stop
       @threads.each(&:kill)
       @threads.each(&:join)
+      ThreadPool.unregister(self)
     end
 
     private
@@ -87,6 +130,7 @@ module Polyphony
     # Runs the first queued task in the task queue.
     def run_queued_task
       (block, watcher) = @task_queue.shift
+      @processed_count += 1
       result = block.()
       watcher&.signal(result)
     rescue Exception => e
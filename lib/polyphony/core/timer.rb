@@ -8,6 +8,23 @@ module Polyphony
   # methods concerned with timeouts, such as `#cancel_after`, `#every` etc.
   class Timer
 
+    # Returns statistics for all running timers: the number of timers and the
+    # number of currently pending timeouts.
+    #
+    # @return [Hash] timer statistics
+    def self.stats
+      timers = registry.keys.select { |timer| registry[timer] }
+      {
+        count: timers.size,
+        timeouts: timers.sum(&:timeout_count)
+      }
+    end
+
+    # @!visibility private
+    def self.registry
+      @registry ||= ObjectSpace::WeakMap.new
+    end
+
     # Initializes a new timer with the given resolution.
     #
     # @param tag [any] tag to use for the timer's fiber
@@ -15,6 +32,14 @@ module Polyphony
     def initialize(tag = nil, resolution:)
       @fiber = spin_loop(tag, interval: resolution) { update }
       @timeouts = {}
+      Timer.registry[self] = true
+    end
+
+    # Returns the number of currently pending timeouts.
+    #
+    # @return [Integer] number of pending timeouts
+    def timeout_count
+      @timeouts.size
     end
 
     # Stops the timer's associated fiber.
@@ -22,6 +47,7 @@ module Polyphony
     # @return [Polyphony::Timer] self
     def stop
       @fiber.stop
+      Timer.registry[self] = false
       self
     end
 
@@ -98,6 +98,61 @@ class ::IO
       Polyphony.backend_splice(src, dest, maxlen)
     end
 
+    # Sends data from the given file to the given destination, starting at the
+    # given offset. If a length is given, up to `length` bytes are sent,
+    # otherwise data is sent until EOF is encountered. The file position of the
+    # source file is not changed. On Linux, data is transferred without being
+    # copied to userspace.
+    #
+    # @param src [File, Tempfile] source file
+    # @param dest [IO, Socket] destination to send to
+    # @param offset [Integer] offset in source file
+    # @param length [Integer, nil] number of bytes to send
+    # @return [Integer] total bytes sent
+    def send_file(src, dest, offset: 0, length: nil)
+      Polyphony.backend_send_file(src.to_io, dest, offset, length)
+    end
+
+    # Sends multiple ranges from the given file to the given destination, e.g.
+    # for responding to HTTP range requests. Each range is either a `Range` of
+    # byte offsets, or an `[offset, length]` pair. An endless range is sent up
+    # to the end of the file. If a block is given, it is
+    # called with the offset and length of each range before the range is sent,
+    # allowing the caller to write any part headers (as in a
+    # `multipart/byteranges` response).
+    #
+    # @param src [File, Tempfile] source file
+    # @param dest [IO, Socket] destination to send to
+    # @param ranges [Array<Range, Array>] ranges to send
+    # @yield [Integer, Integer] range offset and length
+    # @return [Integer] total bytes sent from the source file
+    def send_file_ranges(src, dest, ranges)
+      src = src.to_io
+      ranges.inject(0) do |total, range|
+        offset, length = range.is_a?(Range) ? file_range_bounds(src, range) : range
+        yield offset, length if block_given?
+        total + Polyphony.backend_send_file(src, dest, offset, length)
+      end
+    end
+
+    # @!visibility private
+    #
+    # Converts the given range of byte offsets into an offset and length.
+    # Endless ranges extend to the end of the given file.
+    #
+    # @param src [File] source file
+    # @param range [Range] range of byte offsets
+    # @return [Array<Integer>] offset and length
+    def file_range_bounds(src, range)
+      offset = range.begin
+      unless offset.is_a?(Integer) && (range.end.nil? || range.end.is_a?(Integer))
+        raise ArgumentError, "invalid file range: #{range.inspect}"
+      end
+      return [offset, [src.size - offset, 0].max] if range.end.nil?
+
+      [offset, range.size]
+    end
+
     if RUBY_PLATFORM =~ /linux/
       # Creates a pipe and splices data between the two given IOs using the
       # pipe, splicing until EOF.
@@ -350,14 +405,69 @@ class ::IO
     buf ? readpartial(maxlen, buf) : readpartial(maxlen)
   end
 
+  # Reads from the IO into the given buffers using a single vectored read.
+  # String buffers are filled starting at their current length up to their
+  # capacity, so they should be allocated using `String.new(capacity: n)`.
+  # IO::Buffer instances are filled from their start.
+  #
+  # @param buffers [Array<String, IO::Buffer>] buffers to read into
+  # @return [Integer, nil] total bytes read, or nil on EOF
+  def readv(*buffers)
+    Polyphony.backend_readv(self, buffers, nil)
+  end
+
+  # Reads until EOF, returning the read data as a list of segments of
+  # `segment_size` bytes each (except for the last one). Unlike `#read`, which
+  # repeatedly grows a single buffer (copying its content on each
+  # reallocation), segments are allocated once and filled in place,
+  # `batch_size` segments per vectored read.
+  #
+  # @param segment_size [Integer] segment size
+  # @param batch_size [Integer] number of segments to read into at once
+  # @return [Array<String>] read segments
+  def read_segments(segment_size = 65536, batch_size = 4)
+    segments = []
+    # buffers left empty by a short read are kept for the next read
+    spare = []
+    while true
+      last = segments.last
+      buffers = last && last.bytesize < segment_size ? [last] : []
+      while buffers.size + spare.size < batch_size
+        # the requested capacity includes the terminating NUL byte
+        spare << String.new(capacity: segment_size + 1, encoding: Encoding::BINARY)
+      end
+      # Ruby may round up the capacity, so segments are capped at segment_size
+      break unless Polyphony.backend_readv(self, buffers.concat(spare), segment_size)
+
+      # buffers are filled in order, so the filled ones come first
+      segments.concat(spare.shift(spare.index(&:empty?) || spare.size))
+    end
+    segments
+  end
+
   # Reads up to `maxlen` bytes at a time in an infinite loop. Read data
   # will be passed to the given block.
   #
-  # @param maxlen [Integer] maximum bytes to receive
-  # @yield [String] read data
+  # If an IO::Buffer is given instead of `maxlen`, data is read into the buffer
+  # and a slice of the buffer is yielded for each chunk, without allocating a
+  # new string. The slice is only valid until the block returns.
+  #
+  # If `reuse_buffer` is true, each chunk is read into the same string, which
+  # is yielded to the block, saving an allocation per chunk. The string's
+  # content is only valid until the block returns, so this should only be used
+  # when the block does not retain the string (copies of it, e.g. made using
+  # String#dup, remain valid). In order to detect blocks that retain the
+  # string, set `Polyphony.poison_reused_buffers = true` (or set the
+  # `POLYPHONY_POISON_REUSED_BUFFERS` environment variable), which causes each
+  # chunk to be overwritten with poison bytes and frozen once the block
+  # returns.
+  #
+  # @param maxlen [Integer, IO::Buffer] maximum bytes to receive, or buffer
+  # @param reuse_buffer [bool] whether to read each chunk into the same string
+  # @yield [String, IO::Buffer] read data
   # @return [IO] self
-  def read_loop(maxlen = 8192, &block)
-    Polyphony.backend_read_loop(self, maxlen, &block)
+  def read_loop(maxlen = 8192, reuse_buffer: false, &block)
+    Polyphony.backend_read_loop(self, maxlen, reuse_buffer, &block)
   end
 
   # Receives data from the io in an infinite loop, passing the data to the given
@@ -376,9 +486,17 @@ class ::IO
   #
   # @param receiver [any] receiver object
   # @param method [Symbol] method to call
+  # @param buffer [IO::Buffer, nil] buffer to read into (see #read_loop)
+  # @param reuse_buffer [bool] whether to read each chunk into the same string
+  #   (see #read_loop)
   # @return [IO] self
-  def feed_loop(receiver, method = :call, &block)
-    Polyphony.backend_feed_loop(self, receiver, method, &block)
+  def feed_loop(receiver, method = :call, buffer: nil, reuse_buffer: false, &block)
+    return Polyphony.backend_feed_loop(self, receiver, method, &block) unless buffer || reuse_buffer
+
+    read_loop(buffer || 8192, reuse_buffer: reuse_buffer) do |data|
+      receiver.__send__(method, data, &block)
+    end
+    self
   end
 
   # Waits for the IO to become readable, with an optional timeout.
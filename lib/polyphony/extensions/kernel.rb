@@ -12,12 +12,15 @@ module ::Kernel
 
   # @!visibility private
   def `(cmd)
-    Open3.popen3(cmd) do |i, o, e, _t|
-      i.close
-      err = e.read
-      $stderr << err if err
-      o.read || ''
-    end
+    child = Polyphony.spawn(cmd, stdout: :pipe, stderr: :pipe)
+    err_reader = spin { child.stderr.read }
+    out = child.stdout.read
+    err = err_reader.await
+    $stderr << err if err
+    out || ''
+  ensure
+    child&.close
+    child&.wait
   end
 
   # @!visibility private
@@ -77,6 +80,23 @@ module ::Kernel
 
     # @!visibility private
     def system(*args)
+      return system_open3(*args) if args.last.is_a?(Hash)
+
+      env = args.shift if args.first.is_a?(Hash)
+      child = Polyphony.spawn(args.size == 1 ? args.first : args, env: env, stdout: :pipe)
+      pipe_to_eof(child.stdout, $stdout)
+      child.wait == 0
+    rescue SystemCallError
+      nil
+    ensure
+      child&.close
+    end
+
+    private
+
+    # Runs the given command using Open3, for commands given with spawn
+    # options, which are not supported by `Polyphony.spawn`.
+    def system_open3(*args)
       waiter = nil
       Open3.popen2(*args) do |i, o, t|
         waiter = t
@@ -94,10 +114,18 @@ module ::Kernel
 
   # @!visibility private
   def trap(sig, command = nil, &block)
-    return orig_trap(sig, command) if command.is_a? String
-
+    signo = signalfd_signo(sig)
     block = command if !block && command.respond_to?(:call)
 
+    # With signalfd delivery enabled (see `Polyphony.signalfd=`), the signal is
+    # read by the backend when polling, and its handler is scheduled directly
+    # in an out-of-band fiber, without going through Ruby's signal handling.
+    return Thread.current.backend.signalfd_trap(signo, block) if signo && block && Polyphony.signalfd?
+
+    # Otherwise, any previous signalfd trap is removed
+    Thread.current.backend.signalfd_trap(signo, nil) if signo
+    return orig_trap(sig, command) if command.is_a? String
+
     # The signal trap can be invoked at any time, including while the system
     # backend is blocking while polling for events. In order to deal with this
     # correctly, we run the signal handler code in an out-of-band, priority
@@ -111,6 +139,18 @@ module ::Kernel
 
   private
 
+  # Returns the signal number for the given signal if it can be trapped using
+  # the backend's signalfd, which is done only on the main thread.
+  #
+  # @param sig [String, Symbol, Integer] signal
+  # @return [Integer, nil] signal number
+  def signalfd_signo(sig)
+    return nil unless Thread.current == Thread.main
+
+    signo = sig.is_a?(Integer) ? sig : Signal.list[sig.to_s.delete_prefix('SIG')]
+    signo&.positive? ? signo : nil
+  end
+
   # @!visibility private
   def pipe_to_eof(src, dest)
     src.read_loop { |data| dest << data }
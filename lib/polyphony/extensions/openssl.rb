@@ -3,13 +3,60 @@
 require 'openssl'
 require_relative './socket'
 
+# OpenSSL context extensions
+class ::OpenSSL::SSL::SSLContext
+  # Enables or disables kernel TLS (kTLS) offload for connections using this
+  # context. When enabled, and if supported by both OpenSSL and the kernel, the
+  # negotiated keys are installed into the kernel after the handshake, and
+  # record encryption is done by the kernel. This in turn allows writing,
+  # splicing and sending files to the connection using plain fd operations.
+  #
+  # @param enabled [boolean] whether to enable kTLS
+  # @return [boolean] enabled
+  def ktls=(enabled)
+    return unless defined?(OpenSSL::SSL::OP_ENABLE_KTLS)
+
+    if enabled
+      self.options |= OpenSSL::SSL::OP_ENABLE_KTLS
+    else
+      self.options &= ~OpenSSL::SSL::OP_ENABLE_KTLS
+    end
+  end
+
+  # Returns true if kTLS offload is enabled for this context.
+  #
+  # @return [boolean]
+  def ktls?
+    defined?(OpenSSL::SSL::OP_ENABLE_KTLS) &&
+      (options & OpenSSL::SSL::OP_ENABLE_KTLS) != 0
+  end
+end
+
 # OpenSSL socket helper methods (to make it compatible with Socket API) and overrides
 class ::OpenSSL::SSL::SSLSocket
+  # @!visibility private
+  SOL_TLS = 282
+  # @!visibility private
+  TLS_TX = 1
+  # @!visibility private
+  TLS_RX = 2
+  # @!visibility private
+  READ_BUFFER_POISON = "\xDB".b.freeze
+
   # @!visibility private
   def __read_method__
     :readpartial
   end
 
+  # Returns `:backend_send` if kTLS transmit offload is active, in which case
+  # plaintext can be written directly to the underlying socket. Otherwise
+  # returns `:readpartial`, which indicates `#write` should be used.
+  #
+  # @return [Symbol] write method
+  def __write_method__
+    ktls_send? ? :backend_send : :readpartial
+  end
+
   # @!visibility private
   alias_method :orig_initialize, :initialize
 
@@ -37,6 +84,120 @@ class ::OpenSSL::SSL::SSLSocket
     io.reuse_addr
   end
 
+  # @!visibility private
+  alias_method :orig_accept, :accept
+
+  # Performs the server-side TLS handshake.
+  #
+  # @return [OpenSSL::SSL::SSLSocket] self
+  def accept
+    orig_accept
+    __detect_ktls__
+    self
+  end
+
+  # @!visibility private
+  alias_method :orig_connect, :connect
+
+  # Performs the client-side TLS handshake.
+  #
+  # @return [OpenSSL::SSL::SSLSocket] self
+  def connect
+    orig_connect
+    __detect_ktls__
+    self
+  end
+
+  # Performs the TLS handshake on the given thread pool, using non-blocking I/O
+  # on the worker thread. The calling fiber is suspended until the handshake is
+  # complete. This prevents a burst of new connections from stalling the
+  # calling thread's event loop.
+  #
+  # @param pool [Polyphony::ThreadPool] thread pool
+  # @param mode [:accept, :connect] handshake mode
+  # @return [OpenSSL::SSL::SSLSocket] self
+  def handshake_on(pool, mode)
+    method = mode == :accept ? :accept_nonblock : :connect_nonblock
+    pool.process do
+      # fibers cannot be switched inside of the servername_cb proc (see
+      # https://github.com/ruby/openssl/issues/415)
+      next accept if mode == :accept && context.servername_cb
+
+      while true
+        case (result = send(method, exception: false))
+        when :wait_readable then Polyphony.backend_wait_io(io, false)
+        when :wait_writable then Polyphony.backend_wait_io(io, true)
+        else break result
+        end
+      end
+    end
+    __detect_ktls__
+    self
+  end
+
+  # Returns true if the kernel is performing TLS record encryption for data
+  # sent on this connection (kTLS transmit offload).
+  #
+  # @return [boolean]
+  def ktls_send?
+    !!@ktls_send
+  end
+
+  # Returns true if the kernel is performing TLS record decryption for data
+  # received on this connection (kTLS receive offload).
+  #
+  # @return [boolean]
+  def ktls_recv?
+    !!@ktls_recv
+  end
+
+  # Splices data from the given source to the connection. If kTLS transmit
+  # offload is active, data is spliced directly to the underlying socket,
+  # otherwise it is read from the source and written through OpenSSL.
+  #
+  # @param src [IO, Polyphony::Pipe] source to splice from
+  # @param maxlen [Integer] maximum bytes to splice
+  # @return [Integer] bytes spliced
+  def splice_from(src, maxlen)
+    return Polyphony.backend_splice(src, io, maxlen) if ktls_send?
+
+    data = Polyphony.backend_read(src, +'', maxlen, false, 0)
+    return 0 unless data
+
+    write(data)
+  end
+
+  # @!visibility private
+  def __detect_ktls__
+    return unless context.ktls?
+
+    @ktls_send = __ktls_configured__(TLS_TX)
+    @ktls_recv = __ktls_configured__(TLS_RX)
+  end
+
+  # @!visibility private
+  def __ktls_configured__(direction)
+    io.getsockopt(SOL_TLS, direction)
+    true
+  rescue SystemCallError
+    false
+  end
+
+  # @!visibility private
+  #
+  # Prepares a read loop's reused buffer for reading the next chunk, in the
+  # same manner as IO#read_loop: a new buffer is allocated if the consumer has
+  # frozen the buffer, and if `Polyphony.poison_reused_buffers` is set, the
+  # previous chunk is overwritten with poison bytes and frozen.
+  def __reuse_read_buffer__(buf)
+    if Polyphony.poison_reused_buffers?
+      buf.replace(READ_BUFFER_POISON * buf.bytesize).freeze unless buf.frozen?
+      return +''
+    end
+
+    buf.frozen? ? +'' : buf
+  end
+
   # @!visibility private
   def fill_rbuff
     data = self.sysread(BLOCK_SIZE)
@@ -54,11 +215,22 @@ class ::OpenSSL::SSL::SSLSocket
   def sysread(maxlen, buf = +'')
     # ensure socket is non blocking
     Polyphony.backend_verify_blocking_mode(io, false)
+
+    # If the previous read had to wait for the socket and did not fill the
+    # buffer (as is typical for request-response traffic), wait for the socket
+    # to become readable before reading, instead of making a read attempt that
+    # is bound to fail.
+    waited = @read_would_block && pending == 0
+    Polyphony.backend_wait_io(io, false) if waited
     while true
       case (result = sysread_nonblock(maxlen, buf, exception: false))
-      when :wait_readable then Polyphony.backend_wait_io(io, false)
+      when :wait_readable
+        waited = true
+        Polyphony.backend_wait_io(io, false)
       when :wait_writable then Polyphony.backend_wait_io(io, true)
-      else return result
+      else
+        @read_would_block = waited && result && result.bytesize < maxlen
+        return result
       end
     end
   end
@@ -68,6 +240,9 @@ class ::OpenSSL::SSL::SSLSocket
 
   # @!visibility private
   def syswrite(buf)
+    # with kTLS transmit offload, plaintext is written directly to the socket
+    return Polyphony.backend_send(io, buf, 0) if @ktls_send
+
     # ensure socket is non blocking
     Polyphony.backend_verify_blocking_mode(io, false)
     while true
@@ -135,11 +310,9 @@ class ::OpenSSL::SSL::SSLSocket
   def readpartial(maxlen, buf = +'', buf_pos = 0, raise_on_eof = true)
     if buf_pos != 0
       if (result = sysread(maxlen, +''))
-        if buf_pos == -1
-          result = buf + result
-        else
-          result = buf[0...buf_pos] + result
-        end
+        buf_pos = buf.bytesize if buf_pos == -1 || buf_pos > buf.bytesize
+        buf.replace(buf.byteslice(0, buf_pos)) if buf_pos < buf.bytesize
+        result = buf << result
       end
     else
       result = sysread(maxlen, buf)
@@ -152,13 +325,31 @@ class ::OpenSSL::SSL::SSLSocket
   # Receives up to `maxlen` bytes at a time in an infinite loop. Read buffers
   # will be passed to the given block.
   #
-  # @param maxlen [Integer] maximum bytes to receive
-  # @yield [String] read data
+  # Since decrypted data is produced by OpenSSL, reading into an IO::Buffer
+  # involves copying each chunk into the buffer.
+  #
+  # @param maxlen [Integer, IO::Buffer] maximum bytes to receive, or buffer to
+  #   read into (see IO#read_loop)
+  # @param reuse_buffer [bool] whether to read each chunk into the same string
+  #   (see IO#read_loop)
+  # @yield [String, IO::Buffer] read data
   # @return [OpenSSL::SSL::SSLSocket] self
-  def read_loop(maxlen = 8192)
-    while (data = sysread(maxlen))
-      yield data
+  def read_loop(maxlen = 8192, reuse_buffer: false)
+    if maxlen.is_a?(Integer)
+      buf = reuse_buffer ? +'' : nil
+      while (data = sysread(maxlen, buf))
+        yield data
+        buf = __reuse_read_buffer__(buf) if reuse_buffer
+      end
+    else
+      buffer = maxlen
+      data = +''
+      while sysread(buffer.size, data)
+        buffer.set_string(data)
+        yield buffer.slice(0, data.bytesize)
+      end
     end
+    self
   end
   alias_method :recv_loop, :read_loop
 
@@ -175,6 +366,21 @@ end
 class ::OpenSSL::SSL::SSLServer
   attr_reader :ctx
 
+  # Thread pool used for performing TLS handshakes on accepted connections
+  attr_reader :handshake_pool
+
+  # Sets the thread pool used for performing TLS handshakes on accepted
+  # connections. When set, handshakes are performed on the pool's threads
+  # instead of on the accepting thread. If an integer is given, a new pool of
+  # the given size is created.
+  #
+  # @param pool [Polyphony::ThreadPool, Integer, nil] thread pool or pool size
+  # @return [Polyphony::ThreadPool, nil] thread pool
+  def handshake_pool=(pool)
+    @own_handshake_pool = pool.is_a?(Integer)
+    @handshake_pool = @own_handshake_pool ? Polyphony::ThreadPool.new(pool) : pool
+  end
+
   # @!visibility private
   alias_method :orig_accept, :accept
 
@@ -189,7 +395,7 @@ class ::OpenSSL::SSL::SSLServer
     # - We don't want to stop the world while we're busy provisioning an ACME
     #   certificate
     if @use_accept_worker.nil?
-      if (@use_accept_worker = use_accept_worker_thread?)
+      if (@use_accept_worker = !@handshake_pool && use_accept_worker_thread?)
         start_accept_worker_thread
       end
     end
@@ -197,11 +403,18 @@ class ::OpenSSL::SSL::SSLServer
     # STDOUT.puts 'SSLServer#accept'
     sock, = @svr.accept
     # STDOUT.puts "- raw sock: #{sock.inspect}"
+    secure_accepted_socket(sock)
+  end
+
+  # @!visibility private
+  def secure_accepted_socket(sock)
     begin
       ssl = OpenSSL::SSL::SSLSocket.new(sock, @ctx)
       # STDOUT.puts "- ssl sock: #{ssl.inspect}"
       ssl.sync_close = true
-      if @use_accept_worker
+      if @handshake_pool
+        ssl.handshake_on(@handshake_pool, :accept)
+      elsif @use_accept_worker
         # STDOUT.puts "- send to accept worker"
         @accept_worker_fiber << [ssl, Fiber.current]
         # STDOUT.puts "- wait for accept worker"
@@ -257,6 +470,7 @@ class ::OpenSSL::SSL::SSLServer
   # @!visibility private
   def close
     @accept_worker_thread&.kill
+    @handshake_pool&.stop if @own_handshake_pool
     orig_close
   end
 
@@ -265,11 +479,44 @@ class ::OpenSSL::SSL::SSLServer
   # @param ignore_errors [boolean] whether to ignore IO and SSL errors
   # @yield [OpenSSL::SSL::SSLSocket] accepted socket
   # @return [OpenSSL::SSL::SSLServer] self
-  def accept_loop(ignore_errors = true)
+  def accept_loop(ignore_errors = true, &block)
+    return concurrent_accept_loop(ignore_errors, &block) if @handshake_pool
+
     loop do
       yield accept
     rescue OpenSSL::SSL::SSLError, SystemCallError => e
       raise e unless ignore_errors
     end
   end
+
+  private
+
+  # Accepts incoming connections in an infinite loop, performing the TLS
+  # handshake for each connection on a separate fiber, so a slow handshake does
+  # not hold up accepting further connections. Established connections are
+  # passed back to the calling fiber, which yields them in order of completion.
+  def concurrent_accept_loop(ignore_errors)
+    queue = Polyphony::Queue.new
+    acceptor = spin do
+      loop do
+        sock, = @svr.accept
+        spin do
+          queue << secure_accepted_socket(sock)
+        rescue OpenSSL::SSL::SSLError, SystemCallError => e
+          queue << e unless ignore_errors
+        end
+      rescue SystemCallError => e
+        queue << e unless ignore_errors
+      end
+    end
+
+    loop do
+      item = queue.shift
+      raise item if item.is_a?(Exception)
+
+      yield item
+    end
+  ensure
+    acceptor&.stop
+  end
 end
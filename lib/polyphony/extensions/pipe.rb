@@ -176,11 +176,14 @@ class Polyphony::Pipe
 
   # Runs a read loop.
   #
-  # @param maxlen [Integer] maximum bytes to read
-  # @yield [String] read data
+  # @param maxlen [Integer, IO::Buffer] maximum bytes to read, or buffer to
+  #   read into (see IO#read_loop)
+  # @param reuse_buffer [bool] whether to read each chunk into the same string
+  #   (see IO#read_loop)
+  # @yield [String, IO::Buffer] read data
   # @return [Polyphony::Pipe] self
-  def read_loop(maxlen = 8192, &block)
-    Polyphony.backend_read_loop(self, maxlen, &block)
+  def read_loop(maxlen = 8192, reuse_buffer: false, &block)
+    Polyphony.backend_read_loop(self, maxlen, reuse_buffer, &block)
   end
 
   # Receives data from the pipe in an infinite loop, passing the data to the
@@ -199,9 +202,17 @@ class Polyphony::Pipe
   #
   # @param receiver [any] receiver object
   # @param method [Symbol] method to call
+  # @param buffer [IO::Buffer, nil] buffer to read into (see #read_loop)
+  # @param reuse_buffer [bool] whether to read each chunk into the same string
+  #   (see #read_loop)
   # @return [Polyphony::Pipe] self
-  def feed_loop(receiver, method = :call, &block)
-    Polyphony.backend_feed_loop(self, receiver, method, &block)
+  def feed_loop(receiver, method = :call, buffer: nil, reuse_buffer: false, &block)
+    return Polyphony.backend_feed_loop(self, receiver, method, &block) unless buffer || reuse_buffer
+
+    read_loop(buffer || 8192, reuse_buffer: reuse_buffer) do |data|
+      receiver.__send__(method, data, &block)
+    end
+    self
   end
 
   # Waits for pipe to become readable.
@@ -107,11 +107,14 @@ class ::Socket < ::BasicSocket
   # Receives up to `maxlen` bytes at a time in an infinite loop. Read buffers
   # will be passed to the given block.
   #
-  # @param maxlen [Integer] maximum bytes to receive
-  # @yield [String] received data
+  # @param maxlen [Integer, IO::Buffer] maximum bytes to receive, or buffer to
+  #   read into (see IO#read_loop)
+  # @param reuse_buffer [bool] whether to receive each chunk into the same
+  #   string (see IO#read_loop)
+  # @yield [String, IO::Buffer] received data
   # @return [Socket] self
-  def recv_loop(maxlen = 8192, &block)
-    Polyphony.backend_recv_loop(self, maxlen, &block)
+  def recv_loop(maxlen = 8192, reuse_buffer: false, &block)
+    Polyphony.backend_recv_loop(self, maxlen, reuse_buffer, &block)
   end
   alias_method :read_loop, :recv_loop
 
@@ -131,9 +134,17 @@ class ::Socket < ::BasicSocket
   #
   # @param receiver [any] receiver object
   # @param method [Symbol] method to call
+  # @param buffer [IO::Buffer, nil] buffer to read into (see #read_loop)
+  # @param reuse_buffer [bool] whether to read each chunk into the same string
+  #   (see #read_loop)
   # @return [Socket] self
-  def feed_loop(receiver, method = :call, &block)
-    Polyphony.backend_recv_feed_loop(self, receiver, method, &block)
+  def feed_loop(receiver, method = :call, buffer: nil, reuse_buffer: false, &block)
+    return Polyphony.backend_recv_feed_loop(self, receiver, method, &block) unless buffer || reuse_buffer
+
+    recv_loop(buffer || 8192, reuse_buffer: reuse_buffer) do |data|
+      receiver.__send__(method, data, &block)
+    end
+    self
   end
 
   # Reimplements #recvfrom.
@@ -374,11 +385,14 @@ class ::TCPSocket < ::IPSocket
   # Receives up to `maxlen` bytes at a time in an infinite loop. Read buffers
   # will be passed to the given block.
   #
-  # @param maxlen [Integer] maximum bytes to receive
-  # @yield [String] received data
+  # @param maxlen [Integer, IO::Buffer] maximum bytes to receive, or buffer to
+  #   read into (see IO#read_loop)
+  # @param reuse_buffer [bool] whether to receive each chunk into the same
+  #   string (see IO#read_loop)
+  # @yield [String, IO::Buffer] received data
   # @return [Socket] self
-  def recv_loop(maxlen = 8192, &block)
-    Polyphony.backend_recv_loop(self, maxlen, &block)
+  def recv_loop(maxlen = 8192, reuse_buffer: false, &block)
+    Polyphony.backend_recv_loop(self, maxlen, reuse_buffer, &block)
   end
   alias_method :read_loop, :recv_loop
 
@@ -398,9 +412,17 @@ class ::TCPSocket < ::IPSocket
   #
   # @param receiver [any] receiver object
   # @param method [Symbol] method to call
+  # @param buffer [IO::Buffer, nil] buffer to read into (see #read_loop)
+  # @param reuse_buffer [bool] whether to read each chunk into the same string
+  #   (see #read_loop)
   # @return [Socket] self
-  def feed_loop(receiver, method = :call, &block)
-    Polyphony.backend_recv_feed_loop(self, receiver, method, &block)
+  def feed_loop(receiver, method = :call, buffer: nil, reuse_buffer: false, &block)
+    return Polyphony.backend_recv_feed_loop(self, receiver, method, &block) unless buffer || reuse_buffer
+
+    recv_loop(buffer || 8192, reuse_buffer: reuse_buffer) do |data|
+      receiver.__send__(method, data, &block)
+    end
+    self
   end
 
   # Reads up to `maxlen` from the socket. If `buf` is given, it is used as the
@@ -464,7 +486,7 @@ class ::TCPServer < ::TCPSocket
     @io = Socket.new addr.afamily, Socket::SOCK_STREAM
     @io.setsockopt(Socket::SOL_SOCKET, Socket::SO_REUSEADDR, 1)
     @io.bind(addr)
-    @io.listen(0)
+    @io.listen(Socket::SOMAXCONN)
   end
 
   # @!visibility private
@@ -586,11 +608,14 @@ class ::UNIXSocket < ::BasicSocket
   # Receives up to `maxlen` bytes at a time in an infinite loop. Read buffers
   # will be passed to the given block.
   #
-  # @param maxlen [Integer] maximum bytes to receive
-  # @yield [String] received data
+  # @param maxlen [Integer, IO::Buffer] maximum bytes to receive, or buffer to
+  #   read into (see IO#read_loop)
+  # @param reuse_buffer [bool] whether to receive each chunk into the same
+  #   string (see IO#read_loop)
+  # @yield [String, IO::Buffer] received data
   # @return [Socket] self
-  def recv_loop(maxlen = 8192, &block)
-    Polyphony.backend_recv_loop(self, maxlen, &block)
+  def recv_loop(maxlen = 8192, reuse_buffer: false, &block)
+    Polyphony.backend_recv_loop(self, maxlen, reuse_buffer, &block)
   end
   alias_method :read_loop, :recv_loop
 
@@ -610,9 +635,17 @@ class ::UNIXSocket < ::BasicSocket
   #
   # @param receiver [any] receiver object
   # @param method [Symbol] method to call
+  # @param buffer [IO::Buffer, nil] buffer to read into (see #read_loop)
+  # @param reuse_buffer [bool] whether to read each chunk into the same string
+  #   (see #read_loop)
   # @return [Socket] self
-  def feed_loop(receiver, method = :call, &block)
-    Polyphony.backend_recv_feed_loop(self, receiver, method, &block)
+  def feed_loop(receiver, method = :call, buffer: nil, reuse_buffer: false, &block)
+    return Polyphony.backend_recv_feed_loop(self, receiver, method, &block) unless buffer || reuse_buffer
+
+    recv_loop(buffer || 8192, reuse_buffer: reuse_buffer) do |data|
+      receiver.__send__(method, data, &block)
+    end
+    self
   end
 
   # Sends the given message on the socket.
@@ -711,7 +744,14 @@ class ::UDPSocket < ::IPSocket
   # @return [String] received data
   def recvmsg(maxlen = nil, flags = 0, maxcontrollen = nil, opts = {})
     buf = +''
-    Polyphony.backend_recvmsg(self, buf, maxlen || 4096, 0, flags, maxcontrollen, opts)
+    result = Polyphony.backend_recvmsg(self, buf, maxlen || 4096, 0, flags, maxcontrollen, opts)
+    return result unless result && result.size > 3
+
+    family = local_address.afamily
+    result[3..].each_with_index do |(level, type, data), idx|
+      result[idx + 3] = Socket::AncillaryData.new(family, level, type, data)
+    end
+    result
   end
 
   # Reimplements #sendmsg.
@@ -722,6 +762,10 @@ class ::UDPSocket < ::IPSocket
   # @param controls [Array] optional control data
   # @return [Integer] bytes sent
   def sendmsg(msg, flags = 0, dest_sockaddr = nil, *controls)
+    dest_sockaddr = dest_sockaddr.to_sockaddr if dest_sockaddr.is_a?(Addrinfo)
+    controls = controls.map do |c|
+      c.is_a?(Socket::AncillaryData) ? [c.level, c.type, c.data] : c
+    end
     Polyphony.backend_sendmsg(self, msg, flags, dest_sockaddr, controls)
   end
 
@@ -743,4 +787,122 @@ class ::UDPSocket < ::IPSocket
 
     Polyphony.backend_sendmsg(self, msg, flags, sockaddr, nil)
   end
+
+  if RUBY_PLATFORM =~ /linux/
+    # UDP_SEGMENT socket option / control message type (see udp(7))
+    UDP_SEGMENT = 103
+    # UDP_GRO socket option / control message type (see udp(7))
+    UDP_GRO = 104
+    # @!visibility private
+    GRO_CONTROL_LEN = 64
+
+    # Sends a large buffer as a series of datagrams of (at most) the given
+    # segment size, using UDP generic segmentation offload (GSO). The buffer is
+    # passed to the kernel in a single syscall and segmented as late as
+    # possible. The buffer length must not exceed 64KB, and at most 64 segments
+    # can be sent at once.
+    #
+    # @param msg [String] data to send
+    # @param segment_size [Integer] datagram payload size
+    # @param addr [Array] optional destination host and port, or sockaddr
+    # @return [Integer] bytes sent
+    def send_segmented(msg, segment_size, *addr)
+      sockaddr = case addr.size
+      when 2
+        Socket.sockaddr_in(addr[1], addr[0])
+      when 1
+        addr[0]
+      else
+        nil
+      end
+      control = [Socket::SOL_UDP, UDP_SEGMENT, [segment_size].pack('S')]
+      Polyphony.backend_sendmsg(self, msg, 0, sockaddr, [control])
+    end
+
+    # Enables or disables UDP generic receive offload (GRO). When enabled,
+    # consecutive datagrams from the same flow may be coalesced by the kernel
+    # into a single super-packet. Use `#recv_gro` or `#recv_segments` to receive
+    # such super-packets.
+    #
+    # @param enabled [boolean] whether to enable GRO
+    # @return [boolean] enabled
+    def gro=(enabled)
+      setsockopt(Socket::SOL_UDP, UDP_GRO, enabled ? 1 : 0)
+    end
+
+    # Receives a possibly coalesced GRO super-packet, returning the received
+    # data, the sender address and the segment size. For non-coalesced
+    # datagrams the segment size is equal to the data size.
+    #
+    # @param maxlen [Integer] maximum bytes to receive
+    # @param flags [Integer] optional flags
+    # @return [Array] received data, sender address and segment size
+    def recv_gro(maxlen = 65536, flags = 0)
+      buf = +''
+      result = Polyphony.backend_recvmsg(self, buf, maxlen, 0, flags, GRO_CONTROL_LEN, nil)
+      return nil unless result
+
+      data, addr, _rflags, *controls = result
+      segment_size = data.bytesize
+      controls.each do |(level, type, value)|
+        next unless level == Socket::SOL_UDP && type == UDP_GRO
+
+        segment_size = value.unpack1('i')
+      end
+      [data, addr, segment_size]
+    end
+
+    # Receives a possibly coalesced GRO super-packet, yielding each of its
+    # segments along with the sender address. Segments are split off the
+    # received buffer one at a time, as they are yielded.
+    #
+    # @param maxlen [Integer] maximum bytes to receive
+    # @param flags [Integer] optional flags
+    # @yield [String, Array] segment data and sender address
+    # @return [Integer, nil] number of segments yielded
+    def recv_segments(maxlen = 65536, flags = 0)
+      data, addr, segment_size = recv_gro(maxlen, flags)
+      return nil unless data
+
+      count = 0
+      pos = 0
+      len = data.bytesize
+      while pos < len
+        yield data.byteslice(pos, segment_size), addr
+        pos += segment_size
+        count += 1
+      end
+      count
+    end
+
+    # Receives a batch of up to `count` datagrams, waiting for at least one
+    # datagram to become available. Each received datagram is returned as a
+    # `[data, addr]` pair, with `addr` formatted as in `#recvfrom`.
+    #
+    # @param count [Integer] maximum number of datagrams to receive
+    # @param maxlen [Integer] maximum bytes to receive per datagram
+    # @param flags [Integer] optional flags
+    # @return [Array<Array>] received datagrams
+    def recv_batch(count, maxlen, flags = 0)
+      Polyphony.backend_recv_batch(self, count, maxlen, flags)
+    end
+
+    # Sends a batch of datagrams. Each datagram is either a string (for a
+    # connected socket), or a `[data, host, port]` or `[data, sockaddr]` tuple.
+    #
+    # @param datagrams [Array] datagrams to send
+    # @param flags [Integer] optional flags
+    # @return [Integer] number of datagrams sent
+    def send_batch(datagrams, flags = 0)
+      datagrams = datagrams.map do |datagram|
+        next datagram if datagram.is_a?(String)
+
+        data, addr, port = datagram
+        addr = port ? Socket.sockaddr_in(port, addr) : addr
+        addr = addr.to_sockaddr if addr.is_a?(Addrinfo)
+        [data, addr]
+      end
+      Polyphony.backend_send_batch(self, datagrams, flags)
+    end
+  end
 end
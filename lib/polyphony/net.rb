@@ -19,6 +19,7 @@ module Polyphony
       # @param opts [Hash] options to use
       # @option opts [boolean] :secure use a default context as SSL context, return `SSLSocket` instance
       # @option opts [OpenSSL::SSL::SSLContext] :secure_context SSL context to use, return `SSLSocket` instance
+      # @option opts [Polyphony::ThreadPool] :handshake_pool thread pool for performing the TLS handshake
       # @return [TCPSocket, SSLSocket] connected socket
       def tcp_connect(host, port, opts = {})
         socket = TCPSocket.new(host, port)
@@ -37,6 +38,7 @@ module Polyphony
       # @param host [String] hostname
       # @param port [Integer] port number
       # @param opts [Hash] connection options
+      # @option opts [Polyphony::ThreadPool, Integer] :handshake_pool thread pool (or pool size) for performing TLS handshakes
       # @return [TCPServer, SSLServer] listening socket
       def tcp_listen(host = nil, port = nil, opts = {})
         host ||= '0.0.0.0'
@@ -96,7 +98,11 @@ module Polyphony
 
         socket.tap do |s|
           s.hostname = opts[:host] if opts[:host]
-          s.connect
+          if opts[:handshake_pool]
+            s.handshake_on(opts[:handshake_pool], :connect)
+          else
+            s.connect
+          end
           s.post_connection_check(opts[:host]) if opts[:host]
         end
       end
@@ -123,7 +129,9 @@ module Polyphony
       # @return [SSLServer] SSL socket
       def secure_server(socket, context, opts)
         setup_alpn(context, opts[:alpn_protocols]) if opts[:alpn_protocols]
-        OpenSSL::SSL::SSLServer.new(socket, context)
+        OpenSSL::SSL::SSLServer.new(socket, context).tap do |server|
+          server.handshake_pool = opts[:handshake_pool] if opts[:handshake_pool]
+        end
       end
     end
   end
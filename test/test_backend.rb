@@ -134,6 +134,62 @@ class BackendTest < MiniTest::Test
     assert_equal [pid, 42], result
   end
 
+  def test_waitpid_any
+    pids = [0.05, 0.01, 0.2].map.with_index do |delay, i|
+      fork do
+        @backend.post_fork
+        sleep delay
+        exit(40 + i)
+      end
+    end
+
+    result = @backend.waitpid_any(pids)
+    assert_equal [[pids[1], 41]], result
+
+    result = @backend.waitpid_any(pids - [pids[1]])
+    assert_equal [[pids[0], 40]], result
+
+    assert_equal [], @backend.waitpid_any([])
+    assert_equal [[pids[2], 42]], @backend.waitpid_any([pids[2]])
+  end
+
+  def test_waitpid_any_already_reaped
+    reaped = fork { @backend.post_fork; exit(1) }
+    live = fork { @backend.post_fork; sleep 0.05; exit(2) }
+    Process.wait(reaped)
+
+    assert_equal [[reaped, nil]], @backend.waitpid_any([reaped, live])
+    assert_equal [[live, 2]], @backend.waitpid_any([live])
+
+    results = []
+    reaped = fork { @backend.post_fork; exit(3) }
+    live = fork { @backend.post_fork; sleep 0.05; exit(4) }
+    Process.wait(reaped)
+    Polyphony.waitpid_any([reaped, live]) { |pid, status| results << [pid, status] }
+    assert_equal [[reaped, nil], [live, 4]], results
+  end
+
+  def test_polyphony_waitpid_any
+    pids = 20.times.map do |i|
+      fork do
+        @backend.post_fork
+        sleep 0.01 * (i % 3)
+        exit(i)
+      end
+    end
+
+    counter = 0
+    f = spin { loop { counter += 1; snooze } }
+    order = []
+    result = Polyphony.waitpid_any(pids) { |pid, status| order << pid }
+
+    assert_equal pids.size, order.size
+    assert_equal pids.map.with_index { |pid, i| [pid, i] }.sort, result.sort
+    assert counter > 0
+  ensure
+    f&.stop
+  end
+
   def test_read_loop
     i, o = IO.pipe
 
@@ -425,6 +481,183 @@ class BackendTest < MiniTest::Test
     assert_equal msg.bytesize, return_value
     assert_equal msg, read_buffer.get_string(0, msg.bytesize)
   end
+
+  def test_close
+    i, o = IO.pipe
+    @backend.write(o, 'foo')
+    assert_nil @backend.close(o)
+    assert o.closed?
+    assert_nil @backend.close(o)
+    assert_equal 'foo', i.read
+
+    pipe = Polyphony::Pipe.new
+    @backend.close(pipe)
+    assert pipe.closed?
+  end
+
+  def test_close_flushes_buffered_writes
+    i, o = IO.pipe
+    o.sync = false
+    o.orig_write('foo')
+    @backend.close(o)
+    assert o.closed?
+    assert_equal 'foo', i.read
+  end
+
+  def test_read_loop_with_io_buffer
+    skip "Works only on Ruby >= 3.1" if RUBY_VERSION < '3.1'
+
+    i, o = IO.pipe
+    buffer = IO::Buffer.new(4)
+    chunks = []
+    f = spin do
+      @backend.read_loop(i, buffer) do |slice|
+        chunks << [slice.size, slice.get_string]
+      end
+    end
+    o << 'foobar'
+    snooze
+    o << 'baz'
+    o.close
+    f.await
+
+    assert_equal [[4, 'foob'], [2, 'ar'], [3, 'baz']], chunks
+    assert_raises(TypeError) { @backend.read_loop(i, 'foo') {} }
+  end
+
+  def test_read_loop_with_reused_buffer
+    i, o = IO.pipe
+    chunks = []
+    f = spin do
+      @backend.read_loop(i, 4, true) do |data|
+        chunks << [data.object_id, data.dup]
+      end
+    end
+    o << 'foobar'
+    snooze
+    o << 'baz'
+    o.close
+    f.await
+
+    assert_equal ['foob', 'ar', 'baz'], chunks.map(&:last)
+    assert_equal 1, chunks.map(&:first).uniq.size
+  end
+
+  def test_read_loop_with_poisoned_reused_buffer
+    Polyphony.poison_reused_buffers = true
+    assert Polyphony.poison_reused_buffers?
+
+    i, o = IO.pipe
+    chunks = []
+    f = spin do
+      @backend.read_loop(i, 8192, true) { |data| chunks << data }
+    end
+    o << 'foo'
+    snooze
+    o << 'barbaz'
+    o.close
+    f.await
+
+    assert_equal 2, chunks.size
+    assert chunks.all?(&:frozen?)
+    assert_equal ["\xDB".b * 3, "\xDB".b * 6], chunks.map(&:b)
+  ensure
+    Polyphony.poison_reused_buffers = false
+  end
+
+  def test_writev_sendv_with_io_buffer
+    skip "Works only on Ruby >= 3.1" if RUBY_VERSION < '3.1'
+
+    i, o = UNIXSocket.pair
+    buffer = IO::Buffer.new(3)
+    buffer.set_string('bar')
+    @backend.write(o, 'foo', buffer, 'baz')
+    @backend.sendv(o, [buffer, 'baz', buffer], 0)
+    o.close
+
+    assert_equal 'foobarbazbarbazbar', i.read
+  end
+
+  def test_op_stats
+    i, o = IO.pipe
+    @backend.write(o, 'foobar')
+    @backend.read(i, +'', 6, false, 0)
+
+    f = spin { @backend.read(i, +'', 6, false, 0) }
+    snooze
+    f.stop
+    f.await
+    @backend.sleep(0.01)
+
+    i.close
+    assert_raises(Errno::EPIPE) { @backend.write(o, 'foo') }
+
+    stats = @backend.stats
+    assert_equal 6, stats[:bytes_read]
+    assert_equal 6, stats[:bytes_written]
+    assert_equal 1, stats[:errors][Errno::EPIPE::Errno]
+    assert_equal 1, stats[:ops].values.sum { |s| s[:cancelled] }
+
+    sleep_stats = stats[:ops][@backend.kind == :io_uring ? :timeout : :sleep]
+    assert_equal 1, sleep_stats[:count]
+    assert_equal 1, sleep_stats[:latency][:count]
+    assert_in_range 10_000_000..100_000_000, sleep_stats[:latency][:p50]
+
+    # counters are cumulative
+    assert_equal 6, @backend.stats[:bytes_read]
+  end
+
+  def test_stall_detector
+    @backend.stall_detector_start(0.02)
+    f = spin(:stalling) do
+      t0 = monotonic_clock
+      while monotonic_clock - t0 < 0.1; end
+    end
+    f.await
+    sleep 0.05
+    @backend.stall_detector_stop
+
+    events = @backend.stall_events
+    assert_equal 1, events.size
+    assert_equal f, events[0][:fiber]
+    assert_equal :stalling, events[0][:tag]
+    assert_kind_of Array, events[0][:backtrace]
+    assert events[0][:backtrace].any? { |l| l =~ /test_backend\.rb/ }
+    assert events[0][:duration] >= 0.02
+    assert_equal 1, @backend.stats[:stall_count]
+    assert_equal [], @backend.stall_events
+  end
+
+  def test_stall_detector_stopped_on_thread_exit
+    skip 'Works only on Linux' unless IS_LINUX
+
+    # warm up Ruby's native thread cache
+    5.times.map { Thread.new { sleep 0.01 } }.each(&:join)
+    sleep 0.05
+    task_count = Dir.children('/proc/self/task').size
+
+    5.times.map do
+      Thread.new { Thread.current.backend.stall_detector_start(0.02) }
+    end.each(&:join)
+    sleep 0.05
+    assert_equal task_count, Dir.children('/proc/self/task').size
+  end
+
+  def test_schedule_delay
+    snooze
+    assert_equal 0, @backend.stats[:schedule_delay][:count]
+
+    @backend.measure_schedule_delay = true
+    f = spin { :foo }
+    spin { t0 = monotonic_clock; while monotonic_clock - t0 < 0.01; end }
+    snooze
+    f.await
+    @backend.measure_schedule_delay = false
+
+    delay = @backend.stats[:schedule_delay]
+    assert delay[:count] >= 3
+    assert_in_range 10_000_000..100_000_000, delay[:max]
+  end
 end
 
 class BackendChainTest < MiniTest::Test
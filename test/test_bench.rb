@@ -0,0 +1,78 @@
+# frozen_string_literal: true
+
+require_relative 'helper'
+require 'polyphony/bench'
+
+class BenchTest < MiniTest::Test
+  def start_echo_server
+    port = rand(1100..60000)
+    server = TCPServer.new('127.0.0.1', port)
+    fiber = spin do
+      server.accept_loop do |conn|
+        spin do
+          conn.read_loop { |data| conn << data }
+        ensure
+          conn.close
+        end
+      end
+    end
+    [port, server, fiber]
+  rescue Errno::EADDRINUSE
+    retry
+  end
+
+  def stop_server(server, fiber)
+    fiber&.stop
+    fiber&.await
+    server&.close
+  end
+
+  def test_echo
+    port, server, fiber = start_echo_server
+    report = Polyphony::Bench.run("tcp://127.0.0.1:#{port}", connections: 4, duration: 0.1)
+    assert_equal 4, report[:connections]
+    assert_equal 0, report[:errors]
+    assert report[:requests] > 0
+    assert_equal report[:requests] * 64, report[:bytes]
+    assert report[:latency][:p50] > 0
+    assert report[:latency][:p99] >= report[:latency][:p50]
+    assert_match(/4 connections/, Polyphony::Bench.format_report(report))
+  ensure
+    stop_server(server, fiber)
+  end
+
+  def test_fixed_rate
+    port, server, fiber = start_echo_server
+    report = Polyphony::Bench.run("tcp://127.0.0.1:#{port}", connections: 2, duration: 0.2, rate: 100)
+    assert_in_range 15..25, report[:requests]
+  ensure
+    stop_server(server, fiber)
+  end
+
+  def test_http
+    port = rand(1100..60000)
+    server = TCPServer.new('127.0.0.1', port)
+    fiber = spin do
+      server.accept_loop do |conn|
+        spin do
+          while (line = conn.gets)
+            next unless line == "\r\n"
+
+            conn << "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello"
+          end
+        ensure
+          conn.close
+        end
+      end
+    end
+    report = Polyphony::Bench.run("tcp://127.0.0.1:#{port}", pattern: :http, connections: 2, duration: 0.1)
+    assert_equal 0, report[:errors]
+    assert report[:requests] > 0
+  ensure
+    stop_server(server, fiber)
+  end
+
+  def test_invalid_target
+    assert_raises(ArgumentError) { Polyphony::Bench.run('foo://bar', duration: 0.1) }
+  end
+end
@@ -0,0 +1,39 @@
+# frozen_string_literal: true
+
+require_relative 'helper'
+
+class HistogramTest < MiniTest::Test
+  def test_record
+    h = Polyphony::Histogram.new
+    assert_equal 0, h.count
+    assert_equal 0, h.percentile(50)
+
+    (1..1000).each { |v| h << v * 1000 }
+    assert_equal 1000, h.count
+    assert_equal 1_000_000, h.max
+    assert_in_range 500_000..500_500, h.mean
+    assert_in_range 440_000..560_000, h.percentile(50)
+    assert_in_range 980_000..1_000_000, h.percentile(99)
+    assert_equal 1_000_000, h.percentile(100)
+    assert_raises(ArgumentError) { h.percentile(101) }
+    assert_raises(ArgumentError) { h << -1 }
+
+    summary = h.to_h
+    assert_equal 1000, summary[:count]
+    assert_equal h.percentile(99.9), summary[:p999]
+
+    h.reset
+    assert_equal 0, h.count
+  end
+
+  def test_merge
+    h1 = Polyphony::Histogram.new
+    h2 = Polyphony::Histogram.new
+    h1 << 10
+    h2 << 20
+    h2 << 30
+    h1.merge(h2)
+    assert_equal 3, h1.count
+    assert_equal 30, h1.max
+  end
+end
@@ -287,6 +287,43 @@ class IOTest < MiniTest::Test
     assert_equal ['foo', 'bar', 'baz'], receiver.buffer
   end
 
+  def test_feed_loop_with_io_buffer
+    skip "Works only on Ruby >= 3.1" if RUBY_VERSION < '3.1'
+
+    i, o = IO.pipe
+    receiver = Receiver2.new
+    buffer = IO::Buffer.new(16)
+    reader = spin do
+      i.feed_loop(receiver, buffer: buffer)
+    end
+    o << 'foo'
+    sleep 0.01
+    o << 'bar'
+    o.close
+    reader.await
+
+    assert_equal 2, receiver.buffer.size
+    assert_kind_of IO::Buffer, receiver.buffer.first
+    assert_equal 'bar', receiver.buffer.last.get_string
+  end
+
+  def test_feed_loop_with_reused_buffer
+    i, o = IO.pipe
+    chunks = []
+    reader = spin do
+      i.feed_loop(chunks, :<<, reuse_buffer: true)
+    end
+    o << 'foo'
+    sleep 0.01
+    o << 'bar'
+    o.close
+    reader.await
+
+    assert_equal 2, chunks.size
+    assert_same chunks.first, chunks.last
+    assert_equal 'bar', chunks.last
+  end
+
   def test_splice_from
     i1, o1 = IO.pipe
     i2, o2 = IO.pipe
@@ -375,6 +412,174 @@ class IOTest < MiniTest::Test
     end
   end
 
+  def test_send_file
+    file = Tempfile.new
+    data = (1..50_000).map { |i| "#{i}\n" }.join
+    file.write(data)
+    file.flush
+
+    i, o = UNIXSocket.pair
+    f = spin { i.read }
+
+    len = IO.send_file(file, o)
+    assert_equal data.bytesize, len
+
+    len = IO.send_file(file, o, offset: 3, length: 7)
+    assert_equal 7, len
+    o.close
+
+    assert_equal data + data[3, 7], f.await
+    assert_equal data.bytesize, file.pos
+  ensure
+    file&.close
+  end
+
+  def test_send_file_ranges
+    file = Tempfile.new
+    file.write('0123456789abcdef')
+    file.flush
+
+    i, o = UNIXSocket.pair
+    f = spin { i.read }
+
+    parts = []
+    len = IO.send_file_ranges(file, o, [0..3, [10, 2], 14..100]) do |offset, length|
+      parts << [offset, length]
+      o << '|'
+    end
+    o.close
+
+    assert_equal 8, len
+    assert_equal [[0, 4], [10, 2], [14, 87]], parts
+    assert_equal '|0123|ab|ef', f.await
+  ensure
+    file&.close
+  end
+
+  def test_send_file_ranges_endless
+    file = Tempfile.new
+    file.write('0123456789abcdef')
+    file.flush
+
+    i, o = UNIXSocket.pair
+    f = spin { i.read }
+
+    parts = []
+    len = IO.send_file_ranges(file, o, [0..1, 12..]) do |offset, length|
+      parts << [offset, length]
+    end
+    o.close
+
+    assert_equal 6, len
+    assert_equal [[0, 2], [12, 4]], parts
+    assert_equal '01cdef', f.await
+  ensure
+    file&.close
+  end
+
+  def test_send_file_ranges_invalid
+    file = Tempfile.new
+    file.write('0123456789abcdef')
+    file.flush
+
+    i, o = UNIXSocket.pair
+    assert_raises(ArgumentError) { IO.send_file_ranges(file, o, [..4]) }
+    assert_raises(ArgumentError) { IO.send_file_ranges(file, o, [1.5..4]) }
+    assert_raises(ArgumentError) { IO.send_file_ranges(file, o, ['a'..'c']) }
+  ensure
+    i&.close
+    o&.close
+    file&.close
+  end
+
+  def test_readv
+    i, o = IO.pipe
+    data = 'x' * 3000 + 'y' * 3000
+    o << data
+    o.close
+
+    a = String.new('>', capacity: 4096)
+    b = String.new(capacity: 4096)
+    assert_equal 6000, i.readv(a, b)
+    assert_operator a.bytesize, :>, 4000
+    assert_operator b.bytesize, :<, 2000
+    assert_equal ">#{data}", a + b
+
+    assert_nil i.readv(String.new(capacity: 16))
+  end
+
+  def test_readv_invalid_buffers
+    i, o = IO.pipe
+    o << 'foo'
+
+    assert_raises(TypeError) { i.readv(nil) }
+    assert_raises(TypeError) { i.readv(1) }
+    assert_raises(TypeError) { i.readv(String.new(capacity: 16), :foo) }
+    assert_equal 'foo', i.readpartial(8192)
+  ensure
+    i&.close
+    o&.close
+  end
+
+  def test_readv_io_buffer
+    skip 'IO::Buffer not available' unless defined?(IO::Buffer)
+
+    i, o = IO.pipe
+    o << 'foobarbaz'
+    o.close
+
+    a = IO::Buffer.new(3)
+    b = IO::Buffer.new(6)
+    assert_equal 9, i.readv(a, b)
+    assert_equal 'foo', a.get_string
+    assert_equal 'barbaz', b.get_string
+  end
+
+  def test_read_segments
+    i, o = IO.pipe
+    data = (1..2000).map(&:to_s).join(',')
+    f = spin do
+      data.chars.each_slice(1000) { |chars| o << chars.join; snooze }
+      o.close
+    end
+
+    segments = i.read_segments(4096, 2)
+    f.await
+    assert_equal data, segments.join
+    assert_equal [4096, 4096], segments[0..-2].map(&:bytesize)
+    assert_equal Encoding::BINARY, segments.first.encoding
+  end
+
+  def test_read_segments_with_small_segment_size
+    i, o = IO.pipe
+    data = (1..200).map(&:to_s).join(',')
+    f = spin do
+      data.chars.each_slice(37) { |chars| o << chars.join; snooze }
+      o.close
+    end
+
+    segments = i.read_segments(16, 2)
+    f.await
+    assert_equal data, segments.join
+    assert_equal [16], segments[0..-2].map(&:bytesize).uniq
+    assert_operator segments.last.bytesize, :<=, 16
+  end
+
+  def test_read_segments_from_file
+    fn = '/tmp/test_read_segments'
+    data = (1..60000).map(&:to_s).join(',')
+    IO.write(fn, data)
+
+    [10, 13, 4097].each do |segment_size|
+      segments = File.open(fn, 'r') { |f| f.read_segments(segment_size, 3) }
+      assert_equal data, segments.join
+      assert_equal [segment_size], segments[0..-2].map(&:bytesize).uniq
+      assert_operator segments.last.bytesize, :<=, segment_size
+    end
+  ensure
+    FileUtils.rm(fn) rescue nil
+  end
+
   def test_double_splice
     if Thread.current.backend.kind != :io_uring
       skip "IO.double_splice available only on io_uring backend"
@@ -681,6 +886,18 @@ class IOClassMethodsTest < MiniTest::Test
     r.read_loop(3) { |data| buf << data }
     assert_equal ['foo', 'bar'], buf
   end
+
+  def test_read_loop_with_reused_buffer
+    r, w = IO.pipe
+
+    w << 'foobar'
+    w.close
+    buf = []
+    ids = []
+    r.read_loop(3, reuse_buffer: true) { |data| buf << data.dup; ids << data.object_id }
+    assert_equal ['foo', 'bar'], buf
+    assert_equal 1, ids.uniq.size
+  end
 end
 
 class IOExtensionsTest < MiniTest::Test
@@ -59,4 +59,16 @@ class KernelTest < MiniTest::Test
   ensure
     timer&.stop
   end
+
+  def test_backtick_and_system_close_pipe_fds
+    skip 'Works only on Linux' unless IS_LINUX
+
+    GC.disable
+    fd_count = Dir.children('/proc/self/fd').size
+    50.times { `true` }
+    50.times { Kernel.system('true') }
+    assert_operator Dir.children('/proc/self/fd').size, :<=, fd_count
+  ensure
+    GC.enable
+  end
 end
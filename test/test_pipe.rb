@@ -23,6 +23,19 @@ class PipeTest < MiniTest::Test
     assert_equal false, pipe.closed?
   end
 
+  def test_pipe_close_read
+    pipe = Polyphony::Pipe.new
+    fd = pipe.fds[0]
+    pipe << 'foo'
+    pipe.close_read
+    assert_raises(Errno::EBADF) { IO.for_fd(fd, autoclose: false).stat }
+    assert_raises(Polyphony::Pipe::ClosedPipeError) { pipe.read }
+
+    pipe.close_read
+    pipe.close
+    assert pipe.closed?
+  end
+
   def test_pipe_splice
     src = Polyphony::Pipe.new
     dest = Polyphony::Pipe.new
@@ -0,0 +1,90 @@
+# frozen_string_literal: true
+
+require_relative 'helper'
+
+class ProfilerTest < MiniTest::Test
+  def busy_loop(duration)
+    t0 = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    x = 0
+    x += 1 while Process.clock_gettime(Process::CLOCK_MONOTONIC) - t0 < duration
+  end
+
+  def test_on_cpu_samples
+    profile = Polyphony::Profiler.profile(interval: 0.001) { busy_loop(0.05) }
+    assert_kind_of Hash, profile[:on_cpu]
+
+    stacks = profile[:on_cpu].select { |stack, _| stack =~ /ProfilerTest#busy_loop/ }
+    refute_empty stacks
+    assert stacks.values.sum > 10_000
+  end
+
+  def test_off_cpu_waits
+    i, o = IO.pipe
+    spin { sleep 0.02; o << 'foo' }
+    profile = Polyphony::Profiler.profile do
+      i.readpartial(8192)
+      sleep 0.01
+    end
+
+    read_stack, read_weight = profile[:off_cpu].find { |stack, _| stack =~ /\[readable fd:#{i.fileno}\]$/ }
+    assert read_stack
+    assert_match /^fiber:main;/, read_stack
+    assert_match /IO#readpartial/, read_stack
+    assert read_weight >= 15_000
+
+    sleep_weight = profile[:off_cpu].find { |stack, _| stack =~ /\[sleep\]$/ }&.last
+    assert sleep_weight && sleep_weight >= 5_000
+  end
+
+  def test_stop_clears_profile
+    Polyphony::Profiler.profile { sleep 0.001 }
+    profile = Polyphony::Profiler.profile { }
+    assert_equal({}, profile[:off_cpu])
+  end
+
+  def test_collapsed
+    profile = {
+      on_cpu: { 'fiber:main;<main>;foo' => 3000 },
+      off_cpu: { 'fiber:main;<main>;bar;[sleep]' => 5000, 'baz' => 0 }
+    }
+    assert_equal "on-cpu;fiber:main;<main>;foo 3000\noff-cpu;fiber:main;<main>;bar;[sleep] 5000\n",
+                 Polyphony::Profiler.collapsed(profile)
+    assert_equal "fiber:main;<main>;bar;[sleep] 5000\n",
+                 Polyphony::Profiler.collapsed(profile, :off_cpu)
+  end
+
+  def test_profile_stopped_on_exception
+    assert_raises(RuntimeError) do
+      Polyphony::Profiler.profile { raise 'foo' }
+    end
+    profile = Polyphony::Profiler.profile { }
+    assert_equal({}, profile[:off_cpu])
+  end
+
+  def test_sigprof_disposition_preserved
+    count = 0
+    prev = trap('PROF') { count += 1 }
+    Polyphony::Profiler.profile(interval: 0.001) { busy_loop(0.01) }
+
+    Process.kill('PROF', Process.pid)
+    sleep 0.01
+    assert_equal 1, count
+  ensure
+    trap('PROF', prev || 'DEFAULT')
+  end
+
+  def test_profiler_stopped_on_thread_exit
+    skip 'Works only on Linux' unless IS_LINUX
+
+    # warm up Ruby's native thread cache
+    5.times.map { Thread.new { sleep 0.01 } }.each(&:join)
+    sleep 0.05
+    task_count = Dir.children('/proc/self/task').size
+
+    5.times.map do
+      Thread.new { Polyphony::Profiler.start(interval: 0.001) }
+    end.each(&:join)
+    sleep 0.05
+    assert_equal task_count, Dir.children('/proc/self/task').size
+  end
+end
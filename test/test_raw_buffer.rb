@@ -34,4 +34,64 @@ class RawBufferTest < MiniTest::Test
       assert_equal '', str
     end
   end
+
+  def test_with_fixed_buffer
+    i, o = IO.pipe
+    result = Polyphony.with_fixed_buffer(1 << 16) do |b|
+      assert_equal 1 << 16, Polyphony.__raw_buffer_size__(b)
+      Polyphony.__raw_buffer_set__(b, 'foobar')
+      Polyphony.backend_write(o, b)
+      o.close
+
+      assert_equal 6, Polyphony.backend_read(i, b, nil, false, 0)
+      Polyphony.__raw_buffer_get__(b, 6)
+    end
+    assert_equal 'foobar', result
+
+    # buffers bigger than the registered buffer size fall back to malloc
+    Polyphony.with_fixed_buffer(1 << 20) do |b|
+      assert_equal 1 << 20, Polyphony.__raw_buffer_size__(b)
+    end
+
+    assert_raises(ArgumentError) { Polyphony.with_fixed_buffer(0) {} }
+  end
+
+  def test_with_fixed_buffer_nested
+    # more buffers than available in the registered buffer pool
+    sizes = []
+    acquire = ->(depth) do
+      return if depth == 0
+
+      Polyphony.with_fixed_buffer(4096) do |b|
+        sizes << Polyphony.__raw_buffer_size__(b)
+        acquire.(depth - 1)
+      end
+    end
+    2.times { acquire.(20) }
+    assert_equal [4096] * 40, sizes
+  end
+
+  def test_with_fixed_buffer_interrupted_reads
+    skip 'Works only on io_uring backend' unless Thread.current.backend.kind == :io_uring
+
+    i, o = IO.pipe
+    # more interrupted reads than available in the registered buffer pool
+    20.times do
+      f = spin do
+        Polyphony.with_fixed_buffer(4096) do |b|
+          Polyphony.backend_read(i, b, nil, false, 0)
+        end
+      end
+      snooze
+      f.stop
+      # let the cancelled read complete
+      sleep 0.001
+    end
+
+    Polyphony.with_fixed_buffer(4096) do |b|
+      assert Polyphony.__raw_buffer_fixed__(b)
+    end
+  ensure
+    o&.close
+  end
 end
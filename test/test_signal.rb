@@ -174,3 +174,119 @@ class SignalTrapTest < Minitest::Test
     assert_equal "INT\n", buffer
   end
 end
+
+class SignalfdTrapTest < Minitest::Test
+  def setup
+    super
+    Polyphony.signalfd = true
+  end
+
+  def teardown
+    trap('USR1', 'DEFAULT')
+    Polyphony.signalfd = false
+    super
+  end
+
+  def blocked_signals
+    File.read('/proc/thread-self/status')[/^SigBlk:\s*(\h+)/, 1].to_i(16)
+  end
+
+  def test_signalfd_trap
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    fibers = []
+    trap('USR1') { fibers << Fiber.current }
+    assert_equal 1 << (Signal.list['USR1'] - 1), blocked_signals & (1 << (Signal.list['USR1'] - 1))
+
+    Thread.new { Process.kill('USR1', Process.pid) }
+    sleep 0.05
+    Process.kill('USR1', Process.pid)
+    sleep 0.05
+
+    assert_equal 2, fibers.size
+    assert fibers.all?(&:oob)
+
+    trap('USR1', 'DEFAULT')
+    assert_equal 0, blocked_signals & (1 << (Signal.list['USR1'] - 1))
+  end
+
+  def test_signalfd_trap_reserved_signal
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    %w[SEGV BUS ILL FPE VTALRM].each do |sig|
+      assert_raises(ArgumentError) { trap(sig) { } }
+    end
+    assert_equal 0, blocked_signals & (1 << (Signal.list['VTALRM'] - 1))
+
+    %w[KILL STOP].each do |sig|
+      assert_raises(Errno::EINVAL) { trap(sig) { } }
+      assert_equal 0, blocked_signals & (1 << (Signal.list[sig] - 1))
+    end
+
+    count = 0
+    trap('USR1') { count += 1 }
+    Process.kill('USR1', Process.pid)
+    sleep 0.05
+    assert_equal 1, count
+  end
+
+  def test_signalfd_disable
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    count = 0
+    trap('USR1') { count += 10 }
+    Polyphony.signalfd = false
+    trap('USR1') { count += 1 }
+    assert_equal 0, blocked_signals & (1 << (Signal.list['USR1'] - 1))
+
+    Process.kill('USR1', Process.pid)
+    sleep 0.05
+    assert_equal 1, count
+  end
+
+  def test_signalfd_term_signal
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    trap('TERM') { raise SystemExit }
+    Thread.new { sleep 0.001; Process.kill('TERM', Process.pid) }
+    assert_raises(SystemExit) { sleep 5 }
+  ensure
+    Polyphony.signalfd = false
+    trap('TERM') { raise SystemExit }
+  end
+
+  def test_signalfd_busy_signal_handling
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    count = 0
+    trap('USR1') { count += 1 }
+    f1 = spin_loop { snooze }
+    f2 = spin_loop { snooze }
+    Thread.new { Process.kill('USR1', Process.pid) }.join
+    snooze until count == 1 || Fiber.current.children.empty?
+    assert_equal 1, count
+  ensure
+    f1&.stop
+    f2&.stop
+  end
+
+  def test_signalfd_in_forked_process
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    i, o = IO.pipe
+    pid = Polyphony.fork do
+      main = Fiber.current
+      trap('USR1') { o.puts 'USR1'; main.stop }
+      i.close
+      sleep
+    ensure
+      o.close
+    end
+
+    o.close
+    sleep 0.1
+    Process.kill('USR1', pid)
+    Thread.current.backend.waitpid(pid)
+    assert_equal "USR1\n", i.read
+  end
+end
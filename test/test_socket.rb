@@ -302,6 +302,101 @@ class UDPSocketTest < MiniTest::Test
     assert_equal 'foobar', msg
     assert_equal server_addr, addr
   end
+
+  def test_udp_send_recv_batch
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    u1 = UDPSocket.new
+    u1.bind('127.0.0.1', 0)
+    server_addr = u1.addr
+
+    u2 = UDPSocket.new
+    u2.bind('127.0.0.1', 0)
+    client_addr = u2.addr
+
+    datagrams = (1..5).map { |i| ["msg#{i}", server_addr[3], server_addr[1]] }
+    assert_equal 5, u2.send_batch(datagrams)
+
+    received = []
+    received.concat(u1.recv_batch(16, 256)) while received.size < 5
+
+    assert_equal %w{msg1 msg2 msg3 msg4 msg5}, received.map(&:first)
+    assert_equal [client_addr], received.map(&:last).uniq
+
+    u2.connect(server_addr[3], server_addr[1])
+    assert_equal 2, u2.send_batch(['foo', 'bar'])
+    received = []
+    received.concat(u1.recv_batch(1, 256)) while received.size < 2
+    assert_equal %w{foo bar}, received.map(&:first)
+  end
+
+  def test_udp_send_segmented
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    u1 = UDPSocket.new
+    u1.bind('127.0.0.1', 0)
+    server_addr = u1.addr
+
+    u2 = UDPSocket.new
+    u2.bind('127.0.0.1', 0)
+    data = ('a' * 1000) + ('b' * 1000) + ('c' * 1000)
+    assert_equal 3000, u2.send_segmented(data, 1000, server_addr[3], server_addr[1])
+
+    msgs = 3.times.map { u1.recvfrom(4096).first }
+    assert_equal ['a' * 1000, 'b' * 1000, 'c' * 1000], msgs
+  end
+
+  def test_udp_recv_segments
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    u1 = UDPSocket.new
+    u1.bind('127.0.0.1', 0)
+    u1.gro = true
+    server_addr = u1.addr
+
+    u2 = UDPSocket.new
+    u2.bind('127.0.0.1', 0)
+    data = ('a' * 1000) + ('b' * 1000) + ('c' * 500)
+    u2.send_segmented(data, 1000, server_addr[3], server_addr[1])
+
+    segments = []
+    while segments.size < 3
+      u1.recv_segments { |segment, addr| segments << [segment, addr] }
+    end
+    assert_equal ['a' * 1000, 'b' * 1000, 'c' * 500], segments.map(&:first)
+    assert_equal [u2.addr], segments.map(&:last).uniq
+  end
+
+  def test_udp_recvmsg_controls
+    u1 = UDPSocket.new
+    u1.bind('127.0.0.1', 0)
+    u1.setsockopt(:IP, :RECVTOS, 1)
+    server_addr = u1.addr
+
+    u2 = UDPSocket.new
+    tos = Socket::AncillaryData.new(:INET, :IP, :TOS, [4].pack('i'))
+    u2.sendmsg('foo', 0, Socket.sockaddr_in(server_addr[1], server_addr[3]), tos)
+
+    msg, _addr, _rflags, *controls = u1.recvmsg(256, 0, 64)
+    assert_equal 'foo', msg
+    assert_equal 1, controls.size
+    assert_kind_of Socket::AncillaryData, controls.first
+    assert_equal Socket::IP_TOS, controls.first.type
+    assert_equal 4, controls.first.data.unpack1('C')
+  end
+
+  def test_udp_sendmsg_bad_controls
+    u1 = UDPSocket.new
+    u1.bind('127.0.0.1', 0)
+    dest = Socket.sockaddr_in(u1.addr[1], u1.addr[3])
+    u2 = UDPSocket.new
+
+    assert_raises(TypeError) { u2.sendmsg('foo', 0, dest, 'bar') }
+    assert_raises(TypeError) { u2.sendmsg('foo', 0, dest, 42) }
+    assert_raises(ArgumentError) { u2.sendmsg('foo', 0, dest, [Socket::IPPROTO_IP, Socket::IP_TOS]) }
+    assert_raises(TypeError) { u2.sendmsg('foo', 0, dest, [Socket::IPPROTO_IP, Socket::IP_TOS, 4]) }
+    assert_raises(TypeError) { u2.sendmsg('foo', 0, dest, ['IP', Socket::IP_TOS, [4].pack('i')]) }
+  end
 end
 
 if IS_LINUX
@@ -382,6 +477,167 @@ class SSLSocketTest < MiniTest::Test
     assert_equal 1, errors.size
     assert_kind_of OpenSSL::SSL::SSLError, errors.first
   end
+
+  def test_ssl_handshake_pool
+    authority = Localhost::Authority.fetch
+    port = rand(10001..39999)
+    server = Polyphony::Net.tcp_listen(
+      '127.0.0.1', port,
+      reuse_addr: true, secure_context: authority.server_context, handshake_pool: 2
+    )
+    assert_kind_of Polyphony::ThreadPool, server.handshake_pool
+
+    f = spin do
+      server.accept_loop do |conn|
+        spin do
+          msg = conn.gets
+          conn << msg.upcase
+          conn.close
+        end
+      end
+    end
+    snooze
+
+    client_pool = Polyphony::ThreadPool.new(3)
+    clients = 3.times.map do |i|
+      spin do
+        client = Polyphony::Net.tcp_connect(
+          'localhost', port,
+          secure_context: authority.client_context, handshake_pool: client_pool
+        )
+        client << "foo#{i}\n"
+        client.read
+      end
+    end
+
+    assert_equal ["FOO0\n", "FOO1\n", "FOO2\n"], Fiber.await(*clients)
+  ensure
+    f&.stop
+    server&.close
+    client_pool&.stop
+  end
+
+  def test_ssl_request_response
+    authority = Localhost::Authority.fetch
+    port = rand(10001..39999)
+    server = Polyphony::Net.tcp_listen('127.0.0.1', port, reuse_addr: true, secure_context: authority.server_context)
+    # the client handshake blocks the thread, so the server runs in its own
+    f = Thread.new do
+      conn = server.accept
+      while (msg = conn.gets)
+        conn << msg.upcase
+      end
+      conn.close
+    end
+
+    client = Polyphony::Net.tcp_connect('localhost', port, secure_context: authority.client_context)
+    replies = 5.times.map do |i|
+      client << "foo#{i}\n"
+      client.gets
+    end
+    assert_equal 5.times.map { |i| "FOO#{i}\n" }, replies
+
+    big = 'x' * 100_000 + "\n"
+    client << big
+    assert_equal big.upcase, client.gets
+    client.close
+    f.join
+  ensure
+    server&.close
+  end
+
+  def test_ssl_read_loop_reuse_buffer
+    authority = Localhost::Authority.fetch
+    port = rand(10001..39999)
+    server = Polyphony::Net.tcp_listen('127.0.0.1', port, reuse_addr: true, secure_context: authority.server_context)
+    # the client handshake blocks the thread, so the server runs in its own
+    f = Thread.new do
+      conn = server.accept
+      3.times { |i| conn << "foo#{i}"; sleep 0.01 }
+      conn.close
+    end
+
+    client = Polyphony::Net.tcp_connect('localhost', port, secure_context: authority.client_context)
+    chunks = []
+    client.read_loop(reuse_buffer: true) { |data| chunks << data.dup; data.freeze }
+    assert_equal 'foo0foo1foo2', chunks.join
+    f.join
+
+    f = Thread.new do
+      conn = server.accept
+      3.times { |i| conn << "bar#{i}"; sleep 0.01 }
+      conn.close
+    end
+    Polyphony.poison_reused_buffers = true
+    client = Polyphony::Net.tcp_connect('localhost', port, secure_context: authority.client_context)
+    chunks = []
+    client.read_loop(reuse_buffer: true) { |data| chunks << data }
+    assert chunks.all?(&:frozen?)
+    assert_equal ["\xDB".b * 12], [chunks.join.b]
+    f.join
+  ensure
+    Polyphony.poison_reused_buffers = false
+    server&.close
+  end
+
+  TCP_ULP = 31
+
+  # Returns true if the kernel TLS upper layer protocol can be attached to a
+  # TCP socket, i.e. the tls module is loaded (or loadable).
+  def ktls_ulp_available?
+    return false unless RUBY_PLATFORM =~ /linux/
+    return false unless defined?(OpenSSL::SSL::OP_ENABLE_KTLS)
+
+    port = rand(10001..39999)
+    server = TCPServer.new('127.0.0.1', port)
+    f = spin { server.accept.close }
+    client = TCPSocket.new('127.0.0.1', port)
+    client.setsockopt(Socket::IPPROTO_TCP, TCP_ULP, 'tls')
+    true
+  rescue Errno::EADDRINUSE
+    server&.close
+    retry
+  rescue SystemCallError
+    false
+  ensure
+    client&.close
+    f&.await
+    server&.close
+  end
+
+  def test_ssl_ktls
+    skip 'kernel TLS is not available' unless ktls_ulp_available?
+
+    authority = Localhost::Authority.fetch
+    server_ctx = authority.server_context
+    server_ctx.ktls = true
+
+    port = rand(10001..39999)
+    server = Polyphony::Net.tcp_listen('127.0.0.1', port, reuse_addr: true, secure_context: server_ctx)
+    # the client handshake blocks the thread, so the server runs in its own
+    f = Thread.new do
+      conn = server.accept
+      r, w = IO.pipe
+      w << 'foobar'
+      w.close
+      conn.splice_from(r, 8192)
+      conn.write('baz')
+      conn.close
+    end
+    client_ctx = authority.client_context
+    client_ctx.ktls = true
+    client = Polyphony::Net.tcp_connect('localhost', port, secure_context: client_ctx)
+
+    ulp = client.io.getsockopt(Socket::IPPROTO_TCP, TCP_ULP).data.delete("\0")
+    assert_equal 'tls', ulp
+    assert_equal true, client.ktls_send?
+    assert_equal :backend_send, client.__write_method__
+
+    assert_equal 'foobarbaz', client.read
+    f.join
+  ensure
+    server&.close
+  end
 end
 
 class MultishotAcceptTest < MiniTest::Test
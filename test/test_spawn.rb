@@ -0,0 +1,106 @@
+# frozen_string_literal: true
+
+require_relative 'helper'
+
+class SpawnTest < MiniTest::Test
+  def test_spawn_stdout
+    child = Polyphony.spawn('echo hello', stdout: :pipe)
+    assert_kind_of Polyphony::ChildProcess, child
+    assert_kind_of Polyphony::Pipe, child.stdout
+    assert_nil child.stdin
+    assert_nil child.stderr
+
+    assert_equal "hello\n", child.stdout.read
+    assert_equal 0, child.wait
+    assert child.done?
+  end
+
+  def test_spawn_stdin
+    child = Polyphony.spawn(['cat'], stdin: :pipe, stdout: :pipe)
+    child.stdin << 'foo'
+    child.stdin << 'bar'
+    child.stdin.close
+
+    assert_equal 'foobar', child.stdout.read
+    assert_equal 0, child.wait
+  end
+
+  def test_spawn_exit_status
+    child = Polyphony.spawn('exit 3')
+    assert_equal 3, child.wait
+    assert_equal 3, child.wait
+  end
+
+  def test_spawn_env
+    child = Polyphony.spawn('echo "$FOO-$HOME"', env: { 'FOO' => 'bar', HOME: nil }, stdout: :pipe)
+    assert_equal "bar-\n", child.stdout.read
+    child.wait
+  end
+
+  def test_spawn_stderr
+    child = Polyphony.spawn('echo foo; echo bar >&2', stdout: :pipe, stderr: :pipe)
+    assert_equal "bar\n", child.stderr.read
+    assert_equal "foo\n", child.stdout.read
+    child.wait
+
+    child = Polyphony.spawn('echo foo; echo bar >&2', stdout: :pipe, stderr: :stdout)
+    assert_equal "foo\nbar\n", child.stdout.read
+    child.wait
+  end
+
+  def test_spawn_io
+    i, o = IO.pipe
+    child = Polyphony.spawn(%w[echo hello], stdout: o)
+    o.close
+    assert_equal "hello\n", i.read
+    child.wait
+  end
+
+  def test_spawn_missing_program
+    assert_raises(Errno::ENOENT) { Polyphony.spawn('azertyuiop') }
+    assert_raises(ArgumentError) { Polyphony.spawn(' ') }
+    assert_raises(ArgumentError) { Polyphony.spawn('ls', stdout: :foo) }
+  end
+
+  def test_spawn_fiber_aware
+    counter = 0
+    f = spin { loop { counter += 1; sleep 0.001 } }
+    threads = Thread.list.size
+
+    child = Polyphony.spawn(%w[sleep 0.05])
+    assert_equal threads, Thread.list.size
+    child.wait
+    assert counter >= 5
+  ensure
+    f&.stop
+  end
+
+  def test_spawn_pipes_not_inherited
+    child1 = Polyphony.spawn('echo hello', stdout: :pipe)
+    child2 = Polyphony.spawn(%w[sleep 1])
+
+    t0 = monotonic_clock
+    assert_equal "hello\n", child1.stdout.read
+    assert monotonic_clock - t0 < 0.5
+    child1.wait
+  ensure
+    child2&.kill
+    child2&.wait
+  end
+
+  def test_spawn_close
+    child = Polyphony.spawn(['cat'], stdin: :pipe, stdout: :pipe, stderr: :pipe)
+    child.stdin << 'foo'
+    child.close
+    assert child.stdin.closed?
+    assert_raises(Polyphony::Pipe::ClosedPipeError) { child.stdout.read }
+    child.wait
+  end
+
+  def test_spawn_kill
+    child = Polyphony.spawn(%w[sleep 10])
+    child.kill
+    child.wait
+    assert child.done?
+  end
+end
@@ -0,0 +1,124 @@
+# frozen_string_literal: true
+
+require_relative 'helper'
+
+class StatsTest < MiniTest::Test
+  def test_cumulative_backend_stats
+    backend = Thread.current.backend
+    3.times { snooze }
+    first = backend.stats
+    assert first[:switch_count] >= 3
+
+    snooze
+    second = backend.stats
+    assert second[:switch_count] > first[:switch_count]
+    assert second[:op_count] >= first[:op_count]
+    assert second[:poll_count] >= first[:poll_count]
+  end
+
+  def test_polyphony_stats
+    queue = Polyphony::Queue.new
+    pushed = Polyphony::Queue.stats[:pushed]
+    queue << 1
+    queue.shift
+    assert_equal pushed + 1, Polyphony::Queue.stats[:pushed]
+
+    pool = Polyphony::ThreadPool.new(2)
+    pool.process { 42 }
+
+    t = Thread.new { sleep 0.01 }
+    t.name = 'worker'
+    sleep 0.001
+
+    stats = Polyphony.stats
+    assert_kind_of Hash, stats[:threads]['main']
+    assert_kind_of Hash, stats[:threads]['worker']
+    assert stats[:totals][:switch_count] >= stats[:threads]['main'][:switch_count]
+    assert stats[:thread_pool][:pools] >= 1
+    assert stats[:thread_pool][:threads] >= 2
+    assert stats[:thread_pool][:processed] >= 1
+    assert stats[:queues][:count] >= 1
+    assert stats[:queues][:shifted] >= 1
+  ensure
+    t&.join
+    pool&.stop
+  end
+
+  def test_timer_stats
+    count = Polyphony::Timer.stats[:count]
+    timer = Polyphony::Timer.new(resolution: 0.01)
+    assert_equal count + 1, Polyphony::Timer.stats[:count]
+
+    spin { timer.sleep(1) }
+    snooze
+    assert Polyphony::Timer.stats[:timeouts] >= 1
+
+    timer.stop
+    assert_equal count, Polyphony::Timer.stats[:count]
+  end
+
+  def test_fiber_stack_stats
+    stats = Polyphony.fiber_stack_stats
+    params = RubyVM::DEFAULT_PARAMS
+    assert_equal params[:fiber_machine_stack_size], stats[:machine_stack_size]
+    assert_equal params[:fiber_vm_stack_size], stats[:vm_stack_size]
+    assert stats[:stack_size] > stats[:machine_stack_size] + stats[:vm_stack_size]
+    skip unless RUBY_PLATFORM =~ /linux/
+
+    fibers = 64.times.map { spin { sleep } }
+    snooze
+    stats = Polyphony.fiber_stack_stats
+    assert stats[:stacks] >= 64
+    assert_equal stats[:stacks] * stats[:stack_size], stats[:reserved]
+    assert stats[:resident] > 0
+    assert stats[:resident] < stats[:reserved]
+  ensure
+    fibers&.each(&:stop)
+  end
+
+  def test_openmetrics
+    r, w = IO.pipe
+    w << 'foo'
+    r.readpartial(3)
+    Thread.current.backend.measure_schedule_delay = true
+    snooze
+
+    text = Polyphony::Stats.openmetrics
+    lines = text.lines.map(&:chomp)
+    assert_equal '# EOF', lines.last
+    assert_includes lines, '# TYPE polyphony_switches counter'
+    assert lines.any? { |l| l =~ /^polyphony_switches_total\{thread="main"\} \d+$/ }
+    assert lines.any? { |l| l =~ /^polyphony_runqueue_length\{thread="main"\} \d+$/ }
+    assert lines.any? { |l| l =~ /^polyphony_read_bytes_total\{thread="main"\} \d+$/ }
+    assert lines.any? { |l| l =~ /^polyphony_schedule_delay_seconds\{thread="main",quantile="0.99"\} [\d.e-]+$/ }
+    assert lines.any? { |l| l =~ /^polyphony_schedule_delay_seconds_count\{thread="main"\} \d+$/ }
+    assert lines.any? { |l| l =~ /^polyphony_queues \d+$/ }
+
+    # each metric family is listed exactly once
+    types = lines.grep(/^# TYPE/)
+    assert_equal types.uniq, types
+  ensure
+    Thread.current.backend.measure_schedule_delay = false
+    r&.close
+    w&.close
+  end
+
+  def test_serve
+    port = rand(1100..60000)
+    server = Polyphony::Stats.serve(port)
+    snooze
+
+    client = TCPSocket.new('127.0.0.1', port)
+    client << "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n"
+    response = client.read
+    assert_match(/\AHTTP\/1.1 200 OK\r\n/, response)
+    assert_match(/Content-Type: application\/openmetrics-text/, response)
+    assert_match(/# EOF\n\z/, response)
+  rescue Errno::EADDRINUSE
+    retry
+  ensure
+    client&.close
+    server&.stop
+    server&.await
+  end
+end
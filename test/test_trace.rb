@@ -217,4 +217,182 @@ class TraceTest < MiniTest::Test
   #   Thread.backend.trace_proc = nil
   # end
 
+
+  def test_native_trace
+    Polyphony::Trace.start_native(16)
+    snooze
+    Polyphony::Trace.stop_native
+
+    events = Polyphony::Trace.read_native
+    assert_equal [:schedule, :block, :unblock], events.map { |e| e[:event] }
+    assert_equal [Fiber.current.trace_id] * 3, events.map { |e| e[:fiber] }
+    assert events.each_cons(2).all? { |a, b| a[:stamp] <= b[:stamp] }
+    assert events.last[:duration] > 0
+
+    assert_equal [], Polyphony::Trace.read_native
+  ensure
+    Thread.backend.trace_buffer_stop
+  end
+
+  def test_native_trace_overflow
+    Polyphony::Trace.start_native(4)
+    10.times { snooze }
+    Polyphony::Trace.stop_native
+
+    assert_equal 4, Polyphony::Trace.read_native.size
+    assert_equal 26, Polyphony::Trace.native_dropped_count
+  ensure
+    Thread.backend.trace_buffer_stop
+  end
+
+  def test_native_trace_dump
+    path = "/tmp/polyphony_native_trace_#{$$}"
+    FileUtils.rm_f(path)
+
+    Polyphony::Trace.start_native(dump: path)
+    snooze
+    Polyphony::Trace.stop_native
+
+    events = Polyphony::Trace.load_native(path)
+    assert_equal [:schedule, :block, :unblock], events.map { |e| e[:event] }
+  ensure
+    Thread.backend.trace_buffer_stop
+    FileUtils.rm_f(path)
+  end
+
+  def test_op_events
+    i, o = IO.pipe
+    events = []
+    Thread.backend.trace_ops = true
+    Thread.backend.trace_proc = proc { |*e| events << e if e[0].to_s =~ /^op_/ }
+
+    o << 'foobar'
+    buf = i.readpartial(8192)
+    Thread.backend.trace_proc = nil
+    assert_equal 'foobar', buf
+
+    write_submit, write_complete, read_submit, read_complete = events
+    assert_equal 4, events.size
+
+    assert_equal [:op_submit, Fiber.current], write_submit[0..1]
+    assert_equal [o.fileno, 6], write_submit[4..5]
+    assert_equal [:op_complete, Fiber.current, write_submit[2], write_submit[3], o.fileno, 6], write_complete[0..5]
+    assert_kind_of Integer, write_complete[6]
+
+    assert_equal [:op_submit, Fiber.current], read_submit[0..1]
+    assert_equal [i.fileno, 8192], read_submit[4..5]
+    assert read_submit[2] > write_submit[2]
+    assert_equal [:op_complete, Fiber.current, read_submit[2], read_submit[3], i.fileno, 6], read_complete[0..5]
+  ensure
+    Thread.backend.trace_proc = nil
+    Thread.backend.trace_ops = false
+  end
+
+  def test_op_events_disabled
+    i, o = IO.pipe
+    events = []
+    Thread.backend.trace_proc = proc { |*e| events << e[0] }
+
+    o << 'foo'
+    i.readpartial(8192)
+    Thread.backend.trace_proc = nil
+
+    assert_equal [], events.grep(/^op_/)
+  ensure
+    Thread.backend.trace_proc = nil
+  end
+
+  def test_op_cancel_event
+    i, o = IO.pipe
+    events = []
+    Thread.backend.trace_ops = true
+    Thread.backend.trace_proc = proc { |*e| events << e if e[0].to_s =~ /^op_/ }
+
+    f = spin { i.read }
+    snooze
+    f.stop
+    f.await
+    Thread.backend.trace_proc = nil
+
+    events = events.select { |e| e[1] == f }
+    submit, cancel = events
+    assert_equal 2, events.size
+    assert_equal [:op_submit, f], submit[0..1]
+    assert_equal [:op_cancel, f, submit[2], submit[3], i.fileno], cancel[0..4]
+    assert_kind_of Integer, cancel[5]
+  ensure
+    Thread.backend.trace_proc = nil
+    Thread.backend.trace_ops = false
+  end
+
+  def test_op_events_trace_proc_io
+    i, o = IO.pipe
+    log_r, log_w = IO.pipe
+    events = []
+    Thread.backend.trace_ops = true
+    Thread.backend.trace_proc = proc do |*e|
+      next unless e[0].to_s =~ /^op_/
+
+      events << e[0]
+      log_w << "#{e[0]}\n"
+    end
+
+    o << 'foo'
+    i.readpartial(8192)
+    Thread.backend.trace_proc = nil
+    log_w.close
+
+    assert_equal %i[op_submit op_complete op_submit op_complete], events
+    assert_equal events.map { |e| "#{e}\n" }.join, log_r.read
+  ensure
+    Thread.backend.trace_proc = nil
+    Thread.backend.trace_ops = false
+  end
+
+  def test_native_op_events
+    i, o = IO.pipe
+    Polyphony::Trace.start_native(ops: true)
+    o << 'foo'
+    i.readpartial(8192)
+    Polyphony::Trace.stop_native
+
+    events = Polyphony::Trace.read_native.select { |e| e[:event].to_s =~ /^op_/ }
+    assert_equal %i[op_submit op_complete op_submit op_complete], events.map { |e| e[:event] }
+    assert_equal [o.fileno, o.fileno, i.fileno, i.fileno], events.map { |e| e[:fd] }
+    assert_equal [3, 3, 8192, 3], events.map { |e| e[:result] }
+    assert_equal events[0][:id], events[1][:id]
+    assert_equal events[2][:id], events[3][:id]
+    refute_equal events[0][:id], events[2][:id]
+    assert_equal 0, events[0][:duration]
+    assert events[3][:duration] > 0
+  ensure
+    Thread.backend.trace_buffer_stop
+    Thread.backend.trace_ops = false
+  end
+
+  def test_native_op_events_reset
+    i, o = IO.pipe
+    Polyphony::Trace.start_native(ops: true)
+    Polyphony::Trace.stop_native
+    Polyphony::Trace.read_native
+
+    Polyphony::Trace.start_native
+    o << 'foo'
+    i.readpartial(8192)
+    Polyphony::Trace.stop_native
+    events = Polyphony::Trace.read_native
+    assert_equal [], events.select { |e| e[:event].to_s =~ /^op_/ }
+
+    events = []
+    Polyphony::Trace.start_event_firehose(ops: true) { |e| events << e[:event] }
+    Thread.backend.trace_proc = nil
+    Polyphony::Trace.start_event_firehose { |e| events << e[:event] }
+    o << 'foo'
+    i.readpartial(8192)
+    Thread.backend.trace_proc = nil
+    assert_equal [], events.grep(/^op_/)
+  ensure
+    Thread.backend.trace_buffer_stop
+    Thread.backend.trace_proc = nil
+  end
 end